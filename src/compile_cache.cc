@@ -0,0 +1,156 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/compile_cache.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "src/hash.h"
+
+// Set by the build to a hash of the grammar files.
+#ifndef TOOLMAN_GRAMMAR_VERSION
+#define TOOLMAN_GRAMMAR_VERSION "unknown"
+#endif
+
+namespace toolman {
+
+namespace {
+constexpr char kManifestMagic[] = "toolman-compile-cache 1";
+
+// Everything but the sources that decides what an entry contains.
+std::string manifest_header() {
+  return std::string(kManifestMagic) + "\ngrammar " + TOOLMAN_GRAMMAR_VERSION +
+         "\nimage " + std::to_string(image::kVersion) + "\n";
+}
+
+// Writes `content` to `path` through a temporary file, so that concurrent
+// runs never see a partial entry.
+bool write_atomically(const std::filesystem::path& path,
+                      const std::string& content) {
+  auto tmp_path = path;
+  tmp_path += ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream ofs(tmp_path, std::ios_base::out | std::ios_base::binary);
+    ofs << content;
+    if (!ofs.flush()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+CompileCache::CompileCache(std::filesystem::path directory,
+                           const std::vector<std::string>& import_paths)
+    : directory_(std::move(directory)), import_paths_hash_(hash::fnv1a("")) {
+  for (const auto& import_path : import_paths) {
+    import_paths_hash_ = hash::fnv1a(
+        std::filesystem::absolute(import_path).lexically_normal().string(),
+        import_paths_hash_);
+    import_paths_hash_ = hash::fnv1a(std::string_view("\0", 1),
+                                     import_paths_hash_);
+  }
+}
+
+std::string CompileCache::entry_key(const std::filesystem::path& source) const {
+  return hash::to_hex(hash::fnv1a(source.string(), import_paths_hash_));
+}
+
+std::filesystem::path CompileCache::image_path(
+    const std::string& key, std::uint64_t sources_hash) const {
+  return directory_ / (key + "-" + hash::to_hex(sources_hash) + ".tmi");
+}
+
+std::optional<CompileCache::Hit> CompileCache::lookup(
+    const std::filesystem::path& source,
+    SourceProvider* source_provider) const {
+  auto key = entry_key(source);
+  std::ifstream manifest(directory_ / (key + ".manifest"));
+  if (!manifest.is_open()) {
+    return std::nullopt;
+  }
+  std::string header(manifest_header().size(), '\0');
+  if (!manifest.read(header.data(), header.size()) ||
+      header != manifest_header()) {
+    return std::nullopt;
+  }
+
+  Hit hit;
+  auto sources_hash = hash::kFnvOffsetBasis;
+  std::string line;
+  while (std::getline(manifest, line)) {
+    // "<content hash> <path>"
+    if (line.size() < 18 || line[16] != ' ') {
+      return std::nullopt;
+    }
+    std::filesystem::path dependency = line.substr(17);
+    auto content = source_provider->read(dependency);
+    if (!content.has_value() ||
+        hash::to_hex(hash::fnv1a(content.value())) != line.substr(0, 16)) {
+      return std::nullopt;
+    }
+    sources_hash = hash::fnv1a(line.substr(0, 16), sources_hash);
+    hit.dependencies.push_back(std::move(dependency));
+  }
+  if (hit.dependencies.empty() || hit.dependencies.front() != source) {
+    return std::nullopt;
+  }
+
+  try {
+    hit.image = image::SchemaImage::map(image_path(key, sources_hash));
+  } catch (image::ImageError&) {
+    return std::nullopt;
+  }
+  return hit;
+}
+
+void CompileCache::store(
+    const std::filesystem::path& source, const Document& document,
+    const std::vector<std::filesystem::path>& dependencies,
+    const std::vector<std::uint64_t>& dependency_hashes) const {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+
+  auto key = entry_key(source);
+  auto sources_hash = hash::kFnvOffsetBasis;
+  std::ostringstream manifest;
+  manifest << manifest_header();
+  for (std::size_t i = 0; i < dependencies.size(); ++i) {
+    auto content_hash = hash::to_hex(dependency_hashes[i]);
+    sources_hash = hash::fnv1a(content_hash, sources_hash);
+    manifest << content_hash << " " << dependencies[i].string() << "\n";
+  }
+  // Images are named after the sources they were compiled from, so a
+  // manifest never refers to the image of other sources, whatever the order
+  // concurrent runs store in.
+  auto new_image = image_path(key, sources_hash);
+  if (!write_atomically(new_image, image::serialize_image(document)) ||
+      !write_atomically(directory_ / (key + ".manifest"), manifest.str())) {
+    return;
+  }
+  // Drops the images of previous versions of the sources.
+  auto prefix = key + "-";
+  for (std::filesystem::directory_iterator it(directory_, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    auto name = it->path().filename().string();
+    if (name.rfind(prefix, 0) == 0 && name.size() > 4 &&
+        name.compare(name.size() - 4, 4, ".tmi") == 0 &&
+        it->path() != new_image) {
+      std::error_code remove_ec;
+      std::filesystem::remove(it->path(), remove_ec);
+    }
+  }
+}
+
+}  // namespace toolman
@@ -0,0 +1,63 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_COMPILE_CACHE_H_
+#define TOOLMAN_COMPILE_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/document.h"
+#include "src/schema_image.h"
+#include "src/source_provider.h"
+
+namespace toolman {
+
+// Persists compiled documents across runs as schema images, so that a run
+// compiling unchanged sources skips lexing and parsing altogether.
+//
+// An entry is valid while the grammar, the image format, the compiled file
+// and every module it imported are unchanged. A module added to the import
+// search paths in front of an imported one is not noticed.
+class CompileCache final {
+ public:
+  struct Hit {
+    std::unique_ptr<image::SchemaImage> image;
+    std::vector<std::filesystem::path> dependencies;
+  };
+
+  CompileCache(std::filesystem::path directory,
+               const std::vector<std::string>& import_paths);
+
+  // The cached compile of `source`, std::nullopt on a miss.
+  std::optional<Hit> lookup(const std::filesystem::path& source,
+                            SourceProvider* source_provider) const;
+
+  // Caches `document`, compiled from `dependencies` (the compiled file
+  // first) with the content hashes `dependency_hashes`. I/O errors are
+  // ignored, the next run misses.
+  void store(const std::filesystem::path& source, const Document& document,
+             const std::vector<std::filesystem::path>& dependencies,
+             const std::vector<std::uint64_t>& dependency_hashes) const;
+
+ private:
+  // Name of the entry of `source`, its manifest is `<key>.manifest`.
+  [[nodiscard]] std::string entry_key(
+      const std::filesystem::path& source) const;
+
+  [[nodiscard]] std::filesystem::path image_path(
+      const std::string& key, std::uint64_t sources_hash) const;
+
+  std::filesystem::path directory_;
+  // Hash of the import search paths, which change what a source compiles to.
+  std::uint64_t import_paths_hash_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_COMPILE_CACHE_H_
@@ -4,54 +4,279 @@
 
 #include "compiler.h"
 
-#define DEF_PHASE_WALK(source, compiler)                     \
-  auto ifs = std::ifstream(*(source), std::ios_base::in);    \
-  if (!ifs.is_open()) {                                      \
-    throw FileNotFoundError(source);                         \
-  }                                                          \
-  antlr4::ANTLRInputStream input(ifs);                       \
-  ToolmanLexer lexer(&input);                                \
-  antlr4::CommonTokenStream tokens(&lexer);                  \
-  tokens.fill();                                             \
-  ToolmanParser parser(&tokens);                             \
-  antlr4::tree::ParseTree* tree = parser.document();         \
-  auto def_phase_walker = DeclPhaseWalker(source, compiler); \
-  walker_.walk(&def_phase_walker, tree);
+#include "src/decl_scanner.h"
+#include "src/hash.h"
+#include "src/parse_context.h"
+#include "src/statement_splitter.h"
+
+#define DEF_SOURCE_INPUT(source, content)                    \
+  auto parse_context = ParseContextPool::acquire(content);     \
+  phase_listeners_.source_loaded(*(source), (content).size());
+
+#define DEF_PHASE_WALK(source, content, compiler)              \
+  DEF_SOURCE_INPUT(source, content)                            \
+  {                                                            \
+    PhaseScope lex_phase(&phase_listeners_, Phase::Lex);       \
+    parse_context->tokens().fill();                            \
+  }                                                            \
+  antlr4::tree::ParseTree* tree;                               \
+  if (grammar_profile_ != nullptr) {                           \
+    GrammarProfile::start(&parse_context->parser());           \
+  }                                                            \
+  {                                                            \
+    PhaseScope parse_phase(&phase_listeners_, Phase::Parse);   \
+    tree = parse_context->parser().document();                 \
+  }                                                            \
+  if (grammar_profile_ != nullptr) {                           \
+    grammar_profile_->stop(&parse_context->parser());          \
+  }                                                            \
+  auto def_phase_walker = DeclPhaseWalker(source, compiler);   \
+  {                                                            \
+    PhaseScope decl_phase(&phase_listeners_, Phase::DeclWalk); \
+    walker_.walk(&def_phase_walker, tree);                     \
+  }
 
 namespace toolman {
 std::shared_ptr<Module> Compiler::compile_module(const std::string& src_path) {
-  auto source = std::filesystem::path(src_path).lexically_normal();
-  if (source.is_relative()) {
-    source = base_path_ / source;
+  auto source = module_resolver_.resolve(src_path);
+  auto module_id = source.has_value() ? module_resolver_.module_id(*source)
+                                      : std::nullopt;
+  if (!module_id.has_value()) {
+    throw FileNotFoundError(std::make_shared<std::filesystem::path>(src_path));
   }
-  if (auto it = modules_.find(source); it != modules_.end()) {
+  // Keyed by file identity, so that a module reached through different
+  // paths is compiled once.
+  if (auto it = modules_.find(*module_id); it != modules_.end()) {
     return it->second;
   }
-  auto source_ptr = std::make_shared<std::filesystem::path>(source);
-  DEF_PHASE_WALK(source_ptr, this);
-  walker_.walk(&def_phase_walker, tree);
+  auto source_ptr = std::make_shared<std::filesystem::path>(*source);
+  auto content = read_source(source_ptr);
+  DEF_SOURCE_INPUT(source_ptr, content);
+  dependencies_.push_back(*source_ptr);
+  dependency_hashes_.push_back(hash::fnv1a(content));
+  // Importers only see the top level names of a module, so the module is
+  // scanned for its declarations instead of being parsed.
+  auto decl_scanner = DeclScanner(source_ptr, this);
+  {
+    PhaseScope scan_phase(&phase_listeners_, Phase::DeclScan);
+    decl_scanner.scan(&parse_context->lexer());
+  }
   auto module = std::make_shared<Module>(
-      def_phase_walker.type_scope(), def_phase_walker.option_scope(),
-      source_ptr, def_phase_walker.get_errors());
-  modules_.emplace(source, module);
+      decl_scanner.type_scope(), decl_scanner.option_scope(), source_ptr,
+      decl_scanner.get_errors());
+  modules_.emplace(*module_id, module);
   return module;
 }
 
+void Compiler::set_importer(const std::filesystem::path& src_path) {
+  auto base_path = src_path.parent_path();
+  if (base_path != module_resolver_.base_path()) {
+    // Imports resolved so far are relative to the previous importer.
+    module_resolver_.clear_cache();
+    module_resolver_.set_base_path(std::move(base_path));
+  }
+}
+
+void Compiler::forget_modules() {
+  modules_.clear();
+  dependencies_.clear();
+  dependency_hashes_.clear();
+  module_resolver_.clear_cache();
+}
+
+bool Compiler::has_module(const std::filesystem::path& source) const {
+  return std::any_of(modules_.begin(), modules_.end(), [&](const auto& entry) {
+    return *entry.second->source() == source;
+  });
+}
+
+std::string Compiler::read_source(
+    const std::shared_ptr<std::filesystem::path>& source) {
+  auto content = source_provider_->read(*source);
+  if (!content.has_value()) {
+    throw FileNotFoundError(source);
+  }
+  return std::move(content.value());
+}
+
 CompileResult Compiler::compile(const std::string& src_path) {
+  auto content = read_source(std::make_shared<std::filesystem::path>(
+      std::filesystem::absolute(src_path).lexically_normal()));
+  return compile_content(src_path, content);
+}
+
+CompileResult Compiler::compile(const std::string& src_path,
+                                std::istream& content) {
+  return compile_content(src_path,
+                         std::string(std::istreambuf_iterator<char>(content),
+                                     std::istreambuf_iterator<char>()));
+}
+
+CompileResult Compiler::compile_content(const std::string& src_path,
+                                        const std::string& content) {
+  // Nothing of a previous compile is reused, the files may have changed.
+  modules_.clear();
+  dependencies_.clear();
+  dependency_hashes_.clear();
+  module_resolver_.clear_cache();
+  type_table_.clear();
+
   auto source_ptr = std::make_shared<std::filesystem::path>(
       std::filesystem::absolute(src_path).lexically_normal());
-  base_path_ = source_ptr->parent_path();
-  DEF_PHASE_WALK(source_ptr, this);
+  module_resolver_.set_base_path(source_ptr->parent_path());
+  dependencies_.push_back(*source_ptr);
+  dependency_hashes_.push_back(hash::fnv1a(content));
+  DEF_PHASE_WALK(source_ptr, content, this);
 
   auto ref_phase_walker =
       RefPhaseWalker(def_phase_walker.type_scope(),
-                     def_phase_walker.option_scope(), source_ptr);
+                     def_phase_walker.option_scope(), source_ptr,
+                     &type_table_);
 
-  walker_.walk(&ref_phase_walker, tree);
+  {
+    PhaseScope ref_phase(&phase_listeners_, Phase::RefWalk);
+    walker_.walk(&ref_phase_walker, tree);
+  }
 
   auto errors = def_phase_walker.get_errors();
   auto ref_phase_errors = ref_phase_walker.get_errors();
   errors.insert(errors.end(), ref_phase_errors.begin(), ref_phase_errors.end());
   return CompileResult(ref_phase_walker.get_document(), errors);
 }
+
+CompileResult Compiler::compile_streaming(
+    const std::string& src_path,
+    const std::function<void(const Document&)>& on_start,
+    const std::function<void(const Document&)>& on_chunk) {
+  modules_.clear();
+  dependencies_.clear();
+  dependency_hashes_.clear();
+  module_resolver_.clear_cache();
+  type_table_.clear();
+
+  auto source_ptr = std::make_shared<std::filesystem::path>(
+      std::filesystem::absolute(src_path).lexically_normal());
+  module_resolver_.set_base_path(source_ptr->parent_path());
+  auto open_source = [&]() {
+    auto istream = source_provider_->open(*source_ptr);
+    if (!istream) {
+      throw FileNotFoundError(source_ptr);
+    }
+    return istream;
+  };
+  // Tokens carry their position in the file, not in the statement.
+  auto acquire = [](const StatementSplitter::Statement& statement) {
+    auto parse_context = ParseContextPool::acquire(statement.text);
+    parse_context->lexer().setLine(statement.line);
+    parse_context->lexer().setCharPositionInLine(statement.column);
+    return parse_context;
+  };
+  auto parse = [&](ParseContext* parse_context) {
+    {
+      PhaseScope lex_phase(&phase_listeners_, Phase::Lex);
+      parse_context->tokens().fill();
+    }
+    if (grammar_profile_ != nullptr) {
+      GrammarProfile::start(&parse_context->parser());
+    }
+    ToolmanParser::DocumentContext* tree;
+    {
+      PhaseScope parse_phase(&phase_listeners_, Phase::Parse);
+      tree = parse_context->parser().document();
+    }
+    if (grammar_profile_ != nullptr) {
+      grammar_profile_->stop(&parse_context->parser());
+    }
+    return tree;
+  };
+
+  // Pass 1: types may refer to types declared further down, so every name
+  // is declared before any type is built.
+  dependencies_.push_back(*source_ptr);
+  dependency_hashes_.push_back(0);
+  auto decl_scanner = DeclScanner(source_ptr, this);
+  auto header = std::make_unique<Document>();
+  header->set_source(source_ptr);
+  std::vector<Error> errors;
+  auto content_hash = hash::kFnvOffsetBasis;
+  std::size_t content_size = 0;
+  {
+    auto istream = open_source();
+    StatementSplitter splitter(istream.get());
+    while (auto statement = splitter.next()) {
+      content_hash = hash::fnv1a(statement->text, content_hash);
+      content_size += statement->text.size();
+      if (statement->kind == StatementSplitter::Kind::Trailing) {
+        continue;
+      }
+      auto parse_context = acquire(*statement);
+      if (statement->kind != StatementSplitter::Kind::Option) {
+        PhaseScope scan_phase(&phase_listeners_, Phase::DeclScan);
+        decl_scanner.scan(&parse_context->lexer());
+        continue;
+      }
+      auto tree = parse(parse_context.get());
+      auto ref_phase_walker =
+          RefPhaseWalker(decl_scanner.type_scope(),
+                         decl_scanner.option_scope(), source_ptr,
+                         &type_table_);
+      {
+        PhaseScope ref_phase(&phase_listeners_, Phase::RefWalk);
+        walker_.walk(&ref_phase_walker, tree);
+      }
+      auto options = ref_phase_walker.get_document();
+      for (const auto& option : options->get_options()) {
+        header->insert_option(option);
+      }
+      auto option_errors = ref_phase_walker.get_errors();
+      errors.insert(errors.end(), option_errors.begin(), option_errors.end());
+    }
+  }
+  dependency_hashes_.front() = content_hash;
+  phase_listeners_.source_loaded(*source_ptr, content_size);
+  auto decl_errors = decl_scanner.get_errors();
+  errors.insert(errors.begin(), decl_errors.begin(), decl_errors.end());
+  auto result = CompileResult(std::move(header), std::move(errors));
+  if (result.has_fatal_error()) {
+    return result;
+  }
+  auto document = result.get_document();
+  auto errors_so_far = result.get_errors();
+  bool failed = false;
+  on_start(*document);
+
+  // Pass 2: builds and hands out the types of one statement at a time.
+  auto istream = open_source();
+  StatementSplitter splitter(istream.get());
+  while (auto statement = splitter.next()) {
+    if (statement->kind != StatementSplitter::Kind::Declaration) {
+      continue;
+    }
+    auto parse_context = acquire(*statement);
+    auto tree = parse(parse_context.get());
+    auto ref_phase_walker =
+        RefPhaseWalker(decl_scanner.type_scope(), decl_scanner.option_scope(),
+                       source_ptr, &type_table_);
+    {
+      PhaseScope ref_phase(&phase_listeners_, Phase::RefWalk);
+      walker_.walk(&ref_phase_walker, tree);
+    }
+    auto chunk = ref_phase_walker.get_document();
+    for (const auto& error : ref_phase_walker.get_errors()) {
+      failed = failed || error.is_fatal();
+      errors_so_far.push_back(error);
+    }
+    // Nothing more is handed out once the output is known to be invalid.
+    if (!failed) {
+      on_chunk(*chunk);
+    }
+    for (const auto& struct_type : chunk->get_struct_types()) {
+      struct_type->clear_fields();
+    }
+    for (const auto& enum_type : chunk->get_enum_types()) {
+      enum_type->clear_fields();
+    }
+  }
+  return CompileResult(std::move(document), std::move(errors_so_far));
+}
 }  // namespace toolman
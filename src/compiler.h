@@ -5,8 +5,10 @@
 #ifndef TOOLMAN_COMPILER_H_
 #define TOOLMAN_COMPILER_H_
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -17,11 +19,17 @@
 #include "ToolmanLexer.h"
 #include "ToolmanParser.h"
 #include "src/error.h"
+#include "src/grammar_profile.h"
+#include "src/mem_report.h"
+#include "src/module_resolver.h"
+#include "src/phase.h"
+#include "src/source_provider.h"
+#include "src/type_table.h"
 #include "src/walker.h"
 
 namespace toolman {
 
-class Module : public HasMultiError {
+class Module : public HasMultiError, private mem::Tracked<Module> {
  public:
   Module(std::shared_ptr<TypeScope> type_scope,
          std::shared_ptr<OptionScope> option_scope,
@@ -56,20 +64,112 @@ class CompileResult final : public HasMultiError {
   std::unique_ptr<Document> document_;
 };
 
+// Compilers share no state: distinct instances may be used from different
+// threads at the same time, an instance compiles one document at a time.
 class Compiler {
  public:
-  Compiler() : walker_(antlr4::tree::ParseTreeWalker::DEFAULT) {}
+  Compiler()
+      : walker_(antlr4::tree::ParseTreeWalker::DEFAULT),
+        source_provider_(std::make_shared<DiskSourceProvider>()),
+        module_resolver_(source_provider_) {}
 
   // Use shared_ptr as return value, Convenient to no longer use import class
   // later.
   std::shared_ptr<Module> compile_module(const std::string& src_path);
 
+  // Compiles the file at `src_path`. Every call starts over, nothing read by
+  // a previous call is reused.
   CompileResult compile(const std::string& src_path);
 
+  // Compiles `content` as the file at `src_path`, imports are resolved
+  // relative to it.
+  CompileResult compile(const std::string& src_path, std::istream& content);
+
+  // Compiles the file at `src_path` one top level statement at a time, so
+  // that memory stays proportional to the largest statement instead of the
+  // file. A first pass over the file declares every type and reads imports
+  // and options; `on_start` then gets a document holding only the options.
+  // The second pass builds the types of each statement and hands them to
+  // `on_chunk`, after which their fields are released. The second pass is
+  // skipped if the first one has fatal errors.
+  //
+  // The returned result holds the document passed to `on_start`.
+  CompileResult compile_streaming(
+      const std::string& src_path,
+      const std::function<void(const Document&)>& on_start,
+      const std::function<void(const Document&)>& on_chunk);
+
+  // Listeners are notified around every phase of `compile` and
+  // `compile_module`.
+  void add_phase_listener(PhaseListener* listener) {
+    phase_listeners_.add(listener);
+  }
+
+  PhaseListeners& phase_listeners() { return phase_listeners_; }
+
+  // Every source file read by the last compile: the compiled file followed
+  // by the modules reached through `compile_module`, in the order they were
+  // read.
+  [[nodiscard]] const std::vector<std::filesystem::path>& dependencies() const {
+    return dependencies_;
+  }
+
+  // Profiles the prediction decisions of every parse into `grammar_profile`,
+  // nullptr to stop.
+  void set_grammar_profile(GrammarProfile* grammar_profile) {
+    grammar_profile_ = grammar_profile;
+  }
+
+  // Every source, the compiled file included, is read through
+  // `source_provider`. Reads the disk by default.
+  void set_source_provider(std::shared_ptr<SourceProvider> source_provider) {
+    module_resolver_.set_source_provider(source_provider);
+    source_provider_ = std::move(source_provider);
+  }
+
+  [[nodiscard]] SourceProvider* source_provider() const {
+    return source_provider_.get();
+  }
+
+  // FNV-1a hash of the content of every dependency, see src/hash.h.
+  [[nodiscard]] const std::vector<std::uint64_t>& dependency_hashes() const {
+    return dependency_hashes_;
+  }
+
+  // For callers walking a document themselves, e.g. the language server:
+  // the next `compile_module` calls resolve imports relative to `src_path`.
+  // Unlike `compile`, modules compiled before are kept.
+  void set_importer(const std::filesystem::path& src_path);
+
+  // Forgets every module compiled so far, e.g. because a source changed.
+  void forget_modules();
+
+  // Whether the module read from `source` is kept.
+  [[nodiscard]] bool has_module(const std::filesystem::path& source) const;
+
+  // Adds a directory to search for imported modules, after the directory of
+  // the compiled file.
+  void add_import_path(const std::filesystem::path& import_path) {
+    module_resolver_.add_import_path(import_path);
+  }
+
  private:
+  // Throws FileNotFoundError if `source` does not exist.
+  std::string read_source(const std::shared_ptr<std::filesystem::path>& source);
+
+  CompileResult compile_content(const std::string& src_path,
+                                const std::string& content);
+
   antlr4::tree::ParseTreeWalker walker_;
-  std::map<std::filesystem::path, std::shared_ptr<Module>> modules_;
-  std::filesystem::path base_path_;
+  PhaseListeners phase_listeners_;
+  GrammarProfile* grammar_profile_ = nullptr;
+  std::shared_ptr<SourceProvider> source_provider_;
+  ModuleResolver module_resolver_;
+  std::map<ModuleId, std::shared_ptr<Module>> modules_;
+  std::vector<std::filesystem::path> dependencies_;
+  std::vector<std::uint64_t> dependency_hashes_;
+  // Shares the primitive, list and map types of one compile.
+  TypeTable type_table_;
 };
 }  // namespace toolman
 
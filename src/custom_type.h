@@ -12,36 +12,47 @@
 
 #include "src/enum_field.h"
 #include "src/field.h"
+#include "src/mem_report.h"
+#include "src/stmt_info.h"
 #include "src/type.h"
 
 namespace toolman {
 
 template <typename F>
-class CustomType : public Type {
+class CustomType : public Type, public HasStmtInfo {
  public:
   template <typename S, typename SI>
-  CustomType(S&& name, SI&& stmt_info)
-      : Type(std::forward<S>(name), std::forward<SI>(stmt_info)) {}
+  CustomType(Kind kind, S&& name, SI&& stmt_info)
+      : Type(kind, std::forward<S>(name)),
+        HasStmtInfo(std::forward<SI>(stmt_info)) {}
 
   bool append_field(F f) {
     // returns false when there is a conflict of field names
-    if (get_field_by_name(f.get_name()).has_value()) {
+    if (get_field_by_name(f.get_name()) != nullptr) {
       return false;
     }
     fields_.push_back(std::move(f));
     return true;
   }
 
-  [[nodiscard]] std::vector<F> get_fields() const { return fields_; }
+  [[nodiscard]] const std::vector<F>& get_fields() const { return fields_; }
 
-  [[nodiscard]] std::optional<F> get_field_by_name(
+  // Releases the fields, e.g. once code has been generated for the type.
+  void clear_fields() {
+    fields_.clear();
+    fields_.shrink_to_fit();
+  }
+
+  // The field named `field_name`, nullptr if there is none. Invalidated by
+  // `append_field`.
+  [[nodiscard]] const F* get_field_by_name(
       const std::string& field_name) const {
     for (const auto& f : fields_) {
       if (f.get_name() == field_name) {
-        return std::make_optional(f);
+        return &f;
       }
     }
-    return std::nullopt;
+    return nullptr;
   }
 
   bool operator==(const Type& rhs) const override {
@@ -52,10 +63,15 @@ class CustomType : public Type {
   std::vector<F> fields_;
 };
 
-class StructType final : public CustomType<Field> {
+class StructType final : public CustomType<Field>,
+                         private mem::Tracked<StructType> {
  public:
-  using CustomType::CustomType;
-  [[nodiscard]] bool is_struct() const override { return true; }
+  static constexpr Kind kKind = Kind::Struct;
+
+  template <typename S, typename SI>
+  StructType(S&& name, SI&& stmt_info)
+      : CustomType(Kind::Struct, std::forward<S>(name),
+                   std::forward<SI>(stmt_info)) {}
 
   bool operator==(const Type& rhs) const override {
     if (!rhs.is_struct()) {
@@ -69,13 +85,30 @@ class StructType final : public CustomType<Field> {
   }
 };
 
-class EnumType final : public CustomType<EnumField> {
+class EnumType final : public CustomType<EnumField>,
+                       private mem::Tracked<EnumType> {
  public:
-  using CustomType::CustomType;
-  [[nodiscard]] bool is_enum() const override { return true; }
+  static constexpr Kind kKind = Kind::Enum;
+
+  template <typename S, typename SI>
+  EnumType(S&& name, SI&& stmt_info)
+      : CustomType(Kind::Enum, std::forward<S>(name),
+                   std::forward<SI>(stmt_info)) {}
+
   [[nodiscard]] std::string to_string() const override {
     return "enum " + name_ + " {...}";
   }
+
+  // Returns the field declared with `value` in this enum, nullptr if there
+  // is none.
+  [[nodiscard]] const EnumField* get_field_by_value(int value) const {
+    for (const auto& f : get_fields()) {
+      if (f.get_value() == value) {
+        return &f;
+      }
+    }
+    return nullptr;
+  }
   bool operator==(const Type& rhs) const override {
     if (!rhs.is_enum()) {
       return false;
@@ -84,13 +117,15 @@ class EnumType final : public CustomType<EnumField> {
   }
 };
 
-class OneofType final : public CustomType<Field> {
+class OneofType final : public CustomType<Field>,
+                        private mem::Tracked<OneofType> {
  public:
+  static constexpr Kind kKind = Kind::Oneof;
+
   template <typename SI>
   explicit OneofType(SI&& stmt_info)
-      : CustomType("oneof", std::forward<SI>(stmt_info)) {}
+      : CustomType(Kind::Oneof, "oneof", std::forward<SI>(stmt_info)) {}
 
-  [[nodiscard]] bool is_oneof() const override { return true; }
   [[nodiscard]] std::string to_string() const override { return "oneof(...)"; }
 
   bool operator==(const Type& rhs) const override {
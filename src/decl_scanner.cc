@@ -0,0 +1,163 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/decl_scanner.h"
+
+#include "src/compiler.h"
+
+namespace toolman {
+
+void DeclScanner::scan(antlr4::TokenSource* token_source) {
+  token_source_ = token_source;
+  advance();
+  while (!at(antlr4::Token::EOF)) {
+    if (at(ToolmanLexer::From)) {
+      scan_import();
+    } else if (at(ToolmanLexer::Type)) {
+      scan_type_decl();
+    } else {
+      // Options, api declarations and anything the parser would reject.
+      advance();
+    }
+  }
+}
+
+void DeclScanner::declare(const std::shared_ptr<Type>& type) {
+  types_.push_back(type);
+  if (auto search = type_scope_->lookup(type->get_name());
+      search.has_value()) {
+    push_error(DuplicateTypeDeclError(search.value(), *declaration_of(*type)));
+  } else {
+    type_scope_->declare(type);
+  }
+}
+
+void DeclScanner::advance() {
+  do {
+    current_ = token_source_->nextToken();
+  } while (current_->getChannel() != antlr4::Token::DEFAULT_CHANNEL ||
+           at(ToolmanLexer::DocumentComment) ||
+           at(ToolmanLexer::InlineComment));
+}
+
+bool DeclScanner::at_identifier_name() const {
+  switch (current_->getType()) {
+    case ToolmanLexer::Identifier:
+    case ToolmanLexer::BooleanLiteral:
+    case ToolmanLexer::Struct:
+    case ToolmanLexer::Enum:
+    case ToolmanLexer::Import:
+    case ToolmanLexer::As:
+    case ToolmanLexer::From:
+    case ToolmanLexer::Type:
+    case ToolmanLexer::Api:
+    case ToolmanLexer::Any:
+    case ToolmanLexer::Bool:
+    case ToolmanLexer::String:
+    case ToolmanLexer::I32:
+    case ToolmanLexer::I64:
+    case ToolmanLexer::U32:
+    case ToolmanLexer::U64:
+    case ToolmanLexer::Float:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void DeclScanner::scan_import() {
+  advance();
+  if (!at(ToolmanLexer::StringLiteral)) {
+    return;
+  }
+  auto str_lit = current_->getText();
+  import_builder_.start_import(str_lit.substr(1, str_lit.length() - 2));
+  advance();
+  if (!at(ToolmanLexer::Import)) {
+    return;
+  }
+  advance();
+
+  if (at(ToolmanLexer::Star)) {
+    import_builder_.set_import_star(true);
+    advance();
+  } else {
+    import_builder_.set_import_star(false);
+    while (at_identifier_name()) {
+      import_builder_.start_import_name(current_->getText());
+      advance();
+      if (at(ToolmanLexer::As)) {
+        advance();
+        if (at_identifier_name()) {
+          import_builder_.start_import_name_alias(current_->getText());
+          advance();
+        }
+      }
+      if (!at(ToolmanLexer::Comma)) {
+        break;
+      }
+      advance();
+    }
+  }
+  if (at(ToolmanLexer::SemiColon)) {
+    advance();
+  }
+
+  import_builder_.end_import();
+  declare_imports(import_builder_.import(), compiler_, type_scope_.get(),
+                  this);
+}
+
+void DeclScanner::scan_type_decl() {
+  advance();
+  if (!at(ToolmanLexer::OpenParen)) {
+    scan_single_type_decl();
+    return;
+  }
+  advance();
+  while (scan_single_type_decl() && at(ToolmanLexer::Comma)) {
+    advance();
+  }
+  if (at(ToolmanLexer::CloseParen)) {
+    advance();
+  }
+}
+
+bool DeclScanner::scan_single_type_decl() {
+  if (!at_identifier_name()) {
+    return false;
+  }
+  auto name = std::move(current_);
+  advance();
+  auto is_struct = at(ToolmanLexer::Struct);
+  if (!is_struct && !at(ToolmanLexer::Enum)) {
+    return false;
+  }
+  advance();
+  if (!at(ToolmanLexer::OpenBrace)) {
+    return false;
+  }
+  skip_body();
+
+  if (is_struct) {
+    decl_type<StructType>(*name);
+  } else {
+    decl_type<EnumType>(*name);
+  }
+  return true;
+}
+
+void DeclScanner::skip_body() {
+  std::size_t depth = 0;
+  do {
+    if (at(ToolmanLexer::OpenBrace)) {
+      ++depth;
+    } else if (at(ToolmanLexer::CloseBrace)) {
+      --depth;
+    }
+    advance();
+  } while (depth > 0 && !at(antlr4::Token::EOF));
+}
+
+}  // namespace toolman
@@ -0,0 +1,101 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_DECL_SCANNER_H_
+#define TOOLMAN_DECL_SCANNER_H_
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ToolmanLexer.h"
+#include "src/error.h"
+#include "src/scope.h"
+#include "src/type_visitor.h"
+#include "src/walker.h"
+
+namespace toolman {
+
+class Compiler;
+
+// Declare phase of imported modules.
+//
+// An importer only needs the names of the top level types of a module, so
+// instead of building a parse tree the scanner reads the tokens once, resolves
+// import statements and declares every `structDecl` and `enumDecl` name,
+// skipping their bodies by brace matching.
+class DeclScanner final : public HasMultiError {
+ public:
+  DeclScanner(std::shared_ptr<std::filesystem::path> source,
+              Compiler* compiler)
+      : type_scope_(std::make_shared<TypeScope>()),
+        option_scope_(std::make_shared<OptionScope>()),
+        source_(std::move(source)),
+        compiler_(compiler) {
+    buildin::decl_buildin_option(option_scope_.get());
+  }
+
+  void scan(antlr4::TokenSource* token_source);
+
+  // Declares the struct or enum `type` as if its declaration was scanned
+  // again, e.g. for a statement that did not change since it was scanned.
+  void declare(const std::shared_ptr<Type>& type);
+
+  // Every type scanned or declared so far, duplicates included, in source
+  // order.
+  [[nodiscard]] const std::vector<std::shared_ptr<Type>>& types() const {
+    return types_;
+  }
+
+  [[nodiscard]] const std::shared_ptr<TypeScope>& type_scope() const {
+    return type_scope_;
+  }
+
+  [[nodiscard]] const std::shared_ptr<OptionScope>& option_scope() const {
+    return option_scope_;
+  }
+
+ private:
+  // Moves to the next token of the default channel.
+  void advance();
+
+  [[nodiscard]] bool at(std::size_t token_type) const {
+    return current_->getType() == token_type;
+  }
+
+  // Whether the current token can be an `identifierName`.
+  [[nodiscard]] bool at_identifier_name() const;
+
+  // from 'xxx.tm' import ...;
+  void scan_import();
+
+  // type ...
+  void scan_type_decl();
+
+  // name struct {...} | name enum {...}
+  bool scan_single_type_decl();
+
+  void skip_body();
+
+  template <typename DECL_TYPE>
+  void decl_type(const antlr4::Token& name) {
+    StmtInfo stmt_info({name.getLine(), name.getLine()}, token_columns(name),
+                       source_);
+    declare(std::make_shared<DECL_TYPE>(name.getText(), std::move(stmt_info)));
+  }
+
+  std::shared_ptr<TypeScope> type_scope_;
+  std::shared_ptr<OptionScope> option_scope_;
+  std::shared_ptr<std::filesystem::path> source_;
+  ImportBuilder import_builder_;
+  Compiler* compiler_;
+  antlr4::TokenSource* token_source_ = nullptr;
+  std::unique_ptr<antlr4::Token> current_;
+  std::vector<std::shared_ptr<Type>> types_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_DECL_SCANNER_H_
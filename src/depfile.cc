@@ -0,0 +1,48 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/depfile.h"
+
+namespace toolman {
+
+namespace {
+std::string escape(const std::string& path) {
+  std::string escaped;
+  escaped.reserve(path.size());
+  for (auto c : path) {
+    switch (c) {
+      case ' ':
+      case '#':
+      case '\\':
+        escaped += '\\';
+        break;
+      case '$':
+        escaped += '$';
+        break;
+      default:
+        break;
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+}  // namespace
+
+void write_depfile(std::ostream& ostream, const std::string& target,
+                   const std::vector<std::filesystem::path>& dependencies,
+                   bool phony_targets) {
+  ostream << escape(target) << ":";
+  for (const auto& dependency : dependencies) {
+    ostream << " \\\n  " << escape(dependency.string());
+  }
+  ostream << "\n";
+
+  if (phony_targets) {
+    for (const auto& dependency : dependencies) {
+      ostream << "\n" << escape(dependency.string()) << ":\n";
+    }
+  }
+}
+
+}  // namespace toolman
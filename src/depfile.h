@@ -0,0 +1,25 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_DEPFILE_H_
+#define TOOLMAN_DEPFILE_H_
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace toolman {
+
+// Writes a dependency file in Makefile syntax, as understood by Make and
+// Ninja, stating that `target` depends on every path of `dependencies`.
+// With `phony_targets`, an empty rule is added for every dependency so that
+// deleting a module does not break the build (like `gcc -MP`).
+void write_depfile(std::ostream& ostream, const std::string& target,
+                   const std::vector<std::filesystem::path>& dependencies,
+                   bool phony_targets);
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_DEPFILE_H_
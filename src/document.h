@@ -10,12 +10,13 @@
 #include <vector>
 
 #include "src/custom_type.h"
+#include "src/mem_report.h"
 #include "src/option.h"
 #include "src/type.h"
 
 namespace toolman {
 
-class Document final {
+class Document final : private mem::Tracked<Document> {
  public:
   [[nodiscard]] const std::vector<std::shared_ptr<StructType>>&
   get_struct_types() const {
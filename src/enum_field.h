@@ -7,54 +7,42 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "src/mem_report.h"
 #include "src/stmt_info.h"
 #include "src/type.h"
 
 namespace toolman {
-class EnumField final : public HasStmtInfo {
+class EnumField final : public HasStmtInfo,
+                        private mem::Tracked<EnumField> {
  public:
   template <typename S, typename SI>
   EnumField(S&& name, SI&& stmt_info)
-      : name_(std::forward<S>(name)),
-        HasStmtInfo(std::forward<SI>(stmt_info)) {}
+      : HasStmtInfo(std::forward<SI>(stmt_info)),
+        name_(std::forward<S>(name)) {}
 
   template <typename S, typename SI>
   EnumField(S&& name, SI&& stmt_info, std::vector<std::string> comments)
-      : name_(std::forward<S>(name)),
-        comments_(comments),
-        HasStmtInfo(std::forward<SI>(stmt_info)) {}
+      : HasStmtInfo(std::forward<SI>(stmt_info)),
+        name_(std::forward<S>(name)),
+        comments_(std::move(comments)) {}
 
   [[nodiscard]] const std::string& get_name() const { return name_; }
 
-  [[nodiscard]] const std::vector<std::string> get_comments() const {
+  [[nodiscard]] const std::vector<std::string>& get_comments() const {
     return comments_;
   }
 
   [[nodiscard]] int get_value() const { return value_; }
 
-  // set value to enum field, return false when value already exists.
-  bool set_value(int value) {
-    value_ = value;
-    return value_mapping_.emplace(value, *this).second;
-  }
-
-  static std::optional<EnumField> get_by_value(int value) {
-    if (auto got = value_mapping_.find(value); got != value_mapping_.end()) {
-      return std::make_optional(got->second);
-    } else {
-      return std::nullopt;
-    }
-  }
+  void set_value(int value) { value_ = value; }
 
  private:
   std::string name_;
-  int value_;
+  int value_ = 0;
   std::vector<std::string> comments_;
-  inline static std::unordered_map<int, EnumField> value_mapping_;
 };
 }  // namespace toolman
 
@@ -9,18 +9,20 @@
 #include <exception>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "src/enum_field.h"
+#include "src/mem_report.h"
 #include "src/option.h"
 #include "src/stmt_info.h"
 #include "src/type.h"
 
 namespace toolman {
 
-class Error : public std::exception {
+class Error : public std::exception, private mem::Tracked<Error> {
  public:
   enum class ErrorType : char { Lexer, Syntax, Semantic };
   enum class Level : char { Note, Warning, Fatal };
@@ -29,8 +31,25 @@ class Error : public std::exception {
   Error(ErrorType type, Level level, S&& message)
       : type_(type), level_(level), message_(std::forward<S>(message)) {}
 
+  template <typename S, typename SI>
+  Error(ErrorType type, Level level, S&& message, SI&& location)
+      : type_(type),
+        level_(level),
+        message_(std::forward<S>(message)),
+        location_(std::forward<SI>(location)) {}
+
   [[nodiscard]] bool is_fatal() const { return level_ == Level::Fatal; }
 
+  [[nodiscard]] ErrorType type() const { return type_; }
+
+  [[nodiscard]] Level level() const { return level_; }
+
+  // Where the error is in the source, std::nullopt for errors of a whole
+  // file or import.
+  [[nodiscard]] const std::optional<StmtInfo>& location() const {
+    return location_;
+  }
+
   [[nodiscard]] virtual std::string error() const { return message_; }
 
   [[nodiscard]] const char* what() const noexcept override {
@@ -41,6 +60,7 @@ class Error : public std::exception {
   ErrorType type_;
   Level level_;
   std::string message_;
+  std::optional<StmtInfo> location_;
 };
 
 class HasMultiError {
@@ -58,6 +78,8 @@ class HasMultiError {
 
   std::vector<Error> get_errors() { return errors_; }
 
+  [[nodiscard]] const std::vector<Error>& errors() const { return errors_; }
+
   void push_error(Error error) { errors_.push_back(std::move(error)); }
 
  private:
@@ -71,13 +93,12 @@ class DuplicateTypeDeclError final : public Error {
                          SI&& duplicate_decl_stmt_info)
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
               "A type " + first_declared_type->to_string() +
-                  " has been defined more than once."),
-        first_declared_type_(std::move(first_declared_type)),
-        duplicate_decl_stmt_info_(std::forward<SI>(duplicate_decl_stmt_info)) {}
+                  " has been defined more than once.",
+              std::forward<SI>(duplicate_decl_stmt_info)),
+        first_declared_type_(std::move(first_declared_type)) {}
 
  private:
   std::shared_ptr<Type> first_declared_type_;
-  StmtInfo duplicate_decl_stmt_info_;
 };
 
 class MapKeyTypeMustBePrimitiveError final : public Error {
@@ -97,16 +118,18 @@ class CustomTypeNotFoundError final : public Error {
   template <typename SI>
   CustomTypeNotFoundError(const std::string& type_name, SI&& stmt_info)
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
-              "cannot find type `" + type_name + "`") {}
+              "cannot find type `" + type_name + "`",
+              std::forward<SI>(stmt_info)) {}
 };
 
 class DuplicateFieldDeclError final : public Error {
  public:
   template <typename FIELD, typename SI>
-  DuplicateFieldDeclError(FIELD first_decl_field, SI&& stmt_info)
+  DuplicateFieldDeclError(const FIELD& first_decl_field, SI&& stmt_info)
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
               "field `" + first_decl_field.get_name() +
-                  "` is already declared") {}
+                  "` is already declared",
+              std::forward<SI>(stmt_info)) {}
 };
 
 class DuplicateEnumFieldValueError final : public Error {
@@ -117,7 +140,8 @@ class DuplicateEnumFieldValueError final : public Error {
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
               "discriminant value `" +
                   std::to_string(first_value_field.get_value()) +
-                  "` already exists") {}
+                  "` already exists",
+              std::forward<SI>(stmt_info)) {}
 };
 
 class RecursiveOneofTypeError final : public Error {
@@ -125,7 +149,8 @@ class RecursiveOneofTypeError final : public Error {
   template <typename SI>
   explicit RecursiveOneofTypeError(SI&& stmt_info)
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
-              "oneof type does not allow recursion") {}
+              "oneof type does not allow recursion",
+              std::forward<SI>(stmt_info)) {}
 };
 
 class UnknownOptionError final : public Error {
@@ -134,7 +159,8 @@ class UnknownOptionError final : public Error {
   explicit UnknownOptionError(const std::string& option_name,
                               SI&& option_name_stmt_info)
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
-              "Option \"" + option_name + "\" unknown.") {}
+              "Option \"" + option_name + "\" unknown.",
+              std::forward<SI>(option_name_stmt_info)) {}
 };
 
 class OptionTypeMismatchError final : public Error {
@@ -144,7 +170,16 @@ class OptionTypeMismatchError final : public Error {
       : Error(Error::ErrorType::Semantic, Error::Level::Fatal,
               "Value must be " + option->type_name() + " for " +
                   option->type_name() + " option \"" + option->get_name() +
-                  "\".") {}
+                  "\".",
+              std::forward<SI>(option_value_stmt_info)) {}
+};
+
+class SyntaxError final : public Error {
+ public:
+  template <typename SI>
+  SyntaxError(ErrorType type, const std::string& message, SI&& stmt_info)
+      : Error(type, Error::Level::Fatal, message,
+              std::forward<SI>(stmt_info)) {}
 };
 
 class UnresolvedImportError final : public Error {
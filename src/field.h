@@ -10,38 +10,39 @@
 #include <utility>
 #include <vector>
 
+#include "src/mem_report.h"
 #include "src/stmt_info.h"
 #include "src/type.h"
 
 namespace toolman {
 
-class Field final : public HasStmtInfo {
+class Field final : public HasStmtInfo, private mem::Tracked<Field> {
  public:
   template <typename S, typename SI>
   Field(S&& name, SI&& stmt_info)
-      : name_(name),
-        HasStmtInfo(std::forward<SI>(stmt_info)),
+      : HasStmtInfo(std::forward<SI>(stmt_info)),
+        name_(std::forward<S>(name)),
         optional_(false) {}
 
   template <typename S, typename SI>
   Field(S&& name, SI&& stmt_info, std::vector<std::string> comments)
-      : name_(name),
-        comments_(comments),
-        HasStmtInfo(std::forward<SI>(stmt_info)),
+      : HasStmtInfo(std::forward<SI>(stmt_info)),
+        name_(std::forward<S>(name)),
+        comments_(std::move(comments)),
         optional_(false) {}
 
   template <typename S, typename SI>
   Field(S&& name, std::shared_ptr<Type> type, bool optional, SI&& stmt_info,
         std::vector<std::string> comments)
-      : type_(std::forward<S>(type)),
-        name_(name),
-        optional_(optional),
-        comments_(comments),
-        HasStmtInfo(std::forward<SI>(stmt_info)) {}
+      : HasStmtInfo(std::forward<SI>(stmt_info)),
+        type_(std::move(type)),
+        name_(std::forward<S>(name)),
+        comments_(std::move(comments)),
+        optional_(optional) {}
 
   [[nodiscard]] const std::string& get_name() const { return name_; }
 
-  [[nodiscard]] const std::vector<std::string> get_comments() const {
+  [[nodiscard]] const std::vector<std::string>& get_comments() const {
     return comments_;
   }
 
@@ -0,0 +1,153 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/fragment_cache.h"
+
+#include <unistd.h>
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+#include "src/hash.h"
+#include "src/option.h"
+
+// Set by the build to a hash of the generator sources.
+#ifndef TOOLMAN_GENERATOR_VERSION
+#define TOOLMAN_GENERATOR_VERSION "unknown"
+#endif
+
+namespace toolman::generator {
+
+namespace {
+constexpr char kMagic[] = "toolman-fragments 1";
+
+std::string describe_options(const Document& document) {
+  std::string options;
+  for (const auto& option : document.get_options()) {
+    options.append(option->get_name()).append("=");
+    if (auto bool_option = std::dynamic_pointer_cast<BoolOption>(option)) {
+      options.append(bool_option->get_value() ? "true" : "false");
+    } else if (auto numeric_option =
+                   std::dynamic_pointer_cast<NumericOption>(option)) {
+      options.append(std::to_string(numeric_option->get_value()));
+    } else if (auto string_option =
+                   std::dynamic_pointer_cast<StringOption>(option)) {
+      options.append(string_option->get_value());
+    }
+    options.push_back('\0');
+  }
+  return options;
+}
+
+std::string type_key(const Type* type) {
+  return (type->is_struct() ? "struct " : "enum ") + type->get_name();
+}
+}  // namespace
+
+FragmentCache::FragmentCache(std::filesystem::path directory,
+                             TargetLanguage target, const Document& document) {
+  auto source = document.get_source()->string();
+  auto target_name = std::to_string(static_cast<int>(target));
+  path_ = directory / (hash::to_hex(hash::fnv1a(
+                           target_name, hash::fnv1a(source))) +
+                       ".fragments");
+  generator_key_ = "target " + target_name + " generator " +
+                   TOOLMAN_GENERATOR_VERSION + " options " +
+                   hash::to_hex(hash::fnv1a(describe_options(document)));
+
+  // <magic>\n<generator key>\n then per fragment
+  // <closure hash> <code length> <type key>\n<dependency>\n...\n\n<code>
+  std::ifstream ifs(path_, std::ios_base::in | std::ios_base::binary);
+  std::error_code ec;
+  auto file_size = std::filesystem::file_size(path_, ec);
+  if (ec) {
+    return;
+  }
+  std::string line;
+  if (!std::getline(ifs, line) || line != kMagic || !std::getline(ifs, line) ||
+      line != generator_key_) {
+    return;
+  }
+  while (std::getline(ifs, line)) {
+    std::istringstream header(line);
+    std::string closure_hash;
+    std::size_t length = 0;
+    std::string key;
+    if (!(header >> closure_hash >> length) || header.get() != ' ' ||
+        !std::getline(header, key)) {
+      return;
+    }
+    Fragment fragment;
+    // A fragment whose hash does not parse is read past and regenerated.
+    auto [end, error] = std::from_chars(
+        closure_hash.data(), closure_hash.data() + closure_hash.size(),
+        fragment.closure_hash, 16);
+    auto valid =
+        error == std::errc() && end == closure_hash.data() + closure_hash.size();
+    while (std::getline(ifs, line) && !line.empty()) {
+      fragment.dependencies.push_back(line);
+    }
+    if (length > file_size) {
+      return;
+    }
+    fragment.code.resize(length);
+    if (!ifs.read(fragment.code.data(), static_cast<std::streamsize>(length))) {
+      return;
+    }
+    if (valid) {
+      previous_.emplace(std::move(key), std::move(fragment));
+    }
+  }
+}
+
+void FragmentCache::emit(std::ostream& ostream, const Type* type,
+                         const std::function<void(std::ostream&)>& generate) {
+  auto key = type_key(type);
+  auto closure_hash = type_hasher_.closure_hash(type);
+  Fragment fragment;
+  if (auto it = previous_.find(key);
+      it != previous_.end() && it->second.closure_hash == closure_hash) {
+    fragment = std::move(it->second);
+    previous_.erase(it);
+    ++reused_;
+  } else {
+    std::ostringstream code;
+    generate(code);
+    fragment.closure_hash = closure_hash;
+    fragment.code = code.str();
+    for (auto dependency : type_hasher_.closure(type)) {
+      fragment.dependencies.push_back(type_key(dependency));
+    }
+    ++regenerated_;
+  }
+  ostream << fragment.code;
+  current_[key] = std::move(fragment);
+}
+
+void FragmentCache::save() const {
+  std::error_code ec;
+  std::filesystem::create_directories(path_.parent_path(), ec);
+  auto tmp_path = path_;
+  tmp_path += ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream ofs(tmp_path, std::ios_base::out | std::ios_base::binary);
+    ofs << kMagic << "\n" << generator_key_ << "\n";
+    for (const auto& [key, fragment] : current_) {
+      ofs << hash::to_hex(fragment.closure_hash) << " "
+          << fragment.code.size() << " " << key << "\n";
+      for (const auto& dependency : fragment.dependencies) {
+        ofs << dependency << "\n";
+      }
+      ofs << "\n" << fragment.code;
+    }
+    if (!ofs.flush()) {
+      std::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_path, path_, ec);
+}
+
+}  // namespace toolman::generator
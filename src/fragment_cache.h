@@ -0,0 +1,72 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_FRAGMENT_CACHE_H_
+#define TOOLMAN_FRAGMENT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/document.h"
+#include "src/generator.h"
+#include "src/type_hash.h"
+
+namespace toolman::generator {
+
+// Code generated per type by a previous run, reused for every type whose
+// declaration and dependency closure (see TypeHasher) are unchanged, see
+// `toolman --incremental`.
+//
+// Only the output of `generate_struct` and `generate_enum` is cached, the
+// document and section hooks run every time.
+class FragmentCache final {
+ public:
+  // Loads the fragments generated for `document` into `target` by the last
+  // run, if any, from `directory`.
+  FragmentCache(std::filesystem::path directory, TargetLanguage target,
+                const Document& document);
+
+  // Writes the fragment of `type` to `ostream`, reusing the cached one if
+  // it is still valid and calling `generate` otherwise.
+  void emit(std::ostream& ostream, const Type* type,
+            const std::function<void(std::ostream&)>& generate);
+
+  // Replaces the stored fragments with those emitted by this run. I/O
+  // errors are ignored, the next run regenerates.
+  void save() const;
+
+  [[nodiscard]] std::size_t regenerated() const { return regenerated_; }
+  [[nodiscard]] std::size_t reused() const { return reused_; }
+
+ private:
+  struct Fragment {
+    std::uint64_t closure_hash;
+    // Names of the types of the closure, informational.
+    std::vector<std::string> dependencies;
+    std::string code;
+  };
+
+  // Keyed by kind and name, e.g. "struct Foo".
+  using Fragments = std::map<std::string, Fragment>;
+
+  std::filesystem::path path_;
+  // Everything but the types that decides what a generator emits.
+  std::string generator_key_;
+  TypeHasher type_hasher_;
+  Fragments previous_;
+  Fragments current_;
+  std::size_t regenerated_ = 0;
+  std::size_t reused_ = 0;
+};
+
+}  // namespace toolman::generator
+
+#endif  // TOOLMAN_FRAGMENT_CACHE_H_
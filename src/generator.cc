@@ -5,6 +5,7 @@
 #include "src/generator.h"
 
 #include "src/document.h"
+#include "src/fragment_cache.h"
 #include "src/golang_generator.h"
 #include "src/java_generator.h"
 #include "src/typescript_generator.h"
@@ -26,58 +27,123 @@ TargetLanguage target_language_from_string(std::string target) {
 
 void Generator::generate(std::ostream& ostream,
                          const std::unique_ptr<Document>& document) {
+  prepare(*document);
+  begin_stream(ostream, document.get());
+  generate_structs(ostream, document.get());
+  generate_enums(ostream, document.get());
+  end_stream(ostream, document.get());
+}
+
+void Generator::begin_stream(std::ostream& ostream, const Document* document) {
   ostream << single_line_comment(
                  "Generated by the toolman compiler. DO NOT EDIT!")
           << NL
           << single_line_comment("source: " +
                                  document->get_source()->filename().string())
           << NL << NL;
-  before_generate_document(ostream, document.get());
-  before_generate_struct(ostream, document.get());
+  before_generate_document(ostream, document);
+}
+
+void Generator::generate_chunk(std::ostream& ostream, const Document* chunk) {
+  prepare(*chunk);
+  if (!chunk->get_struct_types().empty()) {
+    generate_structs(ostream, chunk);
+  }
+  if (!chunk->get_enum_types().empty()) {
+    generate_enums(ostream, chunk);
+  }
+}
+
+void Generator::end_stream(std::ostream& ostream, const Document* document) {
+  after_generate_document(ostream, document);
+  ostream << std::flush;
+}
+
+const std::string& Generator::render(const Type* type, unsigned flags) const {
+  std::pair<const Type*, unsigned> key{type, flags};
+  if (auto it = render_cache_.find(key); it != render_cache_.end()) {
+    return it->second;
+  }
+  auto rendered = render_type(type, flags);
+  return render_cache_.emplace(key, std::move(rendered)).first->second;
+}
+
+void Generator::prepare(const Document& document) {
+  lowering_.lower(document);
+  render_cache_.clear();
+}
+
+void Generator::generate_structs(std::ostream& ostream,
+                                 const Document* document) {
+  before_generate_struct(ostream, document);
   for (const auto& struct_type : document->get_struct_types()) {
-    generate_struct(ostream, struct_type);
+    if (fragment_cache_ != nullptr) {
+      fragment_cache_->emit(ostream, struct_type.get(), [&](auto& fragment) {
+        generate_struct(fragment, struct_type);
+      });
+    } else {
+      generate_struct(ostream, struct_type);
+    }
   }
+  after_generate_struct(ostream, document);
+}
 
-  after_generate_struct(ostream, document.get());
-  before_generate_enum(ostream, document.get());
+void Generator::generate_enums(std::ostream& ostream,
+                               const Document* document) {
+  before_generate_enum(ostream, document);
   for (const auto& enum_type : document->get_enum_types()) {
-    generate_enum(ostream, enum_type);
+    if (fragment_cache_ != nullptr) {
+      fragment_cache_->emit(ostream, enum_type.get(), [&](auto& fragment) {
+        generate_enum(fragment, enum_type);
+      });
+    } else {
+      generate_enum(ostream, enum_type);
+    }
   }
-  after_generate_enum(ostream, document.get());
-  after_generate_document(ostream, document.get());
-  ostream << std::flush;
+  after_generate_enum(ostream, document);
 }
 
-void generate(std::unique_ptr<Document> document, TargetLanguage targetLanguage,
-              std::ostream& ostream) {
-  std::unique_ptr<Generator> generator;
+std::unique_ptr<Generator> make_generator(TargetLanguage targetLanguage) {
   switch (targetLanguage) {
     case TargetLanguage::GOLANG:
-      generator = std::make_unique<GolangGenerator>();
-      break;
+      return std::make_unique<GolangGenerator>();
     case TargetLanguage::TYPESCRIPT:
-      generator = std::make_unique<TypescriptGenerator>();
-      break;
+      return std::make_unique<TypescriptGenerator>();
     case TargetLanguage::JAVA:
-      generator = std::make_unique<JavaGenerator>();
-      break;
+      return std::make_unique<JavaGenerator>();
   }
-  generator->generate(ostream, document);
+  return nullptr;
+}
+
+void generate(const std::unique_ptr<Document>& document,
+              TargetLanguage targetLanguage, std::ostream& ostream,
+              PhaseListeners* phase_listeners) {
+  PhaseScope generate_phase(phase_listeners, Phase::Generate);
+  make_generator(targetLanguage)->generate(ostream, document);
 }
 
 std::string underscore(std::string in) {
-  in[0] = tolower(in[0]);
+  if (in.empty()) {
+    return in;
+  }
+  // Appends to a new string, inserting in place is quadratic.
+  std::string out;
+  out.reserve(in.size() + in.size() / 2);
+  out.push_back(static_cast<char>(tolower(in[0])));
   for (size_t i = 1; i < in.size(); ++i) {
     if (isupper(in[i])) {
-      in[i] = tolower(in[i]);
-      in.insert(i, "_");
+      out.push_back('_');
+      out.push_back(static_cast<char>(tolower(in[i])));
+    } else {
+      out.push_back(in[i]);
     }
   }
-  return in;
+  return out;
 }
 
 std::string camelcase(const std::string& in) {
-  std::ostringstream out;
+  std::string out;
+  out.reserve(in.size());
   bool underscore = false;
 
   for (char c : in) {
@@ -86,22 +152,26 @@ std::string camelcase(const std::string& in) {
       continue;
     }
     if (underscore) {
-      out << (char)toupper(c);
+      out.push_back(static_cast<char>(toupper(c)));
       underscore = false;
       continue;
     }
-    out << c;
+    out.push_back(c);
   }
 
-  return out.str();
+  return out;
 }
 std::string capitalize(std::string in) {
-  in[0] = toupper(in[0]);
+  if (!in.empty()) {
+    in[0] = toupper(in[0]);
+  }
   return in;
 }
 
 std::string decapitalize(std::string in) {
-  in[0] = tolower(in[0]);
+  if (!in.empty()) {
+    in[0] = tolower(in[0]);
+  }
   return in;
 }
 }  // namespace toolman::generator
@@ -5,11 +5,17 @@
 #ifndef TOOLMAN_GENERATOR_H_
 #define TOOLMAN_GENERATOR_H_
 
+#include <functional>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 #include "src/custom_type.h"
 #include "src/document.h"
+#include "src/lowering.h"
+#include "src/phase.h"
 
 #define INDENT_1 "    "
 #define INDENT INDENT_1
@@ -29,16 +35,55 @@ enum class TargetLanguage : char { GOLANG, TYPESCRIPT, JAVA };
 
 TargetLanguage target_language_from_string(std::string target);
 
-void generate(std::unique_ptr<Document> document, TargetLanguage targetLanguage,
-              std::ostream& ostream);
+void generate(const std::unique_ptr<Document>& document,
+              TargetLanguage targetLanguage, std::ostream& ostream,
+              PhaseListeners* phase_listeners = nullptr);
 
-class Generator {
+class FragmentCache;
+
+class Generator : protected NamingRules {
  public:
-  virtual ~Generator() = default;
+  ~Generator() override = default;
+
+  // Reuses the code of unchanged types from `fragment_cache`, nullptr to
+  // generate everything.
+  void set_fragment_cache(FragmentCache* fragment_cache) {
+    fragment_cache_ = fragment_cache;
+  }
+
   void generate(std::ostream& ostream,
                 const std::unique_ptr<Document>& document);
 
+  // Streaming, for documents built piecewise (see
+  // `Compiler::compile_streaming`): `begin_stream` with the document holding
+  // the options, `generate_chunk` for every piece of the types, then
+  // `end_stream`.
+  void begin_stream(std::ostream& ostream, const Document* document);
+  void generate_chunk(std::ostream& ostream, const Document* chunk);
+  void end_stream(std::ostream& ostream, const Document* document);
+
  protected:
+  Generator() : lowering_(this) {}
+
+  // The target names of a type lowered from the document being generated.
+  [[nodiscard]] const LoweredType& lowered(const Type* type) const {
+    return lowering_[type];
+  }
+
+  // `type` in the target language, rendered by `render_type` once per type
+  // and `flags` in a document. Types are interned (see src/type_table.h), so
+  // the fields sharing a type share its rendering.
+  [[nodiscard]] const std::string& render(const Type* type,
+                                          unsigned flags = 0) const;
+
+  // Renders `type`, using `render` for the nested types. `flags` select a
+  // variant of the rendering, e.g. boxed types in Java.
+  [[nodiscard]] virtual std::string render_type(const Type* type,
+                                                unsigned flags) const = 0;
+
+  void generate_structs(std::ostream& ostream, const Document* document);
+  void generate_enums(std::ostream& ostream, const Document* document);
+
   virtual void before_generate_document(std::ostream& ostream,
                                         const Document* document) {}
   virtual void after_generate_document(std::ostream& ostream,
@@ -60,8 +105,26 @@ class Generator {
       const std::shared_ptr<StructType>& struct_type) = 0;
   virtual void generate_enum(std::ostream& ostream,
                              const std::shared_ptr<EnumType>& enum_type) = 0;
+
+ private:
+  struct RenderKeyHash {
+    std::size_t operator()(const std::pair<const Type*, unsigned>& key) const {
+      return std::hash<const Type*>()(key.first) * 31 + key.second;
+    }
+  };
+
+  // Lowers `document` and forgets the renderings of the previous one.
+  void prepare(const Document& document);
+
+  Lowering lowering_;
+  mutable std::unordered_map<std::pair<const Type*, unsigned>, std::string,
+                             RenderKeyHash>
+      render_cache_;
+  FragmentCache* fragment_cache_ = nullptr;
 };
 
+std::unique_ptr<Generator> make_generator(TargetLanguage targetLanguage);
+
 /**
  * Transforms a camel case string to an equivalent one separated by underscores
  * e.g. aMultiWord -> a_multi_word
@@ -5,47 +5,112 @@
 #ifndef TOOLMAN_GOLANG_GENERATOR_H_
 #define TOOLMAN_GOLANG_GENERATOR_H_
 
+#include <cctype>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 #include "src/generator.h"
 #include "src/list_type.h"
 #include "src/map_type.h"
 #include "src/primitive_type.h"
+#include "src/scope.h"
+#include "src/type_visitor.h"
 
 namespace toolman::generator {
 class GolangGenerator : public Generator {
  protected:
+  [[nodiscard]] std::string type_name(const std::string& name) const override {
+    return capitalize(name);
+  }
+
+  [[nodiscard]] std::string field_name(
+      const std::string& name) const override {
+    return capitalize(name);
+  }
+
+  [[nodiscard]] std::string enum_field_name(
+      const std::string& enum_name, const std::string& name) const override {
+    return capitalize(enum_name) + "_" + name;
+  }
+
+  [[nodiscard]] std::string oneof_name(
+      const std::string& struct_name,
+      const std::string& field_name) const override {
+    return "is" + capitalize(struct_name) + "_" + capitalize(field_name);
+  }
+
+  [[nodiscard]] std::string oneof_wrapper_name(
+      const std::string& struct_name,
+      const std::string& field_name) const override {
+    return capitalize(struct_name) + "_" + capitalize(field_name);
+  }
+
+  void before_generate_document(std::ostream& ostream,
+                                const Document* document) override {
+    json_codec_ = false;
+    for (const auto& opt : document->get_options()) {
+      if (opt->get_name() == buildin::option_go_json_codec.get_name()) {
+        auto bool_opt = std::dynamic_pointer_cast<
+            decltype(buildin::option_go_json_codec)>(opt);
+        json_codec_ = bool_opt->get_value();
+      }
+    }
+    if (!json_codec_) {
+      return;
+    }
+    source_ = document->get_source();
+    json_prefix_ = json_prefix(*document);
+    ostream << "import (" << NL << INDENT_1 << "\"encoding/json\"" << NL
+            << INDENT_1 << "\"errors\"" << NL << INDENT_1 << "\"math\"" << NL
+            << INDENT_1 << "\"strconv\"" << NL << INDENT_1
+            << "\"unicode/utf8\"" << NL << ")" << NL2;
+  }
+
+  void after_generate_document(std::ostream& ostream,
+                               const Document* document) override {
+    if (json_codec_) {
+      generate_json_runtime(ostream);
+    }
+  }
+
+  // The oneof interfaces and their wrappers, ahead of the `type (...)` group.
   void before_generate_struct(std::ostream& ostream,
                               const Document* document) override {
     for (const auto& struct_type : document->get_struct_types()) {
-      auto capitalized_struct_name = capitalize(struct_type->get_name());
-      for (const auto& field : struct_type->get_fields()) {
-        if (field.get_type()->is_oneof()) {
-          auto oneof_name =
-              gen_oneof_name(struct_type->get_name(), field.get_name());
-          ostream << "type " << oneof_name << " interface {" << NL << INDENT_1
-                  << oneof_name << "()" << NL << "}" << NL;
-          auto oneof = std::dynamic_pointer_cast<OneofType>(field.get_type());
-          for (const auto& oneof_field : oneof->get_fields()) {
-            auto capitalized_field_name = capitalize(oneof_field.get_name());
-            auto struct_name = capitalized_struct_name + capitalized_field_name;
-            ostream << struct_name << " struct {" << NL << INDENT_1
-                    << capitalized_field_name << " "
-                    << type_to_go_type(oneof_field.get_type().get()) << NL
-                    << "}" << NL2 << "func (*" << struct_name << ") "
-                    << oneof_name << "() {}" << NL2;
-          }
+      const auto& lowered_struct = lowered(struct_type.get());
+      const auto& fields = struct_type->get_fields();
+      for (auto index : lowered_struct.oneof_fields) {
+        const auto& oneof_name = lowered_struct.fields[index].oneof_name;
+        ostream << "type " << oneof_name << " interface {" << NL << INDENT_1
+                << oneof_name << "()" << NL << "}" << NL2;
+        const auto* oneof =
+            type_cast<OneofType>(fields[index].get_type().get());
+        const auto& lowered_oneof = lowered(oneof);
+        const auto& alternatives = oneof->get_fields();
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto& alternative = lowered_oneof.fields[i];
+          ostream << "type " << alternative.wrapper_name << " struct {" << NL
+                  << INDENT_1 << alternative.name << " "
+                  << type_to_go_type(alternatives[i].get_type().get()) << NL
+                  << "}" << NL2 << "func (*" << alternative.wrapper_name
+                  << ") " << oneof_name << "() {}" << NL2;
         }
       }
     }
     ostream << "type (" << NL;
   }
 
+  // The JSON methods follow the group, they cannot be declared in it.
   void after_generate_struct(std::ostream& ostream,
                              const Document* document) override {
     ostream << ")" << NL2;
+    if (json_codec_) {
+      for (const auto& struct_type : document->get_struct_types()) {
+        generate_json_methods(ostream, *struct_type);
+      }
+    }
   }
 
   void after_generate_enum(std::ostream& ostream,
@@ -61,38 +126,23 @@ class GolangGenerator : public Generator {
   void generate_struct(
       std::ostream& ostream,
       const std::shared_ptr<StructType>& struct_type) override {
-    auto capitalized_struct_name = capitalize(struct_type->get_name());
-    for (const auto& field : struct_type->get_fields()) {
-      if (field.get_type()->is_oneof()) {
-        auto oneof_name =
-            gen_oneof_name(struct_type->get_name(), field.get_name());
-        ostream << oneof_name + " interface {" << NL << INDENT_1 << oneof_name
-                << "()" << NL << "}" << NL;
-        auto oneof = std::dynamic_pointer_cast<OneofType>(field.get_type());
-        for (const auto& oneof_field : oneof->get_fields()) {
-          auto capitalized_field_name = capitalize(oneof_field.get_name());
-          ostream << capitalized_struct_name << "_" << capitalized_field_name
-                  << " struct {" << NL << INDENT_1 << capitalized_field_name
-                  << " " << type_to_go_type(oneof_field.get_type().get()) << NL
-                  << "}" << NL;
-        }
-      }
-    }
-
-    ostream << capitalized_struct_name << " struct {" << NL;
-    for (const auto& field : struct_type->get_fields()) {
+    const auto& lowered_struct = lowered(struct_type.get());
+    ostream << lowered_struct.name << " struct {" << NL;
+    const auto& fields = struct_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto& field = fields[i];
+      const auto& lowered_field = lowered_struct.fields[i];
       for (const auto& comment : field.get_comments()) {
         ostream << INDENT_1 << single_line_comment(comment) << NL;
       }
 
-      ostream << INDENT_1 << capitalize(field.get_name()) << " "
+      ostream << INDENT_1 << lowered_field.name << " "
               << (field.is_optional() && !field.get_type()->is_map() &&
                           !field.get_type()->is_list()
                       ? "*"
                       : "")
               << (field.get_type()->is_oneof()
-                      ? gen_oneof_name(struct_type->get_name(),
-                                       field.get_name())
+                      ? lowered_field.oneof_name
                       : type_to_go_type(field.get_type().get()))
               << " `json:\"" + field.get_name() + "\"`" << NL;
     }
@@ -101,57 +151,1016 @@ class GolangGenerator : public Generator {
 
   void generate_enum(std::ostream& ostream,
                      const std::shared_ptr<EnumType>& enum_type) override {
-    auto capitalized_name = capitalize(enum_type->get_name());
-    ostream << "type " << capitalized_name << " int32" << NL;
+    const auto& lowered_enum = lowered(enum_type.get());
+    ostream << "type " << lowered_enum.name << " int32" << NL;
     ostream << "const (" << NL;
-    for (const auto& field : enum_type->get_fields()) {
-      for (const auto& comment : field.get_comments()) {
+    const auto& fields = enum_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      for (const auto& comment : fields[i].get_comments()) {
         ostream << single_line_comment(comment) << NL;
       }
-      ostream << capitalized_name << "_" << field.get_name() << " "
-              << capitalized_name << " = " << field.get_value() << NL;
+      ostream << lowered_enum.fields[i].name << " " << lowered_enum.name
+              << " = " << fields[i].get_value() << NL;
     }
     ostream << ")" << NL;
   }
 
  private:
-  static std::string gen_oneof_name(const std::string& struct_name,
-                                    const std::string& field_name) {
-    return "is" + capitalize(struct_name) + "_" + capitalize(field_name);
+  [[nodiscard]] const std::string& type_to_go_type(const Type* type) const {
+    return render(type);
+  }
+
+  // The JSON codec, with the `go_json_codec` option.
+  //
+  // Every struct gets `MarshalJSON` and `UnmarshalJSON`, called by
+  // `encoding/json` in place of its reflection. They write and read the
+  // fields with code specialized to their types, through `AppendJSON` and
+  // `decodeJSON`. The JSON is the one of `encoding/json` for the same
+  // structs, with the keys of the `json` tags, except that a oneof is
+  // written as an object with the key of its alternative, e.g.
+  // `{"name":"x"}`, and can be read back, and that map keys are not sorted.
+  // Unknown keys are skipped. Struct types of other documents, and `any`
+  // values, still go through `encoding/json`.
+  //
+  // `json.Marshal` validates the output of `MarshalJSON` again, hot paths
+  // call `AppendJSON` with a reused buffer instead.
+  //
+  // The functions of the generated code use `b` for the output and `d` for
+  // the decoder, named after the document by `json_prefix`, so that several
+  // documents can be generated into one package.
+
+  // Emitted at the end of the document: the decoder and the encoding
+  // functions used by the methods.
+  void generate_json_runtime(std::ostream& ostream) const {
+    std::string_view runtime = kJsonRuntime;
+    for (auto pos = runtime.find('$'); pos != std::string_view::npos;
+         pos = runtime.find('$')) {
+      ostream << runtime.substr(0, pos) << json_prefix_;
+      runtime.remove_prefix(pos + 1);
+    }
+    ostream << runtime;
+  }
+
+  void generate_json_methods(std::ostream& ostream,
+                             const StructType& struct_type) const {
+    const auto& lowered_struct = lowered(&struct_type);
+    const auto& name = lowered_struct.name;
+    const auto& fields = struct_type.get_fields();
+
+    ostream << "func (m " << name << ") MarshalJSON() ([]byte, error) {" << NL
+            << INDENT_1 << "return m.AppendJSON(make([]byte, 0, 64))" << NL
+            << "}" << NL2;
+    ostream << "func (m *" << name << ") AppendJSON(b []byte) ([]byte, error) {"
+            << NL << INDENT_1 << "var err error" << NL;
+    if (fields.empty()) {
+      ostream << INDENT_1 << "b = append(b, \"{}\"...)" << NL;
+    }
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto& field = fields[i];
+      const auto* type = field.get_type().get();
+      auto value = "m." + lowered_struct.fields[i].name;
+      ostream << INDENT_1 << "b = append(b, `" << (i == 0 ? "{" : ",") << "\""
+              << field.get_name() << "\":`...)" << NL;
+      if (is_pointer(field)) {
+        ostream << INDENT_1 << "if " << value << " == nil {" << NL << INDENT_2
+                << "b = append(b, \"null\"...)" << NL << INDENT_1 << "} else {"
+                << NL;
+        encode_json(ostream, type, "(*" + value + ")", 2);
+        ostream << INDENT_1 << "}" << NL;
+      } else {
+        encode_json(ostream, type, value, 1);
+      }
+    }
+    if (!fields.empty()) {
+      ostream << INDENT_1 << "b = append(b, '}')" << NL;
+    }
+    ostream << INDENT_1 << "return b, err" << NL << "}" << NL2;
+
+    ostream << "func (m *" << name << ") UnmarshalJSON(data []byte) error {"
+            << NL << INDENT_1 << "d := " << json_prefix_
+            << "JSONDecoder{data: data}" << NL << INDENT_1
+            << "if err := m.decodeJSON(&d); err != nil {" << NL << INDENT_2
+            << "return err" << NL << INDENT_1 << "}" << NL << INDENT_1
+            << "return d.end()" << NL << "}" << NL2;
+    ostream << "func (m *" << name << ") decodeJSON(d *" << json_prefix_
+            << "JSONDecoder) error {" << NL << INDENT_1 << "if d.null() {"
+            << NL << INDENT_2 << "return nil" << NL << INDENT_1 << "}" << NL
+            << INDENT_1 << "if err := d.open('{'); err != nil {" << NL
+            << INDENT_2 << "return err" << NL << INDENT_1 << "}" << NL
+            << INDENT_1 << "for first := true; ; first = false {" << NL;
+    json_next_member(ostream, "'}'", "first", "return nil", 2);
+    ostream << INDENT_2 << "switch string(key) {" << NL;
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto& field = fields[i];
+      const auto* type = field.get_type().get();
+      auto value = "m." + lowered_struct.fields[i].name;
+      ostream << INDENT_2 << "case \"" << field.get_name() << "\":" << NL;
+      if (is_pointer(field)) {
+        ostream << INDENT_3 << "if d.null() {" << NL << INDENT_4 << value
+                << " = nil" << NL << INDENT_3 << "} else {" << NL << INDENT_4
+                << value << " = new("
+                << (type->is_oneof() ? lowered_struct.fields[i].oneof_name
+                                     : type_to_go_type(type))
+                << ")" << NL;
+        decode_json(ostream, type, "(*" + value + ")", 4);
+        ostream << INDENT_3 << "}" << NL;
+      } else {
+        decode_json(ostream, type, value, 3);
+      }
+    }
+    ostream << INDENT_2 << "default:" << NL << INDENT_3
+            << "if err := d.skip(); err != nil {" << NL << INDENT_4
+            << "return err" << NL << INDENT_3 << "}" << NL << INDENT_2 << "}"
+            << NL << INDENT_1 << "}" << NL << "}" << NL2;
+  }
+
+  // Appends `value`, a Go expression of `type`, to `b`.
+  void encode_json(std::ostream& ostream, const Type* type,
+                   const std::string& value, std::size_t level) const {
+    auto indent = indentation(level);
+    auto var = std::to_string(level);
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+        switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            ostream << indent << "b = strconv.AppendBool(b, " << value << ")"
+                    << NL;
+            break;
+          case PrimitiveType::TypeKind::I32:
+          case PrimitiveType::TypeKind::I64:
+            ostream << indent << "b = strconv.AppendInt(b, int64(" << value
+                    << "), 10)" << NL;
+            break;
+          case PrimitiveType::TypeKind::U32:
+          case PrimitiveType::TypeKind::U64:
+            ostream << indent << "b = strconv.AppendUint(b, uint64(" << value
+                    << "), 10)" << NL;
+            break;
+          case PrimitiveType::TypeKind::Float:
+            json_check(ostream,
+                       "b, err = " + json_prefix_ + "JSONAppendFloat(b, " +
+                           value + ")",
+                       "return nil, err", level);
+            break;
+          case PrimitiveType::TypeKind::String:
+            ostream << indent << "b = " << json_prefix_
+                    << "JSONAppendString(b, " << value << ")" << NL;
+            break;
+          case PrimitiveType::TypeKind::Any:
+            json_check(
+                ostream,
+                "b, err = " + json_prefix_ + "JSONAppendAny(b, " + value + ")",
+                "return nil, err", level);
+            break;
+        }
+        break;
+      case Type::Kind::Enum:
+        ostream << indent << "b = strconv.AppendInt(b, int64(" << value
+                << "), 10)" << NL;
+        break;
+      case Type::Kind::Struct:
+        json_check(ostream,
+                   declared_here(type)
+                       ? "b, err = " + value + ".AppendJSON(b)"
+                       : "b, err = " + json_prefix_ + "JSONAppendAny(b, &" +
+                             value + ")",
+                   "return nil, err", level);
+        break;
+      case Type::Kind::List: {
+        auto index = "i" + var;
+        ostream << indent << "if " << value << " == nil {" << NL << indent
+                << INDENT_1 << "b = append(b, \"null\"...)" << NL << indent
+                << "} else {" << NL << indent << INDENT_1
+                << "b = append(b, '[')" << NL << indent << INDENT_1 << "for "
+                << index << " := range " << value << " {" << NL << indent
+                << INDENT_2 << "if " << index << " > 0 {" << NL << indent
+                << INDENT_3 << "b = append(b, ',')" << NL << indent << INDENT_2
+                << "}" << NL;
+        encode_json(ostream,
+                    static_cast<const ListType*>(type)->get_elem_type().get(),
+                    value + "[" + index + "]", level + 2);
+        ostream << indent << INDENT_1 << "}" << NL << indent << INDENT_1
+                << "b = append(b, ']')" << NL << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Map: {
+        const auto* map = static_cast<const MapType*>(type);
+        auto key = "k" + var;
+        auto element = "v" + var;
+        ostream << indent << "if " << value << " == nil {" << NL << indent
+                << INDENT_1 << "b = append(b, \"null\"...)" << NL << indent
+                << "} else {" << NL << indent << INDENT_1
+                << "b = append(b, '{')" << NL << indent << INDENT_1 << "for "
+                << key << ", " << element << " := range " << value << " {"
+                << NL;
+        encode_json_key(ostream, map->get_key_type().get(), key, level + 2);
+        ostream << indent << INDENT_2 << "b = append(b, ':')" << NL;
+        encode_json(ostream, map->get_value_type().get(), element, level + 2);
+        // The comma after the last member becomes the closing brace.
+        ostream << indent << INDENT_2 << "b = append(b, ',')" << NL << indent
+                << INDENT_1 << "}" << NL << indent << INDENT_1
+                << "if b[len(b)-1] == ',' {" << NL << indent << INDENT_2
+                << "b[len(b)-1] = '}'" << NL << indent << INDENT_1
+                << "} else {" << NL << indent << INDENT_2
+                << "b = append(b, '}')" << NL << indent << INDENT_1 << "}"
+                << NL << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Oneof: {
+        const auto* oneof = static_cast<const OneofType*>(type);
+        const auto& lowered_oneof = lowered(oneof);
+        const auto& alternatives = oneof->get_fields();
+        auto alternative = "v" + var;
+        ostream << indent << "switch " << alternative << " := " << value
+                << ".(type) {" << NL << indent << "case nil:" << NL << indent
+                << INDENT_1 << "b = append(b, \"null\"...)" << NL;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          ostream << indent << "case *" << lowered_oneof.fields[i].wrapper_name
+                  << ":" << NL << indent << INDENT_1 << "b = append(b, `{\""
+                  << alternatives[i].get_name() << "\":`...)" << NL;
+          encode_json(ostream, alternatives[i].get_type().get(),
+                      alternative + "." + lowered_oneof.fields[i].name,
+                      level + 1);
+          ostream << indent << INDENT_1 << "b = append(b, '}')" << NL;
+        }
+        ostream << indent << "}" << NL;
+        break;
+      }
+    }
+  }
+
+  // Appends `key`, a map key of `type`, as a string.
+  void encode_json_key(std::ostream& ostream, const PrimitiveType* type,
+                       const std::string& key, std::size_t level) const {
+    auto indent = indentation(level);
+    std::string append;
+    switch (type->get_type_kind()) {
+      case PrimitiveType::TypeKind::Bool:
+        append = "strconv.AppendBool(b, " + key + ")";
+        break;
+      case PrimitiveType::TypeKind::I32:
+      case PrimitiveType::TypeKind::I64:
+        append = "strconv.AppendInt(b, int64(" + key + "), 10)";
+        break;
+      case PrimitiveType::TypeKind::U32:
+      case PrimitiveType::TypeKind::U64:
+        append = "strconv.AppendUint(b, uint64(" + key + "), 10)";
+        break;
+      case PrimitiveType::TypeKind::Float:
+        append = "strconv.AppendFloat(b, " + key + ", 'g', -1, 64)";
+        break;
+      case PrimitiveType::TypeKind::String:
+        ostream << indent << "b = " << json_prefix_ << "JSONAppendString(b, "
+                << key << ")" << NL;
+        return;
+      case PrimitiveType::TypeKind::Any:
+        ostream << indent << "if s, ok := " << key << ".(string); ok {" << NL
+                << indent << INDENT_1 << "b = " << json_prefix_
+                << "JSONAppendString(b, s)" << NL << indent << "} else {"
+                << NL << indent << INDENT_1
+                << "return nil, errors.New(\"json: unsupported map key\")"
+                << NL << indent << "}" << NL;
+        return;
+    }
+    ostream << indent << "b = append(b, '\"')" << NL << indent << "b = "
+            << append << NL << indent << "b = append(b, '\"')" << NL;
+  }
+
+  // Reads a value of `type` into `value`, an assignable Go expression.
+  void decode_json(std::ostream& ostream, const Type* type,
+                   const std::string& value, std::size_t level) const {
+    auto indent = indentation(level);
+    auto var = std::to_string(level);
+    switch (type->kind()) {
+      case Type::Kind::Primitive: {
+        std::string read;
+        switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            read = "d.boolean()";
+            break;
+          case PrimitiveType::TypeKind::I32:
+            read = "d.int(32)";
+            break;
+          case PrimitiveType::TypeKind::I64:
+            read = "d.int(64)";
+            break;
+          case PrimitiveType::TypeKind::U32:
+            read = "d.uint(32)";
+            break;
+          case PrimitiveType::TypeKind::U64:
+            read = "d.uint(64)";
+            break;
+          case PrimitiveType::TypeKind::Float:
+            read = "d.float()";
+            break;
+          case PrimitiveType::TypeKind::String:
+            read = "d.str()";
+            break;
+          case PrimitiveType::TypeKind::Any:
+            read = "d.any()";
+            break;
+        }
+        json_read(ostream, read, value + " = " + type_to_go_type(type) + "(v)",
+                  level);
+        break;
+      }
+      case Type::Kind::Enum:
+        json_read(ostream, "d.int(32)",
+                  value + " = " + type_to_go_type(type) + "(v)", level);
+        break;
+      case Type::Kind::Struct:
+        if (declared_here(type)) {
+          json_check(ostream, "err := " + value + ".decodeJSON(d)",
+                     "return err", level);
+        } else {
+          ostream << indent << "if v, err := d.raw(); err != nil {" << NL
+                  << indent << INDENT_1 << "return err" << NL << indent
+                  << "} else if err := json.Unmarshal(v, &" << value
+                  << "); err != nil {" << NL << indent << INDENT_1
+                  << "return err" << NL << indent << "}" << NL;
+        }
+        break;
+      case Type::Kind::List: {
+        const auto* elem_type =
+            static_cast<const ListType*>(type)->get_elem_type().get();
+        auto element = "e" + var;
+        json_open(ostream, value, "'['", level);
+        ostream << indent << INDENT_1 << "if " << value << " == nil {" << NL
+                << indent << INDENT_2 << value << " = "
+                << type_to_go_type(type) << "{}" << NL << indent << INDENT_1
+                << "} else {" << NL << indent << INDENT_2 << value << " = "
+                << value << "[:0]" << NL << indent << INDENT_1 << "}" << NL
+                << indent << INDENT_1 << "for first := true; ; first = false {"
+                << NL << indent << INDENT_2 << "if more, err := d.more(']', "
+                << "first); err != nil {" << NL << indent << INDENT_3
+                << "return err" << NL << indent << INDENT_2
+                << "} else if !more {" << NL << indent << INDENT_3 << "break"
+                << NL << indent << INDENT_2 << "}" << NL << indent << INDENT_2
+                << "var " << element << " " << type_to_go_type(elem_type) << NL;
+        decode_json(ostream, elem_type, element, level + 2);
+        ostream << indent << INDENT_2 << value << " = append(" << value << ", "
+                << element << ")" << NL << indent << INDENT_1 << "}" << NL
+                << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Map: {
+        const auto* map = static_cast<const MapType*>(type);
+        auto key = "k" + var;
+        auto element = "v" + var;
+        json_open(ostream, value, "'{'", level);
+        ostream << indent << INDENT_1 << "if " << value << " == nil {" << NL
+                << indent << INDENT_2 << value << " = make("
+                << type_to_go_type(type) << ")" << NL << indent << INDENT_1
+                << "}" << NL << indent << INDENT_1
+                << "for first := true; ; first = false {" << NL;
+        json_next_member(ostream, "'}'", "first", "break", level + 2);
+        decode_json_key(ostream, map->get_key_type().get(), key, level + 2);
+        ostream << indent << INDENT_2 << "var " << element << " "
+                << type_to_go_type(map->get_value_type().get()) << NL;
+        decode_json(ostream, map->get_value_type().get(), element, level + 2);
+        ostream << indent << INDENT_2 << value << "[" << key
+                << "] = " << element << NL << indent << INDENT_1 << "}" << NL
+                << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Oneof: {
+        const auto* oneof = static_cast<const OneofType*>(type);
+        const auto& lowered_oneof = lowered(oneof);
+        const auto& alternatives = oneof->get_fields();
+        auto wrapper = "w" + var;
+        json_open(ostream, value, "'{'", level);
+        ostream << indent << INDENT_1 << value << " = nil" << NL << indent
+                << INDENT_1 << "if more, err := d.more('}', true); "
+                << "err != nil {" << NL << indent << INDENT_2 << "return err"
+                << NL << indent << INDENT_1 << "} else if more {" << NL
+                << indent << INDENT_2 << "key, err := d.key()" << NL << indent
+                << INDENT_2 << "if err != nil {" << NL << indent << INDENT_3
+                << "return err" << NL << indent << INDENT_2 << "}" << NL
+                << indent << INDENT_2 << "switch string(key) {" << NL;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto& lowered_alternative = lowered_oneof.fields[i];
+          ostream << indent << INDENT_2 << "case \""
+                  << alternatives[i].get_name() << "\":" << NL << indent
+                  << INDENT_3 << wrapper << " := &"
+                  << lowered_alternative.wrapper_name << "{}" << NL;
+          decode_json(ostream, alternatives[i].get_type().get(),
+                      wrapper + "." + lowered_alternative.name, level + 3);
+          ostream << indent << INDENT_3 << value << " = " << wrapper << NL;
+        }
+        ostream << indent << INDENT_2 << "default:" << NL << indent << INDENT_3
+                << "return d.error(\"unknown alternative \" + "
+                << "strconv.Quote(string(key)))" << NL << indent << INDENT_2
+                << "}" << NL << indent << INDENT_2
+                << "if more, err := d.more('}', false); err != nil {" << NL
+                << indent << INDENT_3 << "return err" << NL << indent
+                << INDENT_2 << "} else if more {" << NL << indent << INDENT_3
+                << "return d.error(\"more than one alternative\")" << NL
+                << indent << INDENT_2 << "}" << NL << indent << INDENT_1 << "}"
+                << NL << indent << "}" << NL;
+        break;
+      }
+    }
+  }
+
+  // Converts `key`, the bytes of a member name, to `var` of the map key
+  // `type`.
+  void decode_json_key(std::ostream& ostream, const PrimitiveType* type,
+                       const std::string& var, std::size_t level) const {
+    auto indent = indentation(level);
+    std::string parse;
+    switch (type->get_type_kind()) {
+      case PrimitiveType::TypeKind::Bool:
+        parse = "strconv.ParseBool(string(key))";
+        break;
+      case PrimitiveType::TypeKind::I32:
+        parse = "strconv.ParseInt(string(key), 10, 32)";
+        break;
+      case PrimitiveType::TypeKind::I64:
+        parse = "strconv.ParseInt(string(key), 10, 64)";
+        break;
+      case PrimitiveType::TypeKind::U32:
+        parse = "strconv.ParseUint(string(key), 10, 32)";
+        break;
+      case PrimitiveType::TypeKind::U64:
+        parse = "strconv.ParseUint(string(key), 10, 64)";
+        break;
+      case PrimitiveType::TypeKind::Float:
+        parse = "strconv.ParseFloat(string(key), 64)";
+        break;
+      case PrimitiveType::TypeKind::String:
+        ostream << indent << var << " := string(key)" << NL;
+        return;
+      case PrimitiveType::TypeKind::Any:
+        ostream << indent << var << " := interface{}(string(key))" << NL;
+        return;
+    }
+    ostream << indent << "n" << var << ", err := " << parse << NL << indent
+            << "if err != nil {" << NL << indent << INDENT_1
+            << "return d.error(\"invalid map key \" + "
+            << "strconv.Quote(string(key)))" << NL << indent << "}" << NL
+            << indent << var << " := " << type_to_go_type(type) << "(n" << var
+            << ")" << NL;
+  }
+
+  // Runs `statement`, then `failure` if it set `err`.
+  void json_check(std::ostream& ostream, const std::string& statement,
+                  const char* failure, std::size_t level) const {
+    auto indent = indentation(level);
+    ostream << indent << "if " << statement << "; err != nil {" << NL << indent
+            << INDENT_1 << failure << NL << indent << "}" << NL;
   }
 
-  [[nodiscard]] static std::string type_to_go_type(Type* type) {
-    if (type->is_primitive()) {
-      auto primitive = dynamic_cast<PrimitiveType*>(type);
-      if (primitive->is_bool()) {
-        return "bool";
-      } else if (primitive->is_i32()) {
-        return "int32";
-      } else if (primitive->is_u32()) {
-        return "uint32";
-      } else if (primitive->is_i64()) {
-        return "int64";
-      } else if (primitive->is_u64()) {
-        return "uint64";
-      } else if (primitive->is_float()) {
-        return "float64";
-      } else if (primitive->is_string()) {
-        return "string";
-      } else if (primitive->is_any()) {
-        return "interface{}";
-      }
-    } else if (type->is_struct() || type->is_enum()) {
-      return capitalize(type->get_name());
-    } else if (type->is_list()) {
-      auto list = dynamic_cast<ListType*>(type);
-      return "[]" + type_to_go_type(list->get_elem_type().get());
-    } else if (type->is_map()) {
-      auto map = dynamic_cast<MapType*>(type);
-      return "map[" + type_to_go_type(map->get_key_type().get()) + "]" +
-             type_to_go_type(map->get_value_type().get());
+  // Reads `v` by `read`, then runs `assign`.
+  void json_read(std::ostream& ostream, const std::string& read,
+                 const std::string& assign, std::size_t level) const {
+    auto indent = indentation(level);
+    ostream << indent << "if v, err := " << read << "; err != nil {" << NL
+            << indent << INDENT_1 << "return err" << NL << indent << "} else {"
+            << NL << indent << INDENT_1 << assign << NL << indent << "}" << NL;
+  }
+
+  // Opens the array or object read into `value`, nil for null. The caller
+  // reads the elements and closes the block opened.
+  void json_open(std::ostream& ostream, const std::string& value,
+                 const std::string& open, std::size_t level) const {
+    auto indent = indentation(level);
+    ostream << indent << "if d.null() {" << NL << indent << INDENT_1 << value
+            << " = nil" << NL << indent << "} else if err := d.open(" << open
+            << "); err != nil {" << NL << indent << INDENT_1 << "return err"
+            << NL << indent << "} else {" << NL;
+  }
+
+  // In a loop over the members of an object: runs `done` after the last
+  // member, reads the name of the next one into `key` otherwise.
+  void json_next_member(std::ostream& ostream, const std::string& end,
+                        const std::string& first, const std::string& done,
+                        std::size_t level) const {
+    auto indent = indentation(level);
+    ostream << indent << "if more, err := d.more(" << end << ", " << first
+            << "); err != nil {" << NL << indent << INDENT_1 << "return err"
+            << NL << indent << "} else if !more {" << NL << indent << INDENT_1
+            << done << NL << indent << "}" << NL << indent
+            << "key, err := d.key()" << NL << indent << "if err != nil {" << NL
+            << indent << INDENT_1 << "return err" << NL << indent << "}" << NL;
+  }
+
+  // Whether `field` is a pointer in its struct, see `generate_struct`.
+  [[nodiscard]] static bool is_pointer(const Field& field) {
+    return field.is_optional() && !field.get_type()->is_map() &&
+           !field.get_type()->is_list();
+  }
+
+  // Whether the struct `type` is declared in the document being generated,
+  // and so has the methods of the codec.
+  [[nodiscard]] bool declared_here(const Type* type) const {
+    auto source = declaration_of(*type)->get_source();
+    return source == source_ || (source && source_ && *source == *source_);
+  }
+
+  // The document name, as the start of a Go identifier.
+  [[nodiscard]] static std::string json_prefix(const Document& document) {
+    std::string prefix;
+    if (document.get_source()) {
+      for (char c : camelcase(document.get_source()->stem().string())) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+          prefix.push_back(c);
+        }
+      }
+    }
+    if (prefix.empty() ||
+        std::isdigit(static_cast<unsigned char>(prefix[0]))) {
+      prefix.insert(0, "toolman");
+    }
+    return decapitalize(prefix);
+  }
+
+  [[nodiscard]] static std::string indentation(std::size_t level) {
+    std::string indent;
+    for (std::size_t i = 0; i < level; ++i) {
+      indent += INDENT_1;
+    }
+    return indent;
+  }
+
+  [[nodiscard]] std::string render_type(const Type* type,
+                                        unsigned flags) const override {
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+        switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            return "bool";
+          case PrimitiveType::TypeKind::I32:
+            return "int32";
+          case PrimitiveType::TypeKind::U32:
+            return "uint32";
+          case PrimitiveType::TypeKind::I64:
+            return "int64";
+          case PrimitiveType::TypeKind::U64:
+            return "uint64";
+          case PrimitiveType::TypeKind::Float:
+            return "float64";
+          case PrimitiveType::TypeKind::String:
+            return "string";
+          case PrimitiveType::TypeKind::Any:
+            return "interface{}";
+        }
+        break;
+      case Type::Kind::Struct:
+      case Type::Kind::Enum:
+        return capitalize(type->get_name());
+      case Type::Kind::List: {
+        auto list = static_cast<const ListType*>(type);
+        return "[]" + type_to_go_type(list->get_elem_type().get());
+      }
+      case Type::Kind::Map: {
+        auto map = static_cast<const MapType*>(type);
+        return "map[" + type_to_go_type(map->get_key_type().get()) + "]" +
+               type_to_go_type(map->get_value_type().get());
+      }
+      case Type::Kind::Oneof:
+        break;
     }
     return "";
   }
+
+  // `$` stands for the prefix of the document.
+  static constexpr char kJsonRuntime[] = R"go(type $JSONDecoder struct {
+    data []byte
+    pos  int
+}
+
+func (d *$JSONDecoder) error(what string) error {
+    return errors.New("json: " + what + " at offset " + strconv.Itoa(d.pos))
+}
+
+func (d *$JSONDecoder) space() {
+    for d.pos < len(d.data) {
+        switch d.data[d.pos] {
+        case ' ', '\t', '\n', '\r':
+            d.pos++
+        default:
+            return
+        }
+    }
+}
+
+// null reads a null, if the next value is one.
+func (d *$JSONDecoder) null() bool {
+    d.space()
+    if len(d.data)-d.pos >= 4 && string(d.data[d.pos:d.pos+4]) == "null" {
+        d.pos += 4
+        return true
+    }
+    return false
+}
+
+func (d *$JSONDecoder) open(c byte) error {
+    d.space()
+    if d.pos >= len(d.data) || d.data[d.pos] != c {
+        return d.error("expected " + string(c))
+    }
+    d.pos++
+    return nil
+}
+
+// more reports whether an element follows in the array or object closed by
+// end, reading the comma before it or the end.
+func (d *$JSONDecoder) more(end byte, first bool) (bool, error) {
+    d.space()
+    if d.pos >= len(d.data) {
+        return false, d.error("unexpected end")
+    }
+    if d.data[d.pos] == end {
+        d.pos++
+        return false, nil
+    }
+    if !first {
+        if d.data[d.pos] != ',' {
+            return false, d.error("expected , or " + string(end))
+        }
+        d.pos++
+    }
+    return true, nil
+}
+
+// key reads a member name and the colon after it. The name aliases the
+// input unless it has escapes.
+func (d *$JSONDecoder) key() ([]byte, error) {
+    d.space()
+    name, err := d.bytes()
+    if err != nil {
+        return nil, err
+    }
+    if err := d.open(':'); err != nil {
+        return nil, err
+    }
+    return name, nil
+}
+
+// bytes reads a string. It aliases the input unless it has escapes.
+func (d *$JSONDecoder) bytes() ([]byte, error) {
+    if d.pos >= len(d.data) || d.data[d.pos] != '"' {
+        return nil, d.error("expected string")
+    }
+    d.pos++
+    start := d.pos
+    for d.pos < len(d.data) {
+        switch c := d.data[d.pos]; {
+        case c == '"':
+            d.pos++
+            return d.data[start : d.pos-1], nil
+        case c == '\\':
+            return d.unescape(start)
+        case c < 0x20:
+            return nil, d.error("control character in string")
+        }
+        d.pos++
+    }
+    return nil, d.error("unterminated string")
+}
+
+func (d *$JSONDecoder) unescape(start int) ([]byte, error) {
+    out := append([]byte(nil), d.data[start:d.pos]...)
+    for d.pos < len(d.data) {
+        c := d.data[d.pos]
+        d.pos++
+        switch {
+        case c == '"':
+            return out, nil
+        case c < 0x20:
+            return nil, d.error("control character in string")
+        case c != '\\':
+            out = append(out, c)
+            continue
+        }
+        if d.pos >= len(d.data) {
+            break
+        }
+        c = d.data[d.pos]
+        d.pos++
+        switch c {
+        case '"', '\\', '/':
+            out = append(out, c)
+        case 'b':
+            out = append(out, '\b')
+        case 'f':
+            out = append(out, '\f')
+        case 'n':
+            out = append(out, '\n')
+        case 'r':
+            out = append(out, '\r')
+        case 't':
+            out = append(out, '\t')
+        case 'u':
+            r, ok := d.hex4()
+            if !ok {
+                return nil, d.error("invalid escape")
+            }
+            // A surrogate pair encodes a code point beyond the BMP.
+            if r >= 0xD800 && r < 0xDC00 && len(d.data)-d.pos >= 6 &&
+                d.data[d.pos] == '\\' && d.data[d.pos+1] == 'u' {
+                d.pos += 2
+                low, ok := d.hex4()
+                if !ok {
+                    return nil, d.error("invalid escape")
+                }
+                r = 0x10000 + (r-0xD800)<<10 + (low - 0xDC00)
+            }
+            out = append(out, string(r)...)
+        default:
+            return nil, d.error("invalid escape")
+        }
+    }
+    return nil, d.error("unterminated string")
+}
+
+func (d *$JSONDecoder) hex4() (rune, bool) {
+    if len(d.data)-d.pos < 4 {
+        return 0, false
+    }
+    var r rune
+    for _, c := range d.data[d.pos : d.pos+4] {
+        r <<= 4
+        switch {
+        case '0' <= c && c <= '9':
+            r |= rune(c - '0')
+        case 'a' <= c && c <= 'f':
+            r |= rune(c - 'a' + 10)
+        case 'A' <= c && c <= 'F':
+            r |= rune(c - 'A' + 10)
+        default:
+            return 0, false
+        }
+    }
+    d.pos += 4
+    return r, true
+}
+
+// The readers of primitive values return the zero value for null.
+
+func (d *$JSONDecoder) str() (string, error) {
+    if d.null() {
+        return "", nil
+    }
+    b, err := d.bytes()
+    return string(b), err
+}
+
+func (d *$JSONDecoder) boolean() (bool, error) {
+    if d.null() {
+        return false, nil
+    }
+    rest := d.data[d.pos:]
+    if len(rest) >= 4 && string(rest[:4]) == "true" {
+        d.pos += 4
+        return true, nil
+    }
+    if len(rest) >= 5 && string(rest[:5]) == "false" {
+        d.pos += 5
+        return false, nil
+    }
+    return false, d.error("expected boolean")
+}
+
+// number reads the text of a number. Like encoding/json, it only accepts
+// the JSON grammar, so `01`, `1.`, `.5` and `+1` are errors.
+func (d *$JSONDecoder) number() ([]byte, error) {
+    start := d.pos
+    if d.pos < len(d.data) && d.data[d.pos] == '-' {
+        d.pos++
+    }
+    if d.pos < len(d.data) && d.data[d.pos] == '0' {
+        d.pos++
+    } else if d.digits() == 0 {
+        return nil, d.error("expected number")
+    }
+    if d.pos < len(d.data) && d.data[d.pos] == '.' {
+        d.pos++
+        if d.digits() == 0 {
+            return nil, d.error("expected digit after decimal point")
+        }
+    }
+    if d.pos < len(d.data) && (d.data[d.pos] == 'e' || d.data[d.pos] == 'E') {
+        d.pos++
+        if d.pos < len(d.data) && (d.data[d.pos] == '+' || d.data[d.pos] == '-') {
+            d.pos++
+        }
+        if d.digits() == 0 {
+            return nil, d.error("expected digit in exponent")
+        }
+    }
+    return d.data[start:d.pos], nil
+}
+
+// digits reads a run of decimal digits, returning its length.
+func (d *$JSONDecoder) digits() int {
+    start := d.pos
+    for d.pos < len(d.data) && '0' <= d.data[d.pos] && d.data[d.pos] <= '9' {
+        d.pos++
+    }
+    return d.pos - start
+}
+
+func (d *$JSONDecoder) int(bits int) (int64, error) {
+    if d.null() {
+        return 0, nil
+    }
+    text, err := d.number()
+    if err != nil {
+        return 0, err
+    }
+    n, err := strconv.ParseInt(string(text), 10, bits)
+    if err != nil {
+        return 0, d.error("invalid integer " + strconv.Quote(string(text)))
+    }
+    return n, nil
+}
+
+func (d *$JSONDecoder) uint(bits int) (uint64, error) {
+    if d.null() {
+        return 0, nil
+    }
+    text, err := d.number()
+    if err != nil {
+        return 0, err
+    }
+    n, err := strconv.ParseUint(string(text), 10, bits)
+    if err != nil {
+        return 0, d.error("invalid integer " + strconv.Quote(string(text)))
+    }
+    return n, nil
+}
+
+func (d *$JSONDecoder) float() (float64, error) {
+    if d.null() {
+        return 0, nil
+    }
+    text, err := d.number()
+    if err != nil {
+        return 0, err
+    }
+    f, err := strconv.ParseFloat(string(text), 64)
+    if err != nil {
+        return 0, d.error("invalid number " + strconv.Quote(string(text)))
+    }
+    return f, nil
+}
+
+// skip reads over a value of any type.
+func (d *$JSONDecoder) skip() error {
+    d.space()
+    if d.pos >= len(d.data) {
+        return d.error("unexpected end")
+    }
+    switch c := d.data[d.pos]; c {
+    case '{', '[':
+        end := byte('}')
+        if c == '[' {
+            end = ']'
+        }
+        d.pos++
+        for first := true; ; first = false {
+            more, err := d.more(end, first)
+            if err != nil || !more {
+                return err
+            }
+            if c == '{' {
+                if _, err := d.key(); err != nil {
+                    return err
+                }
+            }
+            if err := d.skip(); err != nil {
+                return err
+            }
+        }
+    case '"':
+        _, err := d.bytes()
+        return err
+    case 't', 'f':
+        _, err := d.boolean()
+        return err
+    case 'n':
+        if d.null() {
+            return nil
+        }
+        return d.error("expected null")
+    default:
+        _, err := d.float()
+        return err
+    }
+}
+
+// raw reads over a value, returning its text.
+func (d *$JSONDecoder) raw() ([]byte, error) {
+    d.space()
+    start := d.pos
+    err := d.skip()
+    return d.data[start:d.pos], err
+}
+
+func (d *$JSONDecoder) any() (interface{}, error) {
+    raw, err := d.raw()
+    if err != nil {
+        return nil, err
+    }
+    var v interface{}
+    err = json.Unmarshal(raw, &v)
+    return v, err
+}
+
+// end checks that nothing follows the value read.
+func (d *$JSONDecoder) end() error {
+    d.space()
+    if d.pos != len(d.data) {
+        return d.error("unexpected data after the value")
+    }
+    return nil
+}
+
+// $JSONAppendString quotes s like encoding/json: invalid UTF-8 becomes
+// U+FFFD, and U+2028 and U+2029 are escaped for JavaScript.
+func $JSONAppendString(b []byte, s string) []byte {
+    const hex = "0123456789abcdef"
+    b = append(b, '"')
+    start := 0
+    for i := 0; i < len(s); {
+        c := s[i]
+        if c >= utf8.RuneSelf {
+            r, size := utf8.DecodeRuneInString(s[i:])
+            switch {
+            case r == utf8.RuneError && size == 1:
+                b = append(b, s[start:i]...)
+                b = append(b, `\ufffd`...)
+            case r == '\u2028' || r == '\u2029':
+                b = append(b, s[start:i]...)
+                b = append(b, '\\', 'u', '2', '0', '2', hex[r&0xF])
+            default:
+                i += size
+                continue
+            }
+            i += size
+            start = i
+            continue
+        }
+        if c >= 0x20 && c != '"' && c != '\\' {
+            i++
+            continue
+        }
+        b = append(b, s[start:i]...)
+        switch c {
+        case '"', '\\':
+            b = append(b, '\\', c)
+        case '\n':
+            b = append(b, '\\', 'n')
+        case '\r':
+            b = append(b, '\\', 'r')
+        case '\t':
+            b = append(b, '\\', 't')
+        default:
+            b = append(b, '\\', 'u', '0', '0', hex[c>>4], hex[c&0xF])
+        }
+        i++
+        start = i
+    }
+    b = append(b, s[start:]...)
+    return append(b, '"')
+}
+
+// $JSONAppendFloat formats f like encoding/json, which rejects NaN and the
+// infinities.
+func $JSONAppendFloat(b []byte, f float64) ([]byte, error) {
+    if math.IsNaN(f) || math.IsInf(f, 0) {
+        return nil, errors.New("json: unsupported value " +
+            strconv.FormatFloat(f, 'g', -1, 64))
+    }
+    format := byte('f')
+    if abs := math.Abs(f); abs != 0 && (abs < 1e-6 || abs >= 1e21) {
+        format = 'e'
+    }
+    b = strconv.AppendFloat(b, f, format, -1, 64)
+    if format == 'e' {
+        // 1e-09 becomes 1e-9.
+        n := len(b)
+        if n >= 4 && b[n-4] == 'e' && b[n-3] == '-' && b[n-2] == '0' {
+            b[n-2] = b[n-1]
+            b = b[:n-1]
+        }
+    }
+    return b, nil
+}
+
+func $JSONAppendAny(b []byte, v interface{}) ([]byte, error) {
+    raw, err := json.Marshal(v)
+    if err != nil {
+        return nil, err
+    }
+    return append(b, raw...), nil
+}
+)go";
+
+  bool json_codec_ = false;
+  std::shared_ptr<std::filesystem::path> source_;
+  std::string json_prefix_;
 };
 }  // namespace toolman::generator
 
@@ -0,0 +1,144 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/grammar_profile.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace toolman {
+
+namespace {
+void print_header(std::ostream& ostream, const char* first_column) {
+  ostream << std::left << std::setw(24) << first_column << std::right
+          << std::setw(10) << "calls" << std::setw(11) << "time(ms)"
+          << std::setw(10) << "SLL-avg" << std::setw(9) << "SLL-max"
+          << std::setw(10) << "LL-calls" << std::setw(9) << "LL-avg"
+          << std::setw(8) << "LL-max" << std::setw(8) << "ambig"
+          << std::setw(8) << "ctx-sen" << std::setw(8) << "errors"
+          << "\n";
+}
+
+double average(std::int64_t total, std::int64_t count) {
+  return count > 0 ? static_cast<double>(total) / static_cast<double>(count)
+                   : 0;
+}
+}  // namespace
+
+void GrammarProfile::Totals::add(const Totals& other) {
+  invocations += other.invocations;
+  time_in_prediction += other.time_in_prediction;
+  sll_total_look += other.sll_total_look;
+  sll_max_look = std::max(sll_max_look, other.sll_max_look);
+  ll_fallbacks += other.ll_fallbacks;
+  ll_total_look += other.ll_total_look;
+  ll_max_look = std::max(ll_max_look, other.ll_max_look);
+  ambiguities += other.ambiguities;
+  context_sensitivities += other.context_sensitivities;
+  errors += other.errors;
+}
+
+void GrammarProfile::start(ToolmanParser* parser) { parser->setProfile(true); }
+
+void GrammarProfile::stop(ToolmanParser* parser) {
+  auto* simulator =
+      parser->getInterpreter<antlr4::atn::ProfilingATNSimulator>();
+  if (simulator == nullptr) {
+    return;
+  }
+  const auto& atn = parser->getATN();
+  if (rule_names_.empty()) {
+    rule_names_ = parser->getRuleNames();
+  }
+  if (decisions_.size() < atn.decisionToState.size()) {
+    decisions_.resize(atn.decisionToState.size());
+    decision_rules_.resize(atn.decisionToState.size());
+  }
+  for (const auto& info : simulator->getDecisionInfo()) {
+    if (info.decision >= decisions_.size()) {
+      continue;
+    }
+    Totals totals;
+    totals.invocations = info.invocations;
+    totals.time_in_prediction = info.timeInPrediction;
+    totals.sll_total_look = info.SLL_TotalLook;
+    totals.sll_max_look = info.SLL_MaxLook;
+    totals.ll_fallbacks = info.LL_Fallback;
+    totals.ll_total_look = info.LL_TotalLook;
+    totals.ll_max_look = info.LL_MaxLook;
+    totals.ambiguities = info.ambiguities.size();
+    totals.context_sensitivities = info.contextSensitivities.size();
+    totals.errors = info.errors.size();
+    decisions_[info.decision].add(totals);
+    decision_rules_[info.decision] =
+        atn.decisionToState[info.decision]->ruleIndex;
+  }
+  ++parses_;
+  // The next parse starts from fresh counts.
+  parser->setProfile(false);
+}
+
+void GrammarProfile::report(std::ostream& ostream) const {
+  ostream << "grammar profile: " << parses_ << " parse(s)\n";
+
+  auto print_row = [&](const std::string& name, const Totals& totals) {
+    ostream << std::left << std::setw(24) << name << std::right
+            << std::setw(10) << totals.invocations << std::setw(11)
+            << std::fixed << std::setprecision(3)
+            << static_cast<double>(totals.time_in_prediction) / 1e6
+            << std::setw(10) << std::setprecision(2)
+            << average(totals.sll_total_look, totals.invocations)
+            << std::setw(9) << totals.sll_max_look << std::setw(10)
+            << totals.ll_fallbacks << std::setw(9)
+            << average(totals.ll_total_look, totals.ll_fallbacks)
+            << std::setw(8) << totals.ll_max_look << std::setw(8)
+            << totals.ambiguities << std::setw(8)
+            << totals.context_sensitivities << std::setw(8) << totals.errors
+            << "\n";
+  };
+  auto rule_name = [&](std::size_t rule) {
+    return rule < rule_names_.size() ? rule_names_[rule]
+                                     : "rule " + std::to_string(rule);
+  };
+
+  std::vector<std::size_t> order(decisions_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+    return decisions_[lhs].time_in_prediction >
+           decisions_[rhs].time_in_prediction;
+  });
+  print_header(ostream, "decision (rule)");
+  for (auto decision : order) {
+    if (decisions_[decision].invocations == 0) {
+      continue;
+    }
+    print_row(std::to_string(decision) + " (" +
+                  rule_name(decision_rules_[decision]) + ")",
+              decisions_[decision]);
+  }
+
+  std::vector<Totals> rules(rule_names_.size());
+  for (std::size_t decision = 0; decision < decisions_.size(); ++decision) {
+    auto rule = decision_rules_[decision];
+    if (rule >= rules.size()) {
+      rules.resize(rule + 1);
+    }
+    rules[rule].add(decisions_[decision]);
+  }
+  ostream << "\n";
+  print_header(ostream, "rule");
+  Totals sum;
+  for (std::size_t rule = 0; rule < rules.size(); ++rule) {
+    if (rules[rule].invocations == 0) {
+      continue;
+    }
+    print_row(rule_name(rule), rules[rule]);
+    sum.add(rules[rule]);
+  }
+  print_row("total", sum);
+  ostream << std::flush;
+}
+
+}  // namespace toolman
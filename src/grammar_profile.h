@@ -0,0 +1,59 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_GRAMMAR_PROFILE_H_
+#define TOOLMAN_GRAMMAR_PROFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ToolmanParser.h"
+
+namespace toolman {
+
+// Statistics of the prediction decisions of ToolmanParser, collected with
+// ANTLR's profiling ATN simulator and summed over every profiled parse, see
+// `toolman --profile-grammar`.
+class GrammarProfile final {
+ public:
+  // Switches `parser` to the profiling simulator for its next parse.
+  static void start(ToolmanParser* parser);
+
+  // Adds the decisions profiled by `parser` since `start` and switches it
+  // back to the regular simulator.
+  void stop(ToolmanParser* parser);
+
+  // Prints a table per decision, slowest first, then a table per rule.
+  void report(std::ostream& ostream) const;
+
+ private:
+  struct Totals {
+    std::int64_t invocations = 0;
+    // Nanoseconds spent in adaptivePredict.
+    std::int64_t time_in_prediction = 0;
+    std::int64_t sll_total_look = 0;
+    std::int64_t sll_max_look = 0;
+    std::int64_t ll_fallbacks = 0;
+    std::int64_t ll_total_look = 0;
+    std::int64_t ll_max_look = 0;
+    std::size_t ambiguities = 0;
+    std::size_t context_sensitivities = 0;
+    std::size_t errors = 0;
+
+    void add(const Totals& other);
+  };
+
+  std::size_t parses_ = 0;
+  // Indexed by decision number.
+  std::vector<Totals> decisions_;
+  std::vector<std::size_t> decision_rules_;
+  std::vector<std::string> rule_names_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_GRAMMAR_PROFILE_H_
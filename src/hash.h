@@ -0,0 +1,40 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_HASH_H_
+#define TOOLMAN_HASH_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace toolman::hash {
+
+constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
+
+// 64-bit FNV-1a of `data`, continuing from `seed` to hash several pieces.
+// Not cryptographic, only used to notice changed content.
+constexpr std::uint64_t fnv1a(std::string_view data,
+                              std::uint64_t seed = kFnvOffsetBasis) {
+  for (auto c : data) {
+    seed ^= static_cast<unsigned char>(c);
+    seed *= kFnvPrime;
+  }
+  return seed;
+}
+
+// Lower case hexadecimal, 16 digits.
+inline std::string to_hex(std::uint64_t hash) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 15; i >= 0; --i, hash >>= 4) {
+    hex[i] = kDigits[hash & 0xf];
+  }
+  return hex;
+}
+
+}  // namespace toolman::hash
+
+#endif  // TOOLMAN_HASH_H_
@@ -16,10 +16,10 @@ namespace toolman {
 
 struct ImportName {
   bool operator<(const ImportName& rhs) const {
-    if (rhs.original_name == rhs.original_name) {
-      return rhs.local_name < rhs.local_name;
+    if (original_name == rhs.original_name) {
+      return local_name < rhs.local_name;
     }
-    return rhs.original_name < rhs.original_name;
+    return original_name < rhs.original_name;
   }
 
   bool operator==(const ImportName& rhs) const {
@@ -55,12 +55,12 @@ class Import {
     namespaces_imports_.emplace(filename);
   }
 
-  [[nodiscard]] std::map<std::string, std::set<ImportName>>
+  [[nodiscard]] const std::map<std::string, std::set<ImportName>>&
   get_regular_imports() const {
     return regular_imports_;
   }
 
-  [[nodiscard]] std::set<std::string> get_namespaces_imports() const {
+  [[nodiscard]] const std::set<std::string>& get_namespaces_imports() const {
     return namespaces_imports_;
   }
 
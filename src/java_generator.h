@@ -15,25 +15,60 @@
 #include "src/map_type.h"
 #include "src/primitive_type.h"
 #include "src/scope.h"
+#include "src/type_visitor.h"
 
 namespace toolman::generator {
 class JavaGenerator : public Generator {
  protected:
+  [[nodiscard]] std::string field_name(
+      const std::string &name) const override {
+    return camelcase(name);
+  }
+
+  [[nodiscard]] std::string enum_field_name(
+      const std::string &enum_name, const std::string &name) const override {
+    return camelcase(name);
+  }
+
+  [[nodiscard]] std::string oneof_name(
+      const std::string &struct_name,
+      const std::string &field_name) const override {
+    return "Is" + capitalize(camelcase(struct_name)) +
+           capitalize(camelcase(field_name));
+  }
+
+  [[nodiscard]] std::string oneof_wrapper_name(
+      const std::string &struct_name,
+      const std::string &field_name) const override {
+    return capitalize(camelcase(struct_name)) +
+           capitalize(camelcase(field_name));
+  }
+
   void before_generate_document(std::ostream &ostream,
                                 const Document *document) override {
     // process option
+    use_java8_optional_ = false;
+    json_codec_ = false;
     for (const auto &opt : document->get_options()) {
       if (opt->get_name() == buildin::option_use_java8_optional.get_name()) {
         auto bool_opt = std::dynamic_pointer_cast<decltype(
             buildin::option_use_java8_optional)>(opt);
         use_java8_optional_ = bool_opt->get_value();
+      } else if (opt->get_name() ==
+                 buildin::option_java_json_codec.get_name()) {
+        auto bool_opt = std::dynamic_pointer_cast<decltype(
+            buildin::option_java_json_codec)>(opt);
+        json_codec_ = bool_opt->get_value();
       }
     }
+    source_ = document->get_source();
 
-    auto outclass =
-        capitalize(camelcase(document->get_source()->stem().string()));
+    auto outclass = outer_class(*source_);
     ostream << "public final class " << outclass << " {" << NL << INDENT_1
             << "private " << outclass << "() {}" << NL;
+    if (json_codec_) {
+      ostream << kJsonRuntime;
+    }
   }
   void after_generate_document(std::ostream &ostream,
                                const Document *document) override {
@@ -43,25 +78,25 @@ class JavaGenerator : public Generator {
   void before_generate_struct(std::ostream &ostream,
                               const Document *document) override {
     for (const auto &struct_type : document->get_struct_types()) {
-      auto struct_name = capitalize(camelcase(struct_type->get_name()));
-      for (const auto &field : struct_type->get_fields()) {
-        if (field.get_type()->is_oneof()) {
-          auto oneof_name =
-              gen_oneof_name(struct_type->get_name(), field.get_name());
-          ostream << INDENT_1 << "public interface " << oneof_name << " {}"
-                  << NL;
-          auto oneof = std::dynamic_pointer_cast<OneofType>(field.get_type());
-          for (const auto &oneof_field : oneof->get_fields()) {
-            auto field_name = camelcase(oneof_field.get_name());
-            auto oneof_item_class_name = struct_name + capitalize(field_name);
-            ostream << INDENT_1 << "public class " << oneof_item_class_name
-                    << " implements " << oneof_name << " {" << NL << INDENT_2
-                    << generate_struct_field(struct_type.get(), oneof_field)
-                    << NL
-                    << generate_getter_and_setter(struct_type.get(),
-                                                  oneof_field, INDENT_2)
-                    << INDENT_1 << "}" << NL;
-          }
+      const auto &lowered_struct = lowered(struct_type.get());
+      const auto &fields = struct_type->get_fields();
+      for (auto index : lowered_struct.oneof_fields) {
+        const auto &oneof_name = lowered_struct.fields[index].oneof_name;
+        ostream << INDENT_1 << "public interface " << oneof_name << " {}"
+                << NL;
+        const auto *oneof =
+            type_cast<OneofType>(fields[index].get_type().get());
+        const auto &lowered_oneof = lowered(oneof);
+        const auto &alternatives = oneof->get_fields();
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto &alternative = lowered_oneof.fields[i];
+          ostream << INDENT_1 << "public static final class "
+                  << alternative.wrapper_name
+                  << " implements " << oneof_name << " {" << NL << INDENT_2
+                  << generate_struct_field(alternatives[i], alternative) << NL
+                  << generate_getter_and_setter(alternatives[i], alternative,
+                                                INDENT_2)
+                  << INDENT_1 << "}" << NL;
         }
       }
     }
@@ -80,14 +115,22 @@ class JavaGenerator : public Generator {
             << NL << INDENT_2
             << "private static final long serialVersionUID = 0L;" << NL;
 
-    for (const auto &field : struct_type->get_fields()) {
-      ostream << INDENT_2 << generate_struct_field(struct_type.get(), field)
+    const auto &lowered_struct = lowered(struct_type.get());
+    const auto &fields = struct_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << INDENT_2
+              << generate_struct_field(fields[i], lowered_struct.fields[i])
               << NL;
     }
     ostream << NL;
 
-    for (const auto &field : struct_type->get_fields()) {
-      ostream << generate_getter_and_setter(struct_type.get(), field, INDENT_2);
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << generate_getter_and_setter(fields[i], lowered_struct.fields[i],
+                                            INDENT_2);
+    }
+
+    if (json_codec_) {
+      generate_json_methods(ostream, *struct_type);
     }
 
     ostream << INDENT_1 << "}" << NL2;
@@ -98,9 +141,11 @@ class JavaGenerator : public Generator {
     ostream << INDENT_1 << "public enum " << enum_type->get_name() << " {"
             << NL;
 
-    for (const auto &field : enum_type->get_fields()) {
-      ostream << INDENT_2 << camelcase(field.get_name()) << "("
-              << field.get_value() << ")," << NL;
+    const auto &lowered_enum = lowered(enum_type.get());
+    const auto &fields = enum_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << INDENT_2 << lowered_enum.fields[i].name << "("
+              << fields[i].get_value() << ")," << NL;
     }
     ostream << INDENT_2 << ";" << NL;
 
@@ -109,10 +154,10 @@ class JavaGenerator : public Generator {
             << enum_type->get_name() << (use_java8_optional_ ? ">" : "")
             << " forNumber(int value) {" << NL << INDENT_3 << "switch (value) {"
             << NL;
-    for (const auto &field : enum_type->get_fields()) {
-      ostream << INDENT_4 << "case " << field.get_value() << ": return "
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << INDENT_4 << "case " << fields[i].get_value() << ": return "
               << (use_java8_optional_ ? "java.util.Optional.of(" : "")
-              << camelcase(field.get_name())
+              << lowered_enum.fields[i].name
               << (use_java8_optional_ ? ");" : ";") << NL;
     }
     ostream << INDENT_4 << "default: return "
@@ -121,85 +166,1416 @@ class JavaGenerator : public Generator {
 
     ostream << INDENT_2 << "private final int value;" << NL << INDENT_2
             << "private " + enum_type->get_name() + "(int value) {" << NL
-            << INDENT_3 << "this.value = value;" << NL << INDENT_2 << "}" << NL
-            << INDENT_1 << "}";
+            << INDENT_3 << "this.value = value;" << NL << INDENT_2 << "}" << NL;
+
+    if (json_codec_) {
+      // Enums are written as their number, see `write_json`.
+      const auto &name = enum_type->get_name();
+      ostream << INDENT_2 << "public static " << name
+              << " readJson(JsonReader in) throws java.io.IOException {" << NL
+              << INDENT_3 << "if (in.nextNull()) {" << NL << INDENT_4
+              << "return null;" << NL << INDENT_3 << "}" << NL << INDENT_3
+              << "int number = in.nextInt();" << NL << INDENT_3 << name
+              << " value = forNumber(number)"
+              << (use_java8_optional_ ? ".orElse(null)" : "") << ";" << NL
+              << INDENT_3 << "if (value == null) {" << NL << INDENT_4
+              << "throw in.error(\"unknown " << name << " \" + number);" << NL
+              << INDENT_3 << "}" << NL << INDENT_3 << "return value;" << NL
+              << INDENT_2 << "}" << NL;
+    }
+    ostream << INDENT_1 << "}";
   }
 
  private:
-  std::string generate_struct_field(StructType *struct_type,
-                                    const Field &field) const {
-    auto use_optional = use_java8_optional_ && field.is_optional();
-    return (use_optional ? "private java.util.Optional<" : "private ") +
-           (field.get_type()->is_oneof()
-                ? gen_oneof_name(struct_type->get_name(), field.get_name())
-                : type_to_java_type(field.get_type().get(),
-                                    field.is_optional())) +
-           (use_optional ? "> " : " ") + field.get_name() + ";";
-  }
-
-  std::string generate_getter_and_setter(StructType *struct_type,
-                                         const Field &field,
+  // Flags of `render`.
+  static constexpr unsigned kBoxed = 1;
+  static constexpr unsigned kOptional = 2;
+
+  std::string generate_struct_field(const Field &field,
+                                    const LoweredField &lowered_field) const {
+    return "private " + field_type(field) + " " + lowered_field.name + ";";
+  }
+
+  std::string generate_getter_and_setter(const Field &field,
+                                         const LoweredField &lowered_field,
                                          const std::string &base_indent) const {
-    auto use_optional = use_java8_optional_ && field.is_optional();
-    auto field_name_camelcase = camelcase(field.get_name());
+    const auto &type = field_type(field);
+    const auto &field_name_camelcase = lowered_field.name;
+    const auto &capitalized_name = lowered_field.capitalized_name;
     // getter
-    auto getter =
-        base_indent +
-        (use_optional ? "public java.util.Optional<" : "public ") +
-        type_to_java_type(field.get_type().get(), field.is_optional()) +
-        (use_optional ? "> get" : " get") + capitalize(field_name_camelcase) +
-        "() {" + NL + base_indent + INDENT_1 + "return " +
-        field_name_camelcase + ";" + NL + base_indent + "}" + NL;
+    auto getter = base_indent + "public " + type + " get" + capitalized_name +
+                  "() {" + NL + base_indent + INDENT_1 + "return " +
+                  field_name_camelcase + ";" + NL + base_indent + "}" + NL;
 
     // setter
     auto setter =
-        base_indent + "public void set" + capitalize(field_name_camelcase) +
-        "(" + (use_optional ? "java.util.Optional<" : "") +
-        type_to_java_type(field.get_type().get(), field.is_optional()) + " " +
+        base_indent + "public void set" + capitalized_name + "(" + type + " " +
         field_name_camelcase + ") {" + NL + base_indent + INDENT_1 + "this." +
         field_name_camelcase + " = " + field_name_camelcase + ";" + NL +
         base_indent + "}";
     return getter + setter + NL;
   }
 
-  static std::string gen_oneof_name(const std::string &struct_name,
-                                    const std::string &field_name) {
-    return "Is" + capitalize(camelcase(struct_name)) +
-           capitalize(camelcase(field_name));
+  // The declared type of `field`, the same for its member, getter and setter.
+  [[nodiscard]] const std::string &field_type(const Field &field) const {
+    if (!field.is_optional()) {
+      return render(field.get_type().get());
+    }
+    return render(field.get_type().get(),
+                  use_java8_optional_ ? kBoxed | kOptional : kBoxed);
+  }
+
+  [[nodiscard]] const std::string &type_to_java_type(const Type *type,
+                                                     bool boxed = false) const {
+    return render(type, boxed ? kBoxed : 0);
+  }
+
+  // The JSON codec, with the `java_json_codec` option.
+  //
+  // Every struct gets static `writeJson` and `readJson` methods, which
+  // stream its fields through the JsonWriter and JsonReader bundled in the
+  // outer class, and `toJson` and `fromJson` for strings. The code is
+  // specialized to the types of the fields: no reflection, and no tree
+  // besides the values of `any` fields. The JSON is the one of the Go codec
+  // (see GolangGenerator): enums as their number, a oneof as an object with
+  // the key of its alternative, map keys as strings. Unknown keys are
+  // skipped, null reads as the default of primitive types.
+  //
+  // The generated methods use `out`, `in` and `value` for their arguments
+  // and result, and locals named after their nesting level, as Java does
+  // not let nested blocks shadow them.
+
+  void generate_json_methods(std::ostream &ostream,
+                             const StructType &struct_type) const {
+    const auto &name = struct_type.get_name();
+    const auto &lowered_struct = lowered(&struct_type);
+    const auto &fields = struct_type.get_fields();
+
+    ostream << NL << INDENT_2 << "public static void writeJson(JsonWriter out, "
+            << name << " value)" << NL << INDENT_4
+            << "throws java.io.IOException {" << NL << INDENT_3
+            << "if (value == null) {" << NL << INDENT_4 << "out.nullValue();"
+            << NL << INDENT_4 << "return;" << NL << INDENT_3 << "}" << NL;
+    if (fields.empty()) {
+      ostream << INDENT_3 << "out.raw(\"{}\");" << NL;
+    }
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto &field = fields[i];
+      const auto *type = field.get_type().get();
+      auto member = "value." + lowered_struct.fields[i].name;
+      ostream << INDENT_3 << "out.raw(\"" << (i == 0 ? "{" : ",") << "\\\""
+              << field.get_name() << "\\\":\");" << NL;
+      if (!field.is_optional()) {
+        write_json(ostream, type, member, false, 3);
+      } else if (use_java8_optional_) {
+        ostream << INDENT_3 << "if (" << member << " == null || !" << member
+                << ".isPresent()) {" << NL << INDENT_4 << "out.nullValue();"
+                << NL << INDENT_3 << "} else {" << NL;
+        write_json(ostream, type, member + ".get()", true, 4);
+        ostream << INDENT_3 << "}" << NL;
+      } else {
+        write_json(ostream, type, member, true, 3);
+      }
+    }
+    if (!fields.empty()) {
+      ostream << INDENT_3 << "out.raw('}');" << NL;
+    }
+    ostream << INDENT_2 << "}" << NL;
+
+    ostream << INDENT_2 << "public static " << name
+            << " readJson(JsonReader in) throws java.io.IOException {" << NL
+            << INDENT_3 << "if (in.nextNull()) {" << NL << INDENT_4
+            << "return null;" << NL << INDENT_3 << "}" << NL << INDENT_3 << name
+            << " value = new " << name << "();" << NL << INDENT_3
+            << "in.beginObject();" << NL << INDENT_3
+            << "for (boolean first = true; in.more('}', first); "
+               "first = false) {"
+            << NL << INDENT_4 << "switch (in.nextName()) {" << NL;
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto &field = fields[i];
+      const auto *type = field.get_type().get();
+      auto member = "value." + lowered_struct.fields[i].name;
+      // Cases share the scope of the switch, a block scopes the locals.
+      auto block = type->is_list() || type->is_map() || type->is_oneof();
+      ostream << INDENT_4 << INDENT_1 << "case \"" << field.get_name()
+              << "\":" << (block ? " {" : "") << NL;
+      if (!field.is_optional()) {
+        read_json(ostream, type, member + " = ", ";", false, 6);
+      } else if (use_java8_optional_) {
+        read_json(ostream, type, member + " = java.util.Optional.ofNullable(",
+                  ");", true, 6);
+      } else {
+        read_json(ostream, type, member + " = ", ";", true, 6);
+      }
+      ostream << INDENT_4 << INDENT_2 << "break;" << NL;
+      if (block) {
+        ostream << INDENT_4 << INDENT_1 << "}" << NL;
+      }
+    }
+    ostream << INDENT_4 << INDENT_1 << "default:" << NL << INDENT_4 << INDENT_2
+            << "in.skipValue();" << NL << INDENT_4 << "}" << NL << INDENT_3
+            << "}" << NL << INDENT_3 << "return value;" << NL << INDENT_2 << "}"
+            << NL;
+
+    ostream << INDENT_2
+            << "public String toJson() throws java.io.IOException {" << NL
+            << INDENT_3 << "JsonWriter out = new JsonWriter();" << NL
+            << INDENT_3 << "writeJson(out, this);" << NL << INDENT_3
+            << "return out.toString();" << NL << INDENT_2 << "}" << NL;
+    ostream << INDENT_2 << "public static " << name
+            << " fromJson(String json) throws java.io.IOException {" << NL
+            << INDENT_3 << "JsonReader in = new JsonReader(json);" << NL
+            << INDENT_3 << name << " value = readJson(in);" << NL << INDENT_3
+            << "in.end();" << NL << INDENT_3 << "return value;" << NL
+            << INDENT_2 << "}" << NL;
+  }
+
+  // Writes `value`, a Java expression of `type`, to `out`. A `boxed` value
+  // of a primitive type may be null.
+  void write_json(std::ostream &ostream, const Type *type,
+                  const std::string &value, bool boxed,
+                  std::size_t level) const {
+    auto indent = indentation(level);
+    auto var = std::to_string(level);
+    switch (type->kind()) {
+      case Type::Kind::Primitive: {
+        std::string write;
+        switch (static_cast<const PrimitiveType *>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::U32:
+          case PrimitiveType::TypeKind::U64:
+            write = "out.unsignedValue(" + value + ");";
+            break;
+          case PrimitiveType::TypeKind::String:
+            boxed = false;
+            write = "out.value(" + value + ");";
+            break;
+          case PrimitiveType::TypeKind::Any:
+            boxed = false;
+            write = "out.any(" + value + ");";
+            break;
+          default:
+            write = "out.value(" + value + ");";
+        }
+        write_nullable(ostream, value, write, boxed, level);
+        break;
+      }
+      case Type::Kind::Enum:
+        if (!declared_here(type)) {
+          ostream << indent << "out.reflect(" << value << ");" << NL;
+          break;
+        }
+        write_nullable(ostream, value, "out.value(" + value + ".value);", true,
+                       level);
+        break;
+      case Type::Kind::Struct:
+        if (!declared_here(type)) {
+          ostream << indent << "out.reflect(" << value << ");" << NL;
+          break;
+        }
+        ostream << indent << type->get_name() << ".writeJson(out, " << value
+                << ");" << NL;
+        break;
+      case Type::Kind::List: {
+        const auto *elem_type =
+            static_cast<const ListType *>(type)->get_elem_type().get();
+        auto first = "first" + var;
+        auto element = "e" + var;
+        ostream << indent << "if (" << value << " == null) {" << NL << indent
+                << INDENT_1 << "out.nullValue();" << NL << indent
+                << "} else {" << NL << indent << INDENT_1 << "out.raw('[');"
+                << NL << indent << INDENT_1 << "boolean " << first << " = true;"
+                << NL << indent << INDENT_1 << "for ("
+                << type_to_java_type(elem_type, true) << " " << element << " : "
+                << value << ") {" << NL << indent << INDENT_2 << "if (!"
+                << first << ") {" << NL << indent << INDENT_3
+                << "out.raw(',');" << NL << indent << INDENT_2 << "}" << NL
+                << indent << INDENT_2 << first << " = false;" << NL;
+        write_json(ostream, elem_type, element, true, level + 2);
+        ostream << indent << INDENT_1 << "}" << NL << indent << INDENT_1
+                << "out.raw(']');" << NL << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Map: {
+        const auto *map = static_cast<const MapType *>(type);
+        auto first = "first" + var;
+        auto entry = "e" + var;
+        ostream << indent << "if (" << value << " == null) {" << NL << indent
+                << INDENT_1 << "out.nullValue();" << NL << indent
+                << "} else {" << NL << indent << INDENT_1 << "out.raw('{');"
+                << NL << indent << INDENT_1 << "boolean " << first << " = true;"
+                << NL << indent << INDENT_1 << "for (java.util.Map.Entry<"
+                << type_to_java_type(map->get_key_type().get(), true) << ", "
+                << type_to_java_type(map->get_value_type().get(), true) << "> "
+                << entry << " : " << value << ".entrySet()) {" << NL << indent
+                << INDENT_2 << "if (!" << first << ") {" << NL << indent
+                << INDENT_3 << "out.raw(',');" << NL << indent << INDENT_2
+                << "}" << NL << indent << INDENT_2 << first << " = false;"
+                << NL << indent << INDENT_2
+                << write_json_key(map->get_key_type().get(),
+                                  entry + ".getKey()")
+                << NL << indent << INDENT_2 << "out.raw(':');" << NL;
+        write_json(ostream, map->get_value_type().get(), entry + ".getValue()",
+                   true, level + 2);
+        ostream << indent << INDENT_1 << "}" << NL << indent << INDENT_1
+                << "out.raw('}');" << NL << indent << "}" << NL;
+        break;
+      }
+      case Type::Kind::Oneof: {
+        const auto *oneof = static_cast<const OneofType *>(type);
+        const auto &lowered_oneof = lowered(oneof);
+        const auto &alternatives = oneof->get_fields();
+        ostream << indent << "if (" << value << " == null) {" << NL << indent
+                << INDENT_1 << "out.nullValue();" << NL;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto &wrapper = lowered_oneof.fields[i].wrapper_name;
+          ostream << indent << "} else if (" << value << " instanceof "
+                  << wrapper << ") {" << NL << indent << INDENT_1
+                  << "out.raw(\"{\\\"" << alternatives[i].get_name()
+                  << "\\\":\");" << NL;
+          write_json(ostream, alternatives[i].get_type().get(),
+                     "((" + wrapper + ") " + value + ")." +
+                         lowered_oneof.fields[i].name,
+                     false, level + 1);
+          ostream << indent << INDENT_1 << "out.raw('}');" << NL;
+        }
+        ostream << indent << "} else {" << NL << indent << INDENT_1
+                << "throw new JsonException(\"unknown alternative \" + "
+                << value << ".getClass().getName());" << NL << indent << "}"
+                << NL;
+        break;
+      }
+    }
+  }
+
+  // `write`, or null if `nullable` and `value` is null.
+  static void write_nullable(std::ostream &ostream, const std::string &value,
+                             const std::string &write, bool nullable,
+                             std::size_t level) {
+    auto indent = indentation(level);
+    if (!nullable) {
+      ostream << indent << write << NL;
+      return;
+    }
+    ostream << indent << "if (" << value << " == null) {" << NL << indent
+            << INDENT_1 << "out.nullValue();" << NL << indent << "} else {"
+            << NL << indent << INDENT_1 << write << NL << indent << "}" << NL;
+  }
+
+  // Writes `key`, a boxed map key of `type`, as a string.
+  [[nodiscard]] static std::string write_json_key(const PrimitiveType *type,
+                                                  const std::string &key) {
+    switch (type->get_type_kind()) {
+      case PrimitiveType::TypeKind::Bool:
+        return "out.raw(" + key + " ? \"\\\"true\\\"\" : \"\\\"false\\\"\");";
+      case PrimitiveType::TypeKind::U32:
+      case PrimitiveType::TypeKind::U64:
+        return "out.raw('\"').unsignedValue(" + key + ").raw('\"');";
+      case PrimitiveType::TypeKind::String:
+        return "out.value(" + key + ");";
+      case PrimitiveType::TypeKind::Any:
+        return "out.value(String.valueOf(" + key + "));";
+      default:
+        return "out.raw('\"').value(" + key + ").raw('\"');";
+    }
+  }
+
+  // Reads a value of `type` into `prefix` <value> `suffix`, e.g.
+  // `value.id = ` and `;`. Primitive values are boxed and null for null if
+  // `boxed`.
+  void read_json(std::ostream &ostream, const Type *type,
+                 const std::string &prefix, const std::string &suffix,
+                 bool boxed, std::size_t level) const {
+    auto indent = indentation(level);
+    auto var = std::to_string(level);
+    switch (type->kind()) {
+      case Type::Kind::Primitive: {
+        std::string read;
+        switch (static_cast<const PrimitiveType *>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            read = "in.nextBoolean()";
+            break;
+          case PrimitiveType::TypeKind::I32:
+            read = "in.nextInt()";
+            break;
+          case PrimitiveType::TypeKind::U32:
+            read = "in.nextUnsignedInt()";
+            break;
+          case PrimitiveType::TypeKind::I64:
+            read = "in.nextLong()";
+            break;
+          case PrimitiveType::TypeKind::U64:
+            read = "in.nextUnsignedLong()";
+            break;
+          case PrimitiveType::TypeKind::Float:
+            read = "in.nextFloat()";
+            break;
+          case PrimitiveType::TypeKind::String:
+            boxed = false;
+            read = "in.nextString()";
+            break;
+          case PrimitiveType::TypeKind::Any:
+            boxed = false;
+            read = "in.nextAny()";
+            break;
+        }
+        ostream << indent << prefix << (boxed ? "in.nextNull() ? null : " : "")
+                << read << suffix << NL;
+        break;
+      }
+      case Type::Kind::Enum:
+      case Type::Kind::Struct:
+        if (declared_here(type)) {
+          ostream << indent << prefix << type->get_name() << ".readJson(in)"
+                  << suffix << NL;
+        } else {
+          ostream << indent << prefix << "in.nextReflect("
+                  << type_to_java_type(type) << ".class)" << suffix << NL;
+        }
+        break;
+      case Type::Kind::List: {
+        const auto *elem_type =
+            static_cast<const ListType *>(type)->get_elem_type().get();
+        auto list = "l" + var;
+        auto first = "first" + var;
+        ostream << indent << type_to_java_type(type) << " " << list
+                << " = null;" << NL << indent << "if (!in.nextNull()) {" << NL
+                << indent << INDENT_1 << list
+                << " = new java.util.ArrayList<>();" << NL << indent << INDENT_1
+                << "in.beginArray();" << NL << indent << INDENT_1
+                << "for (boolean " << first << " = true; in.more(']', " << first
+                << "); " << first << " = false) {" << NL;
+        read_json(ostream, elem_type, list + ".add(", ");", true, level + 2);
+        ostream << indent << INDENT_1 << "}" << NL << indent << "}" << NL
+                << indent << prefix << list << suffix << NL;
+        break;
+      }
+      case Type::Kind::Map: {
+        const auto *map = static_cast<const MapType *>(type);
+        auto object = "m" + var;
+        auto key = "k" + var;
+        auto first = "first" + var;
+        ostream << indent << type_to_java_type(type) << " " << object
+                << " = null;" << NL << indent << "if (!in.nextNull()) {" << NL
+                << indent << INDENT_1 << object
+                << " = new java.util.LinkedHashMap<>();" << NL << indent
+                << INDENT_1 << "in.beginObject();" << NL << indent << INDENT_1
+                << "for (boolean " << first << " = true; in.more('}', " << first
+                << "); " << first << " = false) {" << NL << indent << INDENT_2
+                << type_to_java_type(map->get_key_type().get(), true) << " "
+                << key << " = " << read_json_key(map->get_key_type().get())
+                << ";" << NL;
+        read_json(ostream, map->get_value_type().get(),
+                  object + ".put(" + key + ", ", ");", true, level + 2);
+        ostream << indent << INDENT_1 << "}" << NL << indent << "}" << NL
+                << indent << prefix << object << suffix << NL;
+        break;
+      }
+      case Type::Kind::Oneof: {
+        const auto *oneof = static_cast<const OneofType *>(type);
+        const auto &lowered_oneof = lowered(oneof);
+        const auto &alternatives = oneof->get_fields();
+        auto alternative = "o" + var;
+        auto wrapper = "w" + var;
+        ostream << indent << lowered_oneof.name << " " << alternative
+                << " = null;" << NL << indent << "if (!in.nextNull()) {" << NL
+                << indent << INDENT_1 << "in.beginObject();" << NL << indent
+                << INDENT_1 << "if (in.more('}', true)) {" << NL << indent
+                << INDENT_2 << "switch (in.nextName()) {" << NL;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto &lowered_alternative = lowered_oneof.fields[i];
+          ostream << indent << INDENT_3 << "case \""
+                  << alternatives[i].get_name() << "\": {" << NL << indent
+                  << INDENT_4 << lowered_alternative.wrapper_name << " "
+                  << wrapper << " = new " << lowered_alternative.wrapper_name
+                  << "();" << NL;
+          read_json(ostream, alternatives[i].get_type().get(),
+                    wrapper + "." + lowered_alternative.name + " = ", ";",
+                    false, level + 4);
+          ostream << indent << INDENT_4 << alternative << " = " << wrapper
+                  << ";" << NL << indent << INDENT_4 << "break;" << NL
+                  << indent << INDENT_3 << "}" << NL;
+        }
+        ostream << indent << INDENT_3 << "default:" << NL << indent << INDENT_4
+                << "throw in.error(\"unknown alternative\");" << NL << indent
+                << INDENT_2 << "}" << NL << indent << INDENT_2
+                << "if (in.more('}', false)) {" << NL << indent << INDENT_3
+                << "throw in.error(\"more than one alternative\");" << NL
+                << indent << INDENT_2 << "}" << NL << indent << INDENT_1 << "}"
+                << NL << indent << "}" << NL << indent << prefix << alternative
+                << suffix << NL;
+        break;
+      }
+    }
+  }
+
+  // Reads a member name as a map key of `type`.
+  [[nodiscard]] static std::string read_json_key(const PrimitiveType *type) {
+    switch (type->get_type_kind()) {
+      case PrimitiveType::TypeKind::Bool:
+        return "in.nextBooleanName()";
+      case PrimitiveType::TypeKind::I32:
+        return "in.nextIntName()";
+      case PrimitiveType::TypeKind::U32:
+        return "in.nextUnsignedIntName()";
+      case PrimitiveType::TypeKind::I64:
+        return "in.nextLongName()";
+      case PrimitiveType::TypeKind::U64:
+        return "in.nextUnsignedLongName()";
+      case PrimitiveType::TypeKind::Float:
+        return "in.nextFloatName()";
+      case PrimitiveType::TypeKind::String:
+      case PrimitiveType::TypeKind::Any:
+        return "in.nextName()";
+    }
+    return "";
   }
 
-  [[nodiscard]] static std::string type_to_java_type(Type *type,
-                                                     bool boxed = false) {
-    if (type->is_primitive()) {
-      auto primitive = dynamic_cast<PrimitiveType *>(type);
-      if (primitive->is_bool()) {
-        return boxed ? "Boolean" : "bool";
-      } else if (primitive->is_i32() || primitive->is_u32()) {
-        return boxed ? "Integer" : "int";
-      } else if (primitive->is_i64() || primitive->is_u64()) {
-        return boxed ? "Long" : "long";
-      } else if (primitive->is_float()) {
-        return boxed ? "Float" : "float";
-      } else if (primitive->is_string()) {
-        return "String";
-      } else if (primitive->is_any()) {
-        return "Object";
-      }
-    } else if (type->is_struct() || type->is_enum()) {
-      return type->get_name();
-    } else if (type->is_list()) {
-      auto list = dynamic_cast<ListType *>(type);
-      return "java.util.List<" +
-             type_to_java_type(list->get_elem_type().get(), true) + ">";
-    } else if (type->is_map()) {
-      auto map = dynamic_cast<MapType *>(type);
-      return "java.util.Map<" +
-             type_to_java_type(map->get_key_type().get(), true) + ", " +
-             type_to_java_type(map->get_value_type().get(), true) + ">";
+  // Whether the struct or enum `type` is declared in the document being
+  // generated. Those of other documents only have the methods of the codec
+  // if their document has the option too, the codec reads and writes them
+  // by reflection.
+  [[nodiscard]] bool declared_here(const Type *type) const {
+    auto source = declaration_of(*type)->get_source();
+    return source == source_ || (source && source_ && *source == *source_);
+  }
+
+  // The class the types of the document at `source` are nested in.
+  [[nodiscard]] static std::string outer_class(
+      const std::filesystem::path &source) {
+    return capitalize(camelcase(source.stem().string()));
+  }
+
+  [[nodiscard]] static std::string indentation(std::size_t level) {
+    std::string indent;
+    for (std::size_t i = 0; i < level; ++i) {
+      indent += INDENT_1;
+    }
+    return indent;
+  }
+
+  [[nodiscard]] std::string render_type(const Type *type,
+                                        unsigned flags) const override {
+    if (flags & kOptional) {
+      return "java.util.Optional<" + render(type, flags & ~kOptional) + ">";
+    }
+    auto boxed = (flags & kBoxed) != 0;
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+        switch (static_cast<const PrimitiveType *>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            return boxed ? "Boolean" : "boolean";
+          case PrimitiveType::TypeKind::I32:
+          case PrimitiveType::TypeKind::U32:
+            return boxed ? "Integer" : "int";
+          case PrimitiveType::TypeKind::I64:
+          case PrimitiveType::TypeKind::U64:
+            return boxed ? "Long" : "long";
+          case PrimitiveType::TypeKind::Float:
+            return boxed ? "Float" : "float";
+          case PrimitiveType::TypeKind::String:
+            return "String";
+          case PrimitiveType::TypeKind::Any:
+            return "Object";
+        }
+        break;
+      case Type::Kind::Struct:
+      case Type::Kind::Enum: {
+        // Types of other documents are nested in their outer class.
+        auto source = declaration_of(*type)->get_source();
+        if (declared_here(type) || !source) {
+          return type->get_name();
+        }
+        return outer_class(*source) + "." + type->get_name();
+      }
+      case Type::Kind::List: {
+        auto list = static_cast<const ListType *>(type);
+        return "java.util.List<" +
+               type_to_java_type(list->get_elem_type().get(), true) + ">";
+      }
+      case Type::Kind::Map: {
+        auto map = static_cast<const MapType *>(type);
+        return "java.util.Map<" +
+               type_to_java_type(map->get_key_type().get(), true) + ", " +
+               type_to_java_type(map->get_value_type().get(), true) + ">";
+      }
+      case Type::Kind::Oneof:
+        // Oneofs are declared inline, named after their field.
+        return lowered(type).name;
     }
     return "";
   }
+  // Reader and writer used by the generated methods, nested in the outer
+  // class of every document with the codec.
+  static constexpr char kJsonRuntime[] = R"java(
+    public static final class JsonException extends java.io.IOException {
+        private static final long serialVersionUID = 0L;
+        public JsonException(String message) {
+            super(message);
+        }
+    }
+
+    // Writes JSON to a buffer, flushed to the sink if any when it is full.
+    public static final class JsonWriter {
+        private static final char[] HEX = "0123456789abcdef".toCharArray();
+        private final java.io.Writer sink;
+        private char[] buffer = new char[1024];
+        private int length;
+
+        public JsonWriter() {
+            this(null);
+        }
+        public JsonWriter(java.io.Writer sink) {
+            this.sink = sink;
+        }
+
+        public JsonWriter raw(char c) throws java.io.IOException {
+            require(1);
+            buffer[length++] = c;
+            return this;
+        }
+        public JsonWriter raw(String text) throws java.io.IOException {
+            require(text.length());
+            text.getChars(0, text.length(), buffer, length);
+            length += text.length();
+            return this;
+        }
+        public JsonWriter nullValue() throws java.io.IOException {
+            return raw("null");
+        }
+        public JsonWriter value(boolean value) throws java.io.IOException {
+            return raw(value ? "true" : "false");
+        }
+        public JsonWriter value(int value) throws java.io.IOException {
+            return value((long) value);
+        }
+        public JsonWriter value(long value) throws java.io.IOException {
+            if (value == Long.MIN_VALUE) {
+                return raw("-9223372036854775808");
+            }
+            require(20);
+            if (value < 0) {
+                buffer[length++] = '-';
+                value = -value;
+            }
+            int start = length;
+            do {
+                buffer[length++] = (char) ('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            for (int i = start, j = length - 1; i < j; i++, j--) {
+                char c = buffer[i];
+                buffer[i] = buffer[j];
+                buffer[j] = c;
+            }
+            return this;
+        }
+        public JsonWriter unsignedValue(int value) throws java.io.IOException {
+            return value(value & 0xFFFFFFFFL);
+        }
+        public JsonWriter unsignedValue(long value) throws java.io.IOException {
+            if (value >= 0) {
+                return value(value);
+            }
+            return raw(Long.toUnsignedString(value));
+        }
+        public JsonWriter value(float value) throws java.io.IOException {
+            if (Float.isNaN(value) || Float.isInfinite(value)) {
+                throw new JsonException("unsupported value " + value);
+            }
+            return raw(Float.toString(value));
+        }
+        public JsonWriter value(double value) throws java.io.IOException {
+            if (Double.isNaN(value) || Double.isInfinite(value)) {
+                throw new JsonException("unsupported value " + value);
+            }
+            return raw(Double.toString(value));
+        }
+        public JsonWriter value(String value) throws java.io.IOException {
+            if (value == null) {
+                return nullValue();
+            }
+            require(value.length() + 2);
+            buffer[length++] = '"';
+            for (int i = 0; i < value.length(); i++) {
+                char c = value.charAt(i);
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    if (length == buffer.length) {
+                        require(1);
+                    }
+                    buffer[length++] = c;
+                    continue;
+                }
+                require(6);
+                buffer[length++] = '\\';
+                switch (c) {
+                    case '"':
+                    case '\\':
+                        buffer[length++] = c;
+                        break;
+                    case '\n':
+                        buffer[length++] = 'n';
+                        break;
+                    case '\r':
+                        buffer[length++] = 'r';
+                        break;
+                    case '\t':
+                        buffer[length++] = 't';
+                        break;
+                    default:
+                        buffer[length++] = 'u';
+                        buffer[length++] = '0';
+                        buffer[length++] = '0';
+                        buffer[length++] = HEX[c >> 4];
+                        buffer[length++] = HEX[c & 0xF];
+                }
+            }
+            return raw('"');
+        }
+        // Values of `any` fields: null, strings, booleans, numbers, maps and
+        // iterables of them.
+        public JsonWriter any(Object value) throws java.io.IOException {
+            if (value == null) {
+                return nullValue();
+            } else if (value instanceof String) {
+                return value((String) value);
+            } else if (value instanceof Boolean) {
+                return value(((Boolean) value).booleanValue());
+            } else if (value instanceof Double || value instanceof Float) {
+                return value(((Number) value).doubleValue());
+            } else if (value instanceof Number) {
+                return value(((Number) value).longValue());
+            } else if (value instanceof java.util.Map) {
+                raw('{');
+                boolean first = true;
+                for (java.util.Map.Entry<?, ?> entry
+                        : ((java.util.Map<?, ?>) value).entrySet()) {
+                    if (!first) {
+                        raw(',');
+                    }
+                    first = false;
+                    value(String.valueOf(entry.getKey()));
+                    raw(':');
+                    any(entry.getValue());
+                }
+                return raw('}');
+            } else if (value instanceof Iterable) {
+                raw('[');
+                boolean first = true;
+                for (Object element : (Iterable<?>) value) {
+                    if (!first) {
+                        raw(',');
+                    }
+                    first = false;
+                    any(element);
+                }
+                return raw(']');
+            }
+            throw new JsonException(
+                    "unsupported value of " + value.getClass().getName());
+        }
+        // Structs and enums of other documents, see JsonReflection.
+        public JsonWriter reflect(Object value) throws java.io.IOException {
+            if (value instanceof java.util.Optional) {
+                value = ((java.util.Optional<?>) value).orElse(null);
+            }
+            if (value == null) {
+                return nullValue();
+            } else if (value instanceof String) {
+                return value((String) value);
+            } else if (value instanceof Boolean) {
+                return value(((Boolean) value).booleanValue());
+            } else if (value instanceof Float) {
+                return value(((Float) value).floatValue());
+            } else if (value instanceof Double) {
+                return value(((Double) value).doubleValue());
+            } else if (value instanceof Number) {
+                return value(((Number) value).longValue());
+            } else if (value instanceof Enum) {
+                return value(JsonReflection.number(value));
+            } else if (value instanceof java.util.Map) {
+                raw('{');
+                boolean first = true;
+                for (java.util.Map.Entry<?, ?> entry
+                        : ((java.util.Map<?, ?>) value).entrySet()) {
+                    if (!first) {
+                        raw(',');
+                    }
+                    first = false;
+                    value(String.valueOf(entry.getKey()));
+                    raw(':');
+                    reflect(entry.getValue());
+                }
+                return raw('}');
+            } else if (value instanceof Iterable) {
+                raw('[');
+                boolean first = true;
+                for (Object element : (Iterable<?>) value) {
+                    if (!first) {
+                        raw(',');
+                    }
+                    first = false;
+                    reflect(element);
+                }
+                return raw(']');
+            }
+            // A struct, or the wrapper of a oneof alternative, which is an
+            // object of its one field.
+            raw('{');
+            boolean first = true;
+            for (java.util.Map.Entry<String, java.lang.reflect.Field> field
+                    : JsonReflection.fields(value.getClass()).entrySet()) {
+                if (!first) {
+                    raw(',');
+                }
+                first = false;
+                value(field.getKey());
+                raw(':');
+                reflect(JsonReflection.get(field.getValue(), value));
+            }
+            return raw('}');
+        }
+        public void flush() throws java.io.IOException {
+            if (sink != null) {
+                sink.write(buffer, 0, length);
+                length = 0;
+                sink.flush();
+            }
+        }
+        @Override
+        public String toString() {
+            return new String(buffer, 0, length);
+        }
+        private void require(int n) throws java.io.IOException {
+            if (length + n <= buffer.length) {
+                return;
+            }
+            if (sink != null) {
+                sink.write(buffer, 0, length);
+                length = 0;
+                if (n <= buffer.length) {
+                    return;
+                }
+            }
+            buffer = java.util.Arrays.copyOf(
+                    buffer, Math.max(buffer.length * 2, length + n));
+        }
+    }
+
+    // Reads JSON from a string, or from a source through a buffer.
+    public static final class JsonReader {
+        private final java.io.Reader source;
+        private final char[] buffer;
+        private int position;
+        private int limit;
+        // Of the characters read before the buffer.
+        private long offset;
+        private final StringBuilder scratch = new StringBuilder();
+
+        public JsonReader(String json) {
+            this.source = null;
+            this.buffer = json.toCharArray();
+            this.limit = buffer.length;
+        }
+        public JsonReader(java.io.Reader source) {
+            this.source = source;
+            this.buffer = new char[8192];
+        }
+
+        public JsonException error(String what) {
+            return new JsonException(
+                    what + " at offset " + (offset + position));
+        }
+        public boolean nextNull() throws java.io.IOException {
+            if (peek() != 'n') {
+                return false;
+            }
+            literal("null");
+            return true;
+        }
+        public void beginObject() throws java.io.IOException {
+            expect('{');
+        }
+        public void beginArray() throws java.io.IOException {
+            expect('[');
+        }
+        // Whether an element follows in the array or object closed by `end`,
+        // reading the comma before it or the end.
+        public boolean more(char end, boolean first)
+                throws java.io.IOException {
+            int c = peek();
+            if (c == end) {
+                position++;
+                return false;
+            }
+            if (c == -1) {
+                throw error("unexpected end");
+            }
+            if (!first) {
+                if (c != ',') {
+                    throw error("expected , or " + end);
+                }
+                position++;
+            }
+            return true;
+        }
+        public String nextName() throws java.io.IOException {
+            expect('"');
+            String name = string();
+            expect(':');
+            return name;
+        }
+        public boolean nextBooleanName() throws java.io.IOException {
+            String name = nextName();
+            if (!name.equals("true") && !name.equals("false")) {
+                throw error("invalid key " + name);
+            }
+            return name.equals("true");
+        }
+        public int nextIntName() throws java.io.IOException {
+            String name = nextName();
+            try {
+                return Integer.parseInt(name);
+            } catch (NumberFormatException e) {
+                throw error("invalid key " + name);
+            }
+        }
+        public int nextUnsignedIntName() throws java.io.IOException {
+            String name = nextName();
+            try {
+                return Integer.parseUnsignedInt(name);
+            } catch (NumberFormatException e) {
+                throw error("invalid key " + name);
+            }
+        }
+        public long nextLongName() throws java.io.IOException {
+            String name = nextName();
+            try {
+                return Long.parseLong(name);
+            } catch (NumberFormatException e) {
+                throw error("invalid key " + name);
+            }
+        }
+        public long nextUnsignedLongName() throws java.io.IOException {
+            String name = nextName();
+            try {
+                return Long.parseUnsignedLong(name);
+            } catch (NumberFormatException e) {
+                throw error("invalid key " + name);
+            }
+        }
+        public float nextFloatName() throws java.io.IOException {
+            String name = nextName();
+            try {
+                return Float.parseFloat(name);
+            } catch (NumberFormatException e) {
+                throw error("invalid key " + name);
+            }
+        }
+
+        // The readers of primitive values return their default for null.
+
+        public String nextString() throws java.io.IOException {
+            if (nextNull()) {
+                return null;
+            }
+            expect('"');
+            return string();
+        }
+        public boolean nextBoolean() throws java.io.IOException {
+            switch (peek()) {
+                case 't':
+                    literal("true");
+                    return true;
+                case 'f':
+                    literal("false");
+                    return false;
+                case 'n':
+                    literal("null");
+                    return false;
+                default:
+                    throw error("expected boolean");
+            }
+        }
+        public long nextLong() throws java.io.IOException {
+            if (nextNull()) {
+                return 0;
+            }
+            boolean negative = peek() == '-';
+            if (negative) {
+                position++;
+            }
+            // Accumulated negated, like Long.parseLong, as the range of
+            // negative values is the larger.
+            long bound = negative ? Long.MIN_VALUE : -Long.MAX_VALUE;
+            long value = 0;
+            int digits = 0;
+            while (position < limit || fill()) {
+                char c = buffer[position];
+                if (c < '0' || c > '9') {
+                    break;
+                }
+                position++;
+                digits++;
+                int digit = c - '0';
+                if (value < bound / 10 || value * 10 < bound + digit) {
+                    throw error("integer out of range");
+                }
+                value = value * 10 - digit;
+            }
+            if (digits == 0 || position < limit && (buffer[position] == '.'
+                    || buffer[position] == 'e' || buffer[position] == 'E')) {
+                throw error("expected integer");
+            }
+            return negative ? value : -value;
+        }
+        public int nextInt() throws java.io.IOException {
+            long value = nextLong();
+            if (value < Integer.MIN_VALUE || value > Integer.MAX_VALUE) {
+                throw error("integer out of range");
+            }
+            return (int) value;
+        }
+        public int nextUnsignedInt() throws java.io.IOException {
+            long value = nextLong();
+            if (value < 0 || value > 0xFFFFFFFFL) {
+                throw error("integer out of range");
+            }
+            return (int) value;
+        }
+        public long nextUnsignedLong() throws java.io.IOException {
+            if (nextNull()) {
+                return 0;
+            }
+            String text = number();
+            try {
+                return Long.parseUnsignedLong(text);
+            } catch (NumberFormatException e) {
+                throw error("invalid integer " + text);
+            }
+        }
+        public float nextFloat() throws java.io.IOException {
+            if (nextNull()) {
+                return 0;
+            }
+            String text = number();
+            try {
+                return Float.parseFloat(text);
+            } catch (NumberFormatException e) {
+                throw error("invalid number " + text);
+            }
+        }
+        public double nextDouble() throws java.io.IOException {
+            if (nextNull()) {
+                return 0;
+            }
+            String text = number();
+            try {
+                return Double.parseDouble(text);
+            } catch (NumberFormatException e) {
+                throw error("invalid number " + text);
+            }
+        }
+        // A value of an `any` field, see JsonWriter.any. Numbers are doubles.
+        public Object nextAny() throws java.io.IOException {
+            switch (peek()) {
+                case '{': {
+                    position++;
+                    java.util.Map<String, Object> object =
+                            new java.util.LinkedHashMap<>();
+                    for (boolean first = true; more('}', first);
+                            first = false) {
+                        String name = nextName();
+                        object.put(name, nextAny());
+                    }
+                    return object;
+                }
+                case '[': {
+                    position++;
+                    java.util.List<Object> array = new java.util.ArrayList<>();
+                    for (boolean first = true; more(']', first);
+                            first = false) {
+                        array.add(nextAny());
+                    }
+                    return array;
+                }
+                case '"':
+                    return nextString();
+                case 't':
+                case 'f':
+                    return nextBoolean();
+                case 'n':
+                    literal("null");
+                    return null;
+                default:
+                    return nextDouble();
+            }
+        }
+        // A struct or enum of another document, see JsonReflection.
+        public <T> T nextReflect(Class<T> type) throws java.io.IOException {
+            return type.cast(reflect(type));
+        }
+        public void skipValue() throws java.io.IOException {
+            int c = peek();
+            switch (c) {
+                case '{':
+                case '[': {
+                    char end = c == '{' ? '}' : ']';
+                    position++;
+                    for (boolean first = true; more(end, first);
+                            first = false) {
+                        if (c == '{') {
+                            nextName();
+                        }
+                        skipValue();
+                    }
+                    return;
+                }
+                case '"':
+                    nextString();
+                    return;
+                case 't':
+                case 'f':
+                case 'n':
+                    nextBoolean();
+                    return;
+                default:
+                    nextDouble();
+            }
+        }
+        // Checks that nothing follows the value read.
+        public void end() throws java.io.IOException {
+            if (peek() != -1) {
+                throw error("unexpected data after the value");
+            }
+        }
+
+        // The next character after whitespace, -1 at the end.
+        private int peek() throws java.io.IOException {
+            while (position < limit || fill()) {
+                char c = buffer[position];
+                if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+                    return c;
+                }
+                position++;
+            }
+            return -1;
+        }
+        private char next() throws java.io.IOException {
+            if (position == limit && !fill()) {
+                throw error("unexpected end");
+            }
+            return buffer[position++];
+        }
+        private Object reflect(java.lang.reflect.Type type)
+                throws java.io.IOException {
+            if (type instanceof java.lang.reflect.ParameterizedType) {
+                java.lang.reflect.ParameterizedType generic =
+                        (java.lang.reflect.ParameterizedType) type;
+                java.lang.reflect.Type[] arguments =
+                        generic.getActualTypeArguments();
+                if (generic.getRawType() == java.util.Optional.class) {
+                    return java.util.Optional.ofNullable(reflect(arguments[0]));
+                }
+                if (nextNull()) {
+                    return null;
+                }
+                if (generic.getRawType() == java.util.List.class) {
+                    java.util.List<Object> list = new java.util.ArrayList<>();
+                    beginArray();
+                    for (boolean first = true; more(']', first);
+                            first = false) {
+                        list.add(reflect(arguments[0]));
+                    }
+                    return list;
+                }
+                java.util.Map<Object, Object> map =
+                        new java.util.LinkedHashMap<>();
+                beginObject();
+                for (boolean first = true; more('}', first); first = false) {
+                    Object key = reflectName(arguments[0]);
+                    map.put(key, reflect(arguments[1]));
+                }
+                return map;
+            }
+            Class<?> raw = (Class<?>) type;
+            if (raw == boolean.class) {
+                return nextBoolean();
+            } else if (raw == int.class) {
+                return nextInt();
+            } else if (raw == long.class) {
+                return nextLong();
+            } else if (raw == float.class) {
+                return nextFloat();
+            } else if (raw == String.class) {
+                return nextString();
+            } else if (raw == Object.class) {
+                return nextAny();
+            } else if (nextNull()) {
+                return null;
+            } else if (raw == Boolean.class) {
+                return nextBoolean();
+            } else if (raw == Integer.class) {
+                return nextInt();
+            } else if (raw == Long.class) {
+                return nextLong();
+            } else if (raw == Float.class) {
+                return nextFloat();
+            } else if (raw.isEnum()) {
+                int number = nextInt();
+                for (Object constant : raw.getEnumConstants()) {
+                    if (JsonReflection.number(constant) == number) {
+                        return constant;
+                    }
+                }
+                throw error("unknown " + raw.getSimpleName() + " " + number);
+            }
+            beginObject();
+            if (raw.isInterface()) {
+                // A oneof, its alternatives are the classes implementing it
+                // next to it, each with the one field named after it.
+                Object alternative = null;
+                if (more('}', true)) {
+                    String name = nextName();
+                    for (Class<?> wrapper
+                            : raw.getDeclaringClass().getDeclaredClasses()) {
+                        java.lang.reflect.Field field = wrapper == raw
+                                || !raw.isAssignableFrom(wrapper) ? null
+                                : JsonReflection.fields(wrapper).get(name);
+                        if (field != null) {
+                            alternative = JsonReflection.create(wrapper);
+                            JsonReflection.set(field, alternative,
+                                    reflect(field.getGenericType()));
+                            break;
+                        }
+                    }
+                    if (alternative == null) {
+                        throw error("unknown alternative");
+                    }
+                    if (more('}', false)) {
+                        throw error("more than one alternative");
+                    }
+                }
+                return alternative;
+            }
+            Object value = JsonReflection.create(raw);
+            java.util.Map<String, java.lang.reflect.Field> fields =
+                    JsonReflection.fields(raw);
+            for (boolean first = true; more('}', first); first = false) {
+                java.lang.reflect.Field field = fields.get(nextName());
+                if (field == null) {
+                    skipValue();
+                } else {
+                    JsonReflection.set(field, value,
+                            reflect(field.getGenericType()));
+                }
+            }
+            return value;
+        }
+        private Object reflectName(java.lang.reflect.Type type)
+                throws java.io.IOException {
+            if (type == Boolean.class) {
+                return nextBooleanName();
+            } else if (type == Integer.class) {
+                return nextIntName();
+            } else if (type == Long.class) {
+                return nextLongName();
+            } else if (type == Float.class) {
+                return nextFloatName();
+            }
+            return nextName();
+        }
+        private boolean fill() throws java.io.IOException {
+            if (source == null) {
+                return false;
+            }
+            offset += limit;
+            position = 0;
+            limit = Math.max(source.read(buffer, 0, buffer.length), 0);
+            return limit > 0;
+        }
+        private void expect(char c) throws java.io.IOException {
+            if (peek() != c) {
+                throw error("expected " + c);
+            }
+            position++;
+        }
+        private void literal(String text) throws java.io.IOException {
+            for (int i = 0; i < text.length(); i++) {
+                if (next() != text.charAt(i)) {
+                    throw error("expected " + text);
+                }
+            }
+        }
+        // The text of a number.
+        private String number() throws java.io.IOException {
+            peek();
+            scratch.setLength(0);
+            while (position < limit || fill()) {
+                char c = buffer[position];
+                if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.'
+                        && c != 'e' && c != 'E') {
+                    break;
+                }
+                scratch.append(c);
+                position++;
+            }
+            if (scratch.length() == 0) {
+                throw error("expected number");
+            }
+            return scratch.toString();
+        }
+        // The rest of a string after its opening quote. Strings without
+        // escapes within the buffer are copied at once.
+        private String string() throws java.io.IOException {
+            for (int i = position; i < limit; i++) {
+                char c = buffer[i];
+                if (c == '"') {
+                    String value = new String(buffer, position, i - position);
+                    position = i + 1;
+                    return value;
+                }
+                if (c == '\\' || c < 0x20) {
+                    break;
+                }
+            }
+            scratch.setLength(0);
+            while (true) {
+                char c = next();
+                if (c == '"') {
+                    return scratch.toString();
+                }
+                if (c < 0x20) {
+                    throw error("control character in string");
+                }
+                if (c != '\\') {
+                    scratch.append(c);
+                    continue;
+                }
+                c = next();
+                switch (c) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        scratch.append(c);
+                        break;
+                    case 'b':
+                        scratch.append('\b');
+                        break;
+                    case 'f':
+                        scratch.append('\f');
+                        break;
+                    case 'n':
+                        scratch.append('\n');
+                        break;
+                    case 'r':
+                        scratch.append('\r');
+                        break;
+                    case 't':
+                        scratch.append('\t');
+                        break;
+                    case 'u': {
+                        // Surrogate pairs are two escapes, UTF-16 like Java.
+                        int code = 0;
+                        for (int i = 0; i < 4; i++) {
+                            int digit = Character.digit(next(), 16);
+                            if (digit < 0) {
+                                throw error("invalid escape");
+                            }
+                            code = code * 16 + digit;
+                        }
+                        scratch.append((char) code);
+                        break;
+                    }
+                    default:
+                        throw error("invalid escape");
+                }
+            }
+        }
+    }
+
+    // Structs and enums of other documents only have the methods of the
+    // codec if their document has the option too, so the codec reads and
+    // writes them by reflection: a struct as an object of its fields, named
+    // in the snake case of their Java names like in the schema, and an
+    // enum as its number. Unsigned integers are read and written signed.
+    private static final class JsonReflection {
+        private static final ClassValue<java.util.Map<String,
+                java.lang.reflect.Field>> FIELDS = new ClassValue<java.util.Map<
+                        String, java.lang.reflect.Field>>() {
+            @Override
+            protected java.util.Map<String, java.lang.reflect.Field>
+                    computeValue(Class<?> type) {
+                java.util.Map<String, java.lang.reflect.Field> fields =
+                        new java.util.LinkedHashMap<>();
+                for (java.lang.reflect.Field field : type.getDeclaredFields()) {
+                    if (!java.lang.reflect.Modifier.isStatic(
+                            field.getModifiers())) {
+                        field.setAccessible(true);
+                        fields.put(name(field.getName()), field);
+                    }
+                }
+                return fields;
+            }
+        };
+
+        private JsonReflection() {}
+
+        // The fields of a struct by their name in the schema, in order.
+        static java.util.Map<String, java.lang.reflect.Field> fields(
+                Class<?> type) {
+            return FIELDS.get(type);
+        }
+        static String name(String field) {
+            StringBuilder name = new StringBuilder(field.length() + 4);
+            for (int i = 0; i < field.length(); i++) {
+                char c = field.charAt(i);
+                if (Character.isUpperCase(c)) {
+                    name.append('_').append(Character.toLowerCase(c));
+                } else {
+                    name.append(c);
+                }
+            }
+            return name.toString();
+        }
+        static int number(Object constant) throws JsonException {
+            try {
+                java.lang.reflect.Field value = ((Enum<?>) constant)
+                        .getDeclaringClass().getDeclaredField("value");
+                value.setAccessible(true);
+                return value.getInt(constant);
+            } catch (ReflectiveOperationException e) {
+                throw new JsonException(e.toString());
+            }
+        }
+        static Object create(Class<?> type) throws JsonException {
+            try {
+                return type.getDeclaredConstructor().newInstance();
+            } catch (ReflectiveOperationException e) {
+                throw new JsonException(e.toString());
+            }
+        }
+        static Object get(java.lang.reflect.Field field, Object object)
+                throws JsonException {
+            try {
+                return field.get(object);
+            } catch (IllegalAccessException e) {
+                throw new JsonException(e.toString());
+            }
+        }
+        static void set(java.lang.reflect.Field field, Object object,
+                Object value) throws JsonException {
+            try {
+                field.set(object, value);
+            } catch (IllegalAccessException e) {
+                throw new JsonException(e.toString());
+            }
+        }
+    }
+)java";
+
   bool use_java8_optional_ = false;
+  bool json_codec_ = false;
+  std::shared_ptr<std::filesystem::path> source_;
 };
 }  // namespace toolman::generator
 #endif  // TOOLMAN_GOLANG_GENERATOR_H_
@@ -0,0 +1,365 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/json.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace toolman::json {
+
+const Value& Value::operator[](const std::string& key) const {
+  static const Value kNull;
+  if (!is_object()) {
+    return kNull;
+  }
+  const auto& object = std::get<Object>(data_);
+  auto it = object.find(key);
+  return it != object.end() ? it->second : kNull;
+}
+
+Value& Value::operator[](const std::string& key) {
+  if (is_null()) {
+    data_ = Object();
+  }
+  return std::get<Object>(data_)[key];
+}
+
+namespace {
+
+class Parser {
+ public:
+  explicit Parser(std::string_view text) : text_(text) {}
+
+  Value parse_document() {
+    auto value = parse_value();
+    skip_whitespace();
+    if (pos_ != text_.size()) {
+      fail("trailing characters");
+    }
+    return value;
+  }
+
+ private:
+  [[noreturn]] void fail(const std::string& what) const {
+    throw ParseError("invalid JSON at offset " + std::to_string(pos_) + ": " +
+                     what);
+  }
+
+  void skip_whitespace() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' ||
+            text_[pos_] == '\r')) {
+      ++pos_;
+    }
+  }
+
+  bool consume(std::string_view literal) {
+    if (text_.substr(pos_, literal.size()) == literal) {
+      pos_ += literal.size();
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c) {
+    skip_whitespace();
+    if (pos_ >= text_.size() || text_[pos_] != c) {
+      fail(std::string("expected '") + c + "'");
+    }
+    ++pos_;
+  }
+
+  Value parse_value() {
+    skip_whitespace();
+    if (pos_ >= text_.size()) {
+      fail("unexpected end");
+    }
+    switch (text_[pos_]) {
+      case '{':
+        return parse_object();
+      case '[':
+        return parse_array();
+      case '"':
+        return parse_string();
+      case 't':
+        if (consume("true")) {
+          return true;
+        }
+        break;
+      case 'f':
+        if (consume("false")) {
+          return false;
+        }
+        break;
+      case 'n':
+        if (consume("null")) {
+          return nullptr;
+        }
+        break;
+      default:
+        return parse_number();
+    }
+    fail("unexpected character");
+  }
+
+  Value parse_object() {
+    ++pos_;
+    Value::Object object;
+    skip_whitespace();
+    if (pos_ < text_.size() && text_[pos_] == '}') {
+      ++pos_;
+      return object;
+    }
+    while (true) {
+      skip_whitespace();
+      if (pos_ >= text_.size() || text_[pos_] != '"') {
+        fail("expected a member name");
+      }
+      auto key = parse_string();
+      expect(':');
+      object.insert_or_assign(std::move(key), parse_value());
+      skip_whitespace();
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+        continue;
+      }
+      expect('}');
+      return object;
+    }
+  }
+
+  Value parse_array() {
+    ++pos_;
+    Value::Array array;
+    skip_whitespace();
+    if (pos_ < text_.size() && text_[pos_] == ']') {
+      ++pos_;
+      return array;
+    }
+    while (true) {
+      array.push_back(parse_value());
+      skip_whitespace();
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+        continue;
+      }
+      expect(']');
+      return array;
+    }
+  }
+
+  std::uint32_t parse_hex4() {
+    if (pos_ + 4 > text_.size()) {
+      fail("truncated escape");
+    }
+    std::uint32_t code = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto c = text_[pos_++];
+      code <<= 4;
+      if (c >= '0' && c <= '9') {
+        code |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        code |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        code |= c - 'A' + 10;
+      } else {
+        fail("invalid escape");
+      }
+    }
+    return code;
+  }
+
+  static void append_utf8(std::uint32_t code, std::string* out) {
+    if (code < 0x80) {
+      out->push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  std::string parse_string() {
+    ++pos_;
+    std::string out;
+    while (true) {
+      if (pos_ >= text_.size()) {
+        fail("unterminated string");
+      }
+      auto c = text_[pos_++];
+      if (c == '"') {
+        return out;
+      }
+      if (c != '\\') {
+        out.push_back(c);
+        continue;
+      }
+      if (pos_ >= text_.size()) {
+        fail("unterminated string");
+      }
+      switch (text_[pos_++]) {
+        case '"':
+          out.push_back('"');
+          break;
+        case '\\':
+          out.push_back('\\');
+          break;
+        case '/':
+          out.push_back('/');
+          break;
+        case 'b':
+          out.push_back('\b');
+          break;
+        case 'f':
+          out.push_back('\f');
+          break;
+        case 'n':
+          out.push_back('\n');
+          break;
+        case 'r':
+          out.push_back('\r');
+          break;
+        case 't':
+          out.push_back('\t');
+          break;
+        case 'u': {
+          auto code = parse_hex4();
+          // A surrogate pair encodes a code point beyond the BMP.
+          if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+            auto low = parse_hex4();
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          append_utf8(code, &out);
+          break;
+        }
+        default:
+          fail("invalid escape");
+      }
+    }
+  }
+
+  Value parse_number() {
+    auto start = pos_;
+    while (pos_ < text_.size() &&
+           (std::isdigit(static_cast<unsigned char>(text_[pos_])) ||
+            text_[pos_] == '-' || text_[pos_] == '+' || text_[pos_] == '.' ||
+            text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      ++pos_;
+    }
+    if (start == pos_) {
+      fail("unexpected character");
+    }
+    std::string number(text_.substr(start, pos_ - start));
+    char* end = nullptr;
+    auto value = std::strtod(number.c_str(), &end);
+    if (end != number.c_str() + number.size()) {
+      fail("invalid number");
+    }
+    return value;
+  }
+
+  std::string_view text_;
+  std::size_t pos_ = 0;
+};
+
+void write_string(const std::string& string, std::string* out) {
+  out->push_back('"');
+  for (auto c : string) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escape[7];
+          std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+          out->append(escape);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void write(const Value& value, std::string* out) {
+  if (value.is_null()) {
+    out->append("null");
+  } else if (value.is_bool()) {
+    out->append(value.as_bool() ? "true" : "false");
+  } else if (value.is_number()) {
+    auto number = value.as_number();
+    char buffer[32];
+    // Integers, e.g. request ids and positions, are written without an
+    // exponent or fraction.
+    if (std::trunc(number) == number && std::fabs(number) < 1e15) {
+      std::snprintf(buffer, sizeof(buffer), "%.0f", number);
+    } else {
+      std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+    }
+    out->append(buffer);
+  } else if (value.is_string()) {
+    write_string(value.as_string(), out);
+  } else if (value.is_array()) {
+    out->push_back('[');
+    bool first = true;
+    for (const auto& element : value.as_array()) {
+      if (!first) {
+        out->push_back(',');
+      }
+      first = false;
+      write(element, out);
+    }
+    out->push_back(']');
+  } else {
+    out->push_back('{');
+    bool first = true;
+    for (const auto& [key, member] : value.as_object()) {
+      if (!first) {
+        out->push_back(',');
+      }
+      first = false;
+      write_string(key, out);
+      out->push_back(':');
+      write(member, out);
+    }
+    out->push_back('}');
+  }
+}
+
+}  // namespace
+
+Value parse(std::string_view text) { return Parser(text).parse_document(); }
+
+std::string serialize(const Value& value) {
+  std::string out;
+  write(value, &out);
+  return out;
+}
+
+}  // namespace toolman::json
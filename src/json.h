@@ -0,0 +1,95 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_JSON_H_
+#define TOOLMAN_JSON_H_
+
+#include <cstddef>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace toolman::json {
+
+class ParseError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// A JSON value, as exchanged with editors by the language server. Numbers
+// are doubles, object members are kept sorted by key.
+class Value {
+ public:
+  using Array = std::vector<Value>;
+  using Object = std::map<std::string, Value>;
+
+  // Implicit, so that values can be written as literals.
+  Value() = default;
+  Value(std::nullptr_t) {}
+  Value(bool value) : data_(value) {}
+  Value(double value) : data_(value) {}
+  Value(int value) : data_(static_cast<double>(value)) {}
+  Value(std::size_t value) : data_(static_cast<double>(value)) {}
+  Value(std::string value) : data_(std::move(value)) {}
+  Value(const char* value) : data_(std::string(value)) {}
+  Value(Array value) : data_(std::move(value)) {}
+  Value(Object value) : data_(std::move(value)) {}
+
+  [[nodiscard]] bool is_null() const {
+    return std::holds_alternative<std::nullptr_t>(data_);
+  }
+  [[nodiscard]] bool is_bool() const {
+    return std::holds_alternative<bool>(data_);
+  }
+  [[nodiscard]] bool is_number() const {
+    return std::holds_alternative<double>(data_);
+  }
+  [[nodiscard]] bool is_string() const {
+    return std::holds_alternative<std::string>(data_);
+  }
+  [[nodiscard]] bool is_array() const {
+    return std::holds_alternative<Array>(data_);
+  }
+  [[nodiscard]] bool is_object() const {
+    return std::holds_alternative<Object>(data_);
+  }
+
+  // The accessors throw std::bad_variant_access for a value of another
+  // type.
+  [[nodiscard]] bool as_bool() const { return std::get<bool>(data_); }
+  [[nodiscard]] double as_number() const { return std::get<double>(data_); }
+  [[nodiscard]] const std::string& as_string() const {
+    return std::get<std::string>(data_);
+  }
+  [[nodiscard]] const Array& as_array() const { return std::get<Array>(data_); }
+  [[nodiscard]] const Object& as_object() const {
+    return std::get<Object>(data_);
+  }
+
+  // The member `key` of an object, null if there is none or this is not an
+  // object.
+  [[nodiscard]] const Value& operator[](const std::string& key) const;
+
+  // The member `key`, added if there is none. A null value becomes an empty
+  // object first.
+  Value& operator[](const std::string& key);
+
+ private:
+  std::variant<std::nullptr_t, bool, double, std::string, Array, Object>
+      data_;
+};
+
+// Throws ParseError if `text` is not a single JSON value.
+[[nodiscard]] Value parse(std::string_view text);
+
+// Compact JSON, without whitespace.
+[[nodiscard]] std::string serialize(const Value& value);
+
+}  // namespace toolman::json
+
+#endif  // TOOLMAN_JSON_H_
@@ -9,26 +9,25 @@
 #include <string>
 #include <utility>
 
+#include "src/mem_report.h"
 #include "src/type.h"
 
 namespace toolman {
 
-class ListType final : public Type {
+class ListType final : public Type, private mem::Tracked<ListType> {
  public:
-  template <typename SI>
-  explicit ListType(SI&& stmt_info)
-      : Type("list", std::forward<SI>(stmt_info)) {}
+  static constexpr Kind kKind = Kind::List;
 
-  template <typename SI>
-  ListType(std::shared_ptr<Type> elem_type, SI&& stmt_info)
-      : Type(std::forward<SI>(stmt_info)), elem_type_(std::move(elem_type)) {}
+  ListType() : Type(Kind::List, "list") {}
+
+  // Prefer TypeTable::list, which shares one ListType per element type.
+  explicit ListType(std::shared_ptr<Type> elem_type)
+      : Type(Kind::List, "list"), elem_type_(std::move(elem_type)) {}
 
   [[nodiscard]] const std::shared_ptr<Type>& get_elem_type() const {
     return elem_type_;
   }
 
-  [[nodiscard]] bool is_list() const override { return true; }
-
   [[nodiscard]] std::string to_string() const override {
     return "[" + elem_type_->to_string() + "]";
   }
@@ -41,7 +40,7 @@ class ListType final : public Type {
     if (!rhs.is_list()) {
       return false;
     }
-    return operator==(dynamic_cast<const ListType&>(rhs));
+    return operator==(static_cast<const ListType&>(rhs));
   }
 
   bool operator==(const ListType& rhs) const {
@@ -0,0 +1,67 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/lowering.h"
+
+#include "src/generator.h"
+
+namespace toolman::generator {
+
+void Lowering::lower(const Document& document) {
+  types_.clear();
+  for (const auto& struct_type : document.get_struct_types()) {
+    lower_struct(*struct_type);
+  }
+  for (const auto& enum_type : document.get_enum_types()) {
+    lower_enum(*enum_type);
+  }
+}
+
+void Lowering::lower_struct(const StructType& struct_type) {
+  const auto& struct_name = struct_type.get_name();
+  auto& lowered = types_[&struct_type];
+  lowered.name = naming_rules_->type_name(struct_name);
+  const auto& fields = struct_type.get_fields();
+  lowered.fields.reserve(fields.size());
+  for (std::size_t i = 0; i < fields.size(); ++i) {
+    const auto& field = fields[i];
+    LoweredField lowered_field;
+    lowered_field.name = naming_rules_->field_name(field.get_name());
+    lowered_field.capitalized_name = capitalize(lowered_field.name);
+    if (field.get_type()->is_oneof()) {
+      lowered_field.oneof_name =
+          naming_rules_->oneof_name(struct_name, field.get_name());
+      lowered.oneof_fields.push_back(i);
+
+      const auto& oneof = static_cast<const OneofType&>(*field.get_type());
+      auto& lowered_oneof = types_[&oneof];
+      lowered_oneof.name = lowered_field.oneof_name;
+      for (const auto& alternative : oneof.get_fields()) {
+        LoweredField lowered_alternative;
+        lowered_alternative.name =
+            naming_rules_->field_name(alternative.get_name());
+        lowered_alternative.capitalized_name =
+            capitalize(lowered_alternative.name);
+        lowered_alternative.wrapper_name = naming_rules_->oneof_wrapper_name(
+            struct_name, alternative.get_name());
+        lowered_oneof.fields.push_back(std::move(lowered_alternative));
+      }
+    }
+    lowered.fields.push_back(std::move(lowered_field));
+  }
+}
+
+void Lowering::lower_enum(const EnumType& enum_type) {
+  auto& lowered = types_[&enum_type];
+  lowered.name = naming_rules_->type_name(enum_type.get_name());
+  for (const auto& field : enum_type.get_fields()) {
+    LoweredField lowered_field;
+    lowered_field.name =
+        naming_rules_->enum_field_name(enum_type.get_name(), field.get_name());
+    lowered_field.capitalized_name = capitalize(lowered_field.name);
+    lowered.fields.push_back(std::move(lowered_field));
+  }
+}
+
+}  // namespace toolman::generator
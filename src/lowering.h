@@ -0,0 +1,96 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_LOWERING_H_
+#define TOOLMAN_LOWERING_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/custom_type.h"
+#include "src/document.h"
+#include "src/type.h"
+
+namespace toolman::generator {
+
+// How a target language names the declarations of a schema. Every function
+// takes the names as written in the schema.
+class NamingRules {
+ public:
+  virtual ~NamingRules() = default;
+
+  [[nodiscard]] virtual std::string type_name(const std::string& name) const {
+    return name;
+  }
+
+  [[nodiscard]] virtual std::string field_name(const std::string& name) const {
+    return name;
+  }
+
+  [[nodiscard]] virtual std::string enum_field_name(
+      const std::string& enum_name, const std::string& name) const {
+    return name;
+  }
+
+  // The interface implemented by the alternatives of a oneof field.
+  [[nodiscard]] virtual std::string oneof_name(
+      const std::string& struct_name, const std::string& field_name) const {
+    return "";
+  }
+
+  // The class wrapping one alternative of a oneof field.
+  [[nodiscard]] virtual std::string oneof_wrapper_name(
+      const std::string& struct_name, const std::string& field_name) const {
+    return "";
+  }
+};
+
+// A field as named in the generated code.
+struct LoweredField {
+  std::string name;
+  // `name` starting with a capital, e.g. for accessors.
+  std::string capitalized_name;
+  // Of a oneof field: the interface its alternatives implement.
+  std::string oneof_name;
+  // Of an alternative of a oneof: the class wrapping it.
+  std::string wrapper_name;
+};
+
+struct LoweredType {
+  std::string name;
+  // In the order of `get_fields()`.
+  std::vector<LoweredField> fields;
+  // Indices of the oneof fields of a struct, in declaration order.
+  std::vector<std::size_t> oneof_fields;
+};
+
+// Names every type and field of a document once per target, generators only
+// look them up instead of transforming identifiers on every use.
+class Lowering {
+ public:
+  explicit Lowering(const NamingRules* naming_rules)
+      : naming_rules_(naming_rules) {}
+
+  // Lowers the struct and enum types of `document`, with the oneofs of their
+  // fields, forgetting the previous document.
+  void lower(const Document& document);
+
+  // `type` must be lowered by the last `lower`.
+  [[nodiscard]] const LoweredType& operator[](const Type* type) const {
+    return types_.at(type);
+  }
+
+ private:
+  void lower_struct(const StructType& struct_type);
+  void lower_enum(const EnumType& enum_type);
+
+  const NamingRules* naming_rules_;
+  std::unordered_map<const Type*, LoweredType> types_;
+};
+
+}  // namespace toolman::generator
+
+#endif  // TOOLMAN_LOWERING_H_
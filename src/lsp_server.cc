@@ -0,0 +1,822 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/lsp_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "src/decl_scanner.h"
+#include "src/hash.h"
+#include "src/parse_context.h"
+#include "src/type_visitor.h"
+
+namespace toolman::lsp {
+
+namespace {
+
+bool is_word_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+bool is_continuation_byte(char c) {
+  return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// Every word of `text`, sorted and unique. A superset of the type names the
+// statement refers to, comments and keywords included.
+std::vector<std::string> words_of(const std::string& text) {
+  std::vector<std::string> words;
+  for (std::size_t i = 0; i < text.size();) {
+    if (!is_word_char(text[i])) {
+      ++i;
+      continue;
+    }
+    auto start = i;
+    while (i < text.size() && is_word_char(text[i])) {
+      ++i;
+    }
+    words.emplace_back(text, start, i - start);
+  }
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+  return words;
+}
+
+// The first word of a statement starting at `line` and `column`, where
+// errors without a location of their own are shown.
+Range anchor_of(const std::string& text, std::size_t line,
+                std::size_t column) {
+  std::size_t i = 0;
+  for (; i < text.size() && std::isspace(static_cast<unsigned char>(text[i]));
+       ++i) {
+    if (text[i] == '\n') {
+      ++line;
+      column = 0;
+    } else {
+      ++column;
+    }
+  }
+  std::size_t length = 0;
+  while (i + length < text.size() && is_word_char(text[i + length])) {
+    ++length;
+  }
+  Position start{line - 1, column};
+  return Range{start, Position{start.line, column + std::max<std::size_t>(
+                                                        length, 1)}};
+}
+
+Diagnostic to_diagnostic(const Error& error, const Range& anchor) {
+  Diagnostic diagnostic{anchor, error.level(), error.error()};
+  if (const auto& location = error.location(); location.has_value()) {
+    auto line = std::max(location->get_line_no().first, 1U) - 1;
+    const auto& columns = location->get_column_no();
+    diagnostic.range = Range{Position{line, columns.first},
+                             Position{line, columns.second}};
+  }
+  return diagnostic;
+}
+
+// Collects the lexer and parser errors of a parse instead of printing them.
+class SyntaxErrorCollector final : public antlr4::BaseErrorListener,
+                                   public HasMultiError {
+ public:
+  explicit SyntaxErrorCollector(std::shared_ptr<std::filesystem::path> source)
+      : source_(std::move(source)) {}
+
+  void syntaxError(antlr4::Recognizer* recognizer,
+                   antlr4::Token* offending_symbol, std::size_t line,
+                   std::size_t char_position_in_line,
+                   const std::string& message, std::exception_ptr) override {
+    auto column = static_cast<unsigned int>(char_position_in_line);
+    auto end_column = column + 1;
+    // The lexer reports characters it cannot match, without a token.
+    auto type = offending_symbol == nullptr ? Error::ErrorType::Lexer
+                                            : Error::ErrorType::Syntax;
+    if (offending_symbol != nullptr &&
+        offending_symbol->getStopIndex() >= offending_symbol->getStartIndex()) {
+      end_column = token_columns(*offending_symbol).second;
+    }
+    push_error(SyntaxError(
+        type, message,
+        StmtInfo({static_cast<unsigned int>(line),
+                  static_cast<unsigned int>(line)},
+                 {column, end_column}, source_)));
+  }
+
+ private:
+  std::shared_ptr<std::filesystem::path> source_;
+};
+
+ParseContextPool::Lease acquire(const std::string& text, std::size_t line,
+                                std::size_t column) {
+  auto parse_context = ParseContextPool::acquire(text);
+  // Tokens carry their position in the document, not in the statement.
+  parse_context->lexer().setLine(line);
+  parse_context->lexer().setCharPositionInLine(column);
+  return parse_context;
+}
+
+}  // namespace
+
+void OpenDocument::edit(const std::optional<Range>& range,
+                        const std::string& text) {
+  if (!range.has_value()) {
+    text_ = text;
+    return;
+  }
+  auto begin = offset_of(range->start);
+  auto end = std::max(begin, offset_of(range->end));
+  text_.replace(begin, end - begin, text);
+}
+
+std::size_t OpenDocument::offset_of(Position position) const {
+  std::size_t offset = 0;
+  for (std::size_t line = 0; line < position.line; ++line) {
+    offset = text_.find('\n', offset);
+    if (offset == std::string::npos) {
+      return text_.size();
+    }
+    ++offset;
+  }
+  for (std::size_t character = 0;
+       character < position.character && offset < text_.size() &&
+       text_[offset] != '\n';
+       ++character) {
+    ++offset;
+    while (offset < text_.size() && is_continuation_byte(text_[offset])) {
+      ++offset;
+    }
+  }
+  return offset;
+}
+
+void OpenDocument::move_statement(Statement* statement, std::size_t line) {
+  if (line == statement->line) {
+    return;
+  }
+  // Every line of the statement is at or after its first line.
+  auto move = [&](std::size_t old_line) {
+    return old_line + line - statement->line;
+  };
+  for (auto& diagnostic : statement->diagnostics) {
+    diagnostic.range.start.line = move(diagnostic.range.start.line);
+    diagnostic.range.end.line = move(diagnostic.range.end.line);
+  }
+  auto move_declaration = [&](HasStmtInfo* declaration) {
+    const auto& stmt_info = declaration->get_stmt_info();
+    const auto& lines = stmt_info.get_line_no();
+    declaration->mut_stmt_info() = StmtInfo(
+        {static_cast<unsigned int>(move(lines.first)),
+         static_cast<unsigned int>(move(lines.second))},
+        stmt_info.get_column_no(), stmt_info.get_source());
+  };
+  for (const auto& type : statement->types) {
+    if (auto* struct_type = type_cast<StructType>(type.get())) {
+      move_declaration(struct_type);
+    } else if (auto* enum_type = type_cast<EnumType>(type.get())) {
+      move_declaration(enum_type);
+    }
+  }
+  statement->line = line;
+}
+
+void OpenDocument::compile_statement(const std::string& text,
+                                     Statement* statement,
+                                     PhaseListeners* phase_listeners) {
+  ++reparsed_;
+  statement->diagnostics.clear();
+  auto anchor = anchor_of(text, statement->line, statement->column);
+  SyntaxErrorCollector syntax_errors(source_);
+  auto parse_context = acquire(text, statement->line, statement->column);
+  parse_context->set_error_listener(&syntax_errors);
+  antlr4::tree::ParseTree* tree;
+  {
+    PhaseScope lex_phase(phase_listeners, Phase::Lex);
+    parse_context->tokens().fill();
+  }
+  {
+    PhaseScope parse_phase(phase_listeners, Phase::Parse);
+    tree = parse_context->parser().document();
+  }
+  for (const auto& error : syntax_errors.errors()) {
+    statement->diagnostics.push_back(to_diagnostic(error, anchor));
+  }
+  // Imports are resolved by the scanner. A statement the parser had to
+  // recover from is not walked, its references would only add noise.
+  statement->syntax_error = syntax_errors.has_error();
+  if (statement->syntax_error ||
+      statement->kind == StatementSplitter::Kind::Import) {
+    return;
+  }
+
+  // The types of an unchanged statement still hold the fields of its last
+  // walk.
+  for (const auto& type : statement->types) {
+    if (auto* struct_type = type_cast<StructType>(type.get())) {
+      struct_type->clear_fields();
+    } else if (auto* enum_type = type_cast<EnumType>(type.get())) {
+      enum_type->clear_fields();
+    }
+  }
+  auto ref_phase_walker =
+      RefPhaseWalker(type_scope_, option_scope_, source_, &type_table_);
+  try {
+    PhaseScope ref_phase(phase_listeners, Phase::RefWalk);
+    antlr4::tree::ParseTreeWalker::DEFAULT.walk(&ref_phase_walker, tree);
+  } catch (std::runtime_error& e) {
+    // The scanner and the parser disagree about a declaration.
+    statement->diagnostics.push_back(
+        Diagnostic{anchor, Error::Level::Fatal, e.what()});
+  }
+  for (const auto& error : ref_phase_walker.errors()) {
+    statement->diagnostics.push_back(to_diagnostic(error, anchor));
+  }
+}
+
+void OpenDocument::analyze(Compiler* compiler) {
+  auto* phase_listeners = &compiler->phase_listeners();
+  compiler->set_importer(*source_);
+  type_table_.clear();
+  reparsed_ = 0;
+
+  // Statements of the last analysis by the hash of their text, each is
+  // reused at most once.
+  std::unordered_multimap<std::uint64_t, std::size_t> previous;
+  for (std::size_t i = 0; i < statements_.size(); ++i) {
+    previous.emplace(statements_[i].hash, i);
+  }
+  auto previous_statements = std::move(statements_);
+  statements_.clear();
+  std::vector<std::string> texts;
+  std::vector<bool> changed;
+
+  // Pass 1: declares the types of every statement, scanning only the
+  // changed ones, and resolves the imports.
+  auto decl_scanner = DeclScanner(source_, compiler);
+  std::vector<Diagnostic> decl_diagnostics;
+  auto take_decl_errors = [&](const Range& anchor) {
+    const auto& errors = decl_scanner.errors();
+    for (auto i = decl_diagnostics.size(); i < errors.size(); ++i) {
+      decl_diagnostics.push_back(to_diagnostic(errors[i], anchor));
+    }
+  };
+  SyntaxErrorCollector scan_errors(source_);
+  auto scan = [&](const StatementSplitter::Statement& split) {
+    auto parse_context = acquire(split.text, split.line, split.column);
+    // Reported by the parse of the statement.
+    parse_context->set_error_listener(&scan_errors);
+    PhaseScope scan_phase(phase_listeners, Phase::DeclScan);
+    decl_scanner.scan(&parse_context->lexer());
+  };
+
+  std::istringstream istream(text_);
+  StatementSplitter splitter(&istream);
+  while (auto split = splitter.next()) {
+    if (split->kind == StatementSplitter::Kind::Trailing) {
+      continue;
+    }
+    auto hash = hash::fnv1a(split->text);
+    std::optional<Statement> statement;
+    // Positions within the first line only carry over from the same column.
+    auto [first, last] = previous.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+      auto& candidate = previous_statements[it->second];
+      if (candidate.kind == split->kind && candidate.column == split->column) {
+        statement = std::move(candidate);
+        previous.erase(it);
+        move_statement(&*statement, split->line);
+        break;
+      }
+    }
+    changed.push_back(!statement.has_value());
+    if (!statement.has_value()) {
+      statement = Statement{split->kind, hash, split->line, split->column};
+      statement->words = words_of(split->text);
+    }
+
+    if (split->kind == StatementSplitter::Kind::Import) {
+      // Scanned every time, the imported modules may have changed.
+      scan(*split);
+    } else if (split->kind == StatementSplitter::Kind::Declaration) {
+      if (changed.back()) {
+        auto first_type = decl_scanner.types().size();
+        scan(*split);
+        statement->types.assign(decl_scanner.types().begin() + first_type,
+                                decl_scanner.types().end());
+      } else {
+        for (const auto& type : statement->types) {
+          decl_scanner.declare(type);
+        }
+      }
+    }
+    take_decl_errors(anchor_of(split->text, split->line, split->column));
+    statements_.push_back(std::move(*statement));
+    texts.push_back(std::move(split->text));
+  }
+  type_scope_ = decl_scanner.type_scope();
+  option_scope_ = decl_scanner.option_scope();
+
+  // Names declared or removed by the change, unchanged statements
+  // mentioning one resolve their references again.
+  auto names = type_scope_->visible_names();
+  std::vector<std::string> changed_names;
+  std::set_symmetric_difference(names_.begin(), names_.end(), names.begin(),
+                                names.end(),
+                                std::back_inserter(changed_names));
+  names_ = std::move(names);
+  auto mentions_changed_name = [&](const Statement& statement) {
+    return std::any_of(changed_names.begin(), changed_names.end(),
+                       [&](const std::string& name) {
+                         return std::binary_search(statement.words.begin(),
+                                                   statement.words.end(),
+                                                   name);
+                       });
+  };
+
+  // Pass 2: parses the changed statements, then walks them and the
+  // statements their names affect.
+  diagnostics_ = std::move(decl_diagnostics);
+  for (std::size_t i = 0; i < statements_.size(); ++i) {
+    auto& statement = statements_[i];
+    if (changed[i] ||
+        (statement.kind != StatementSplitter::Kind::Import &&
+         !statement.syntax_error && mentions_changed_name(statement))) {
+      compile_statement(texts[i], &statement, phase_listeners);
+    }
+    diagnostics_.insert(diagnostics_.end(), statement.diagnostics.begin(),
+                        statement.diagnostics.end());
+  }
+}
+
+std::optional<Location> OpenDocument::definition(Position position) const {
+  if (!type_scope_) {
+    return std::nullopt;
+  }
+  auto offset = offset_of(position);
+  auto begin = offset;
+  while (begin > 0 && is_word_char(text_[begin - 1])) {
+    --begin;
+  }
+  auto end = offset;
+  while (end < text_.size() && is_word_char(text_[end])) {
+    ++end;
+  }
+  if (begin == end) {
+    return std::nullopt;
+  }
+  auto type = type_scope_->lookup(text_.substr(begin, end - begin));
+  if (!type.has_value()) {
+    return std::nullopt;
+  }
+  const auto* declaration = declaration_of(*type.value());
+  if (declaration == nullptr || !declaration->get_source()) {
+    return std::nullopt;
+  }
+  auto line = std::max(declaration->get_line_no().first, 1U) - 1;
+  const auto& columns = declaration->get_column_no();
+  return Location{*declaration->get_source(),
+                  Range{Position{line, columns.first},
+                        Position{line, columns.second}}};
+}
+
+std::map<std::string, std::shared_ptr<Type>> OpenDocument::visible_types()
+    const {
+  std::map<std::string, std::shared_ptr<Type>> types;
+  if (type_scope_) {
+    for (const auto& name : names_) {
+      types.emplace(name, type_scope_->lookup(name).value());
+    }
+  }
+  return types;
+}
+
+namespace {
+
+// Content larger than this is rejected instead of allocated.
+constexpr std::size_t kMaxContentLength = std::size_t{1} << 26;
+
+// A message whose header has no valid Content-Length. Its content cannot be
+// told apart from the headers of the next message, which is found by
+// searching for the next Content-Length header.
+class HeaderError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Reads the next message, std::nullopt at the end of the stream. Throws
+// HeaderError after the headers of a message with a bad Content-Length.
+std::optional<std::string> read_message(std::istream& in) {
+  static constexpr std::string_view kContentLength = "Content-Length:";
+  std::optional<std::size_t> length;
+  std::optional<std::string> bad_length;
+  std::string header;
+  while (std::getline(in, header)) {
+    if (!header.empty() && header.back() == '\r') {
+      header.pop_back();
+    }
+    if (header.empty()) {
+      if (length.has_value() || bad_length.has_value()) {
+        break;
+      }
+      continue;
+    }
+    // Not only at the start of the line, the content of a skipped message
+    // precedes the header of the next one.
+    auto at = header.find(kContentLength);
+    if (at == std::string::npos) {
+      continue;
+    }
+    std::string_view value(header);
+    value.remove_prefix(at + kContentLength.size());
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+      value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+      value.remove_suffix(1);
+    }
+    std::size_t parsed = 0;
+    auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), parsed);
+    if (error != std::errc() || end != value.data() + value.size() ||
+        parsed > kMaxContentLength) {
+      length.reset();
+      bad_length = std::string(value);
+    } else {
+      length = parsed;
+      bad_length.reset();
+    }
+  }
+  if (bad_length.has_value()) {
+    throw HeaderError("bad Content-Length `" + *bad_length + "`");
+  }
+  if (!length.has_value()) {
+    return std::nullopt;
+  }
+  std::string content(*length, '\0');
+  in.read(content.data(), static_cast<std::streamsize>(*length));
+  if (static_cast<std::size_t>(in.gcount()) != *length) {
+    return std::nullopt;
+  }
+  return content;
+}
+
+void write_message(std::ostream& out, const json::Value& message) {
+  auto content = json::serialize(message);
+  out << "Content-Length: " << content.size() << "\r\n\r\n"
+      << content << std::flush;
+}
+
+constexpr std::string_view kFileScheme = "file://";
+
+std::filesystem::path path_of(const std::string& uri) {
+  std::string path;
+  auto start = uri.compare(0, kFileScheme.size(), kFileScheme) == 0
+                   ? kFileScheme.size()
+                   : 0;
+  for (auto i = start; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size()) {
+      path.push_back(
+          static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+      i += 2;
+    } else {
+      path.push_back(uri[i]);
+    }
+  }
+  return std::filesystem::path(path).lexically_normal();
+}
+
+std::string uri_of(const std::filesystem::path& path) {
+  static constexpr char kDigits[] = "0123456789ABCDEF";
+  std::string uri(kFileScheme);
+  for (auto c : path.generic_string()) {
+    if (std::isalnum(static_cast<unsigned char>(c)) || c == '/' || c == '-' ||
+        c == '.' || c == '_' || c == '~') {
+      uri.push_back(c);
+    } else {
+      auto byte = static_cast<unsigned char>(c);
+      uri.push_back('%');
+      uri.push_back(kDigits[byte >> 4]);
+      uri.push_back(kDigits[byte & 0xF]);
+    }
+  }
+  return uri;
+}
+
+Position position_of(const json::Value& position) {
+  return Position{static_cast<std::size_t>(position["line"].as_number()),
+                  static_cast<std::size_t>(position["character"].as_number())};
+}
+
+json::Value to_json(Position position) {
+  json::Value value;
+  value["line"] = position.line;
+  value["character"] = position.character;
+  return value;
+}
+
+json::Value to_json(const Range& range) {
+  json::Value value;
+  value["start"] = to_json(range.start);
+  value["end"] = to_json(range.end);
+  return value;
+}
+
+json::Value to_json(const Diagnostic& diagnostic) {
+  json::Value value;
+  value["range"] = to_json(diagnostic.range);
+  switch (diagnostic.level) {
+    case Error::Level::Fatal:
+      value["severity"] = 1;
+      break;
+    case Error::Level::Warning:
+      value["severity"] = 2;
+      break;
+    case Error::Level::Note:
+      value["severity"] = 3;
+      break;
+  }
+  value["source"] = "toolman";
+  value["message"] = diagnostic.message;
+  return value;
+}
+
+json::Value response_error(int code, const std::string& message) {
+  json::Value error;
+  error["code"] = code;
+  error["message"] = message;
+  return error;
+}
+
+// JSON-RPC error codes.
+constexpr int kParseError = -32700;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInternalError = -32603;
+
+}  // namespace
+
+Server::Server(Compiler* compiler, std::shared_ptr<SourceProvider> sources)
+    : compiler_(compiler),
+      overlay_(std::make_shared<OverlaySourceProvider>(std::move(sources))) {
+  compiler_->set_source_provider(overlay_);
+}
+
+int Server::run(std::istream& in, std::ostream& out) {
+  while (!exit_) {
+    std::optional<std::string> content;
+    json::Value message;
+    try {
+      content = read_message(in);
+      if (!content.has_value()) {
+        break;
+      }
+      message = json::parse(*content);
+    } catch (std::runtime_error& e) {
+      // A HeaderError or a json::ParseError, the message is skipped.
+      json::Value response;
+      response["jsonrpc"] = "2.0";
+      response["id"] = nullptr;
+      response["error"] = response_error(kParseError, e.what());
+      write_message(out, response);
+      continue;
+    }
+
+    const auto& method = message["method"];
+    const auto& id = message["id"];
+    json::Value response;
+    response["jsonrpc"] = "2.0";
+    response["id"] = id;
+    try {
+      if (auto result = handle(method.is_string() ? method.as_string() : "",
+                               message["params"]);
+          result.has_value()) {
+        response["result"] = std::move(*result);
+      } else {
+        response["error"] = response_error(
+            kMethodNotFound, "unknown method " +
+                                 (method.is_string() ? method.as_string() : ""));
+      }
+    } catch (std::exception& e) {
+      // E.g. params of the wrong type.
+      response["error"] = response_error(kInternalError, e.what());
+    }
+    // Notifications get no response.
+    if (!id.is_null()) {
+      write_message(out, response);
+    }
+    for (const auto& notification : notifications_) {
+      write_message(out, notification);
+    }
+    notifications_.clear();
+  }
+  return shutdown_ ? 0 : 1;
+}
+
+std::optional<json::Value> Server::handle(const std::string& method,
+                                          const json::Value& params) {
+  if (method == "initialize") {
+    json::Value result;
+    auto& capabilities = result["capabilities"];
+    capabilities["textDocumentSync"]["openClose"] = true;
+    // Incremental: only the edited ranges are sent.
+    capabilities["textDocumentSync"]["change"] = 2;
+    capabilities["definitionProvider"] = true;
+    capabilities["completionProvider"]["resolveProvider"] = false;
+    result["serverInfo"]["name"] = "toolman";
+    return result;
+  }
+  if (method == "shutdown") {
+    shutdown_ = true;
+    return json::Value();
+  }
+  if (method == "exit") {
+    exit_ = true;
+    return json::Value();
+  }
+  if (method == "textDocument/didOpen") {
+    open(params);
+    return json::Value();
+  }
+  if (method == "textDocument/didChange") {
+    auto start = std::chrono::steady_clock::now();
+    change(params);
+    edit_latencies_.push_back(std::chrono::steady_clock::now() - start);
+    return json::Value();
+  }
+  if (method == "textDocument/didClose") {
+    close(params);
+    return json::Value();
+  }
+  if (method == "textDocument/definition") {
+    return definition(params);
+  }
+  if (method == "textDocument/completion") {
+    return completion(params);
+  }
+  if (method == "initialized" || method == "textDocument/didSave" ||
+      method.compare(0, 2, "$/") == 0) {
+    return json::Value();
+  }
+  return std::nullopt;
+}
+
+OpenDocument* Server::find(const json::Value& params) const {
+  const auto& uri = params["textDocument"]["uri"];
+  if (!uri.is_string()) {
+    return nullptr;
+  }
+  auto it = documents_.find(path_of(uri.as_string()));
+  return it != documents_.end() ? it->second.get() : nullptr;
+}
+
+void Server::open(const json::Value& params) {
+  const auto& text_document = params["textDocument"];
+  auto path = path_of(text_document["uri"].as_string());
+  const auto& text = text_document["text"].as_string();
+  overlay_->set_file(path, text);
+  auto& document = documents_[path];
+  document = std::make_unique<OpenDocument>(path, text);
+  analyze(document.get());
+  source_changed(path);
+}
+
+void Server::change(const json::Value& params) {
+  auto* document = find(params);
+  if (document == nullptr) {
+    return;
+  }
+  for (const auto& change : params["contentChanges"].as_array()) {
+    std::optional<Range> range;
+    if (const auto& edited = change["range"]; edited.is_object()) {
+      range = Range{position_of(edited["start"]), position_of(edited["end"])};
+    }
+    document->edit(range, change["text"].as_string());
+  }
+  overlay_->set_file(document->path(), document->text());
+  analyze(document);
+  source_changed(document->path());
+}
+
+void Server::close(const json::Value& params) {
+  auto* document = find(params);
+  if (document == nullptr) {
+    return;
+  }
+  auto path = document->path();
+  documents_.erase(path);
+  overlay_->remove_file(path);
+  json::Value notification;
+  notification["jsonrpc"] = "2.0";
+  notification["method"] = "textDocument/publishDiagnostics";
+  notification["params"]["uri"] = uri_of(path);
+  notification["params"]["diagnostics"] = json::Value::Array();
+  notifications_.push_back(std::move(notification));
+  // The file on disk may differ from the closed buffer.
+  source_changed(path);
+}
+
+json::Value Server::definition(const json::Value& params) const {
+  auto* document = find(params);
+  if (document == nullptr) {
+    return json::Value();
+  }
+  auto location = document->definition(position_of(params["position"]));
+  if (!location.has_value()) {
+    return json::Value();
+  }
+  json::Value value;
+  value["uri"] = uri_of(location->path);
+  value["range"] = to_json(location->range);
+  return value;
+}
+
+json::Value Server::completion(const json::Value& params) const {
+  // CompletionItemKind of the protocol.
+  static constexpr int kKeyword = 14;
+  static constexpr int kEnum = 13;
+  static constexpr int kStruct = 22;
+
+  json::Value::Array items;
+  auto add_item = [&](const std::string& label, int kind) {
+    json::Value item;
+    item["label"] = label;
+    item["kind"] = kind;
+    items.push_back(std::move(item));
+  };
+  for (const auto* primitive :
+       {"any", "bool", "float", "i32", "i64", "string", "u32", "u64"}) {
+    add_item(primitive, kKeyword);
+  }
+  if (auto* document = find(params); document != nullptr) {
+    for (const auto& [name, type] : document->visible_types()) {
+      add_item(name, type->is_enum() ? kEnum : kStruct);
+    }
+  }
+  return items;
+}
+
+void Server::analyze(OpenDocument* document) {
+  document->analyze(compiler_);
+  reparsed_ += document->reparsed();
+  statements_ += document->statement_count();
+
+  json::Value::Array diagnostics;
+  for (const auto& diagnostic : document->diagnostics()) {
+    diagnostics.push_back(to_json(diagnostic));
+  }
+  json::Value notification;
+  notification["jsonrpc"] = "2.0";
+  notification["method"] = "textDocument/publishDiagnostics";
+  notification["params"]["uri"] = uri_of(document->path());
+  notification["params"]["diagnostics"] = std::move(diagnostics);
+  notifications_.push_back(std::move(notification));
+}
+
+void Server::source_changed(const std::filesystem::path& path) {
+  // Importers only exist if the file was compiled as a module.
+  if (!compiler_->has_module(path)) {
+    return;
+  }
+  compiler_->forget_modules();
+  for (const auto& [document_path, document] : documents_) {
+    if (document_path != path) {
+      analyze(document.get());
+    }
+  }
+}
+
+void Server::report(std::ostream& ostream) const {
+  std::vector<double> latencies;
+  latencies.reserve(edit_latencies_.size());
+  for (auto latency : edit_latencies_) {
+    latencies.push_back(
+        std::chrono::duration<double, std::milli>(latency).count());
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    if (latencies.empty()) {
+      return 0.0;
+    }
+    auto rank = static_cast<std::size_t>(
+        std::ceil(p * static_cast<double>(latencies.size())));
+    return latencies[std::max<std::size_t>(rank, 1) - 1];
+  };
+  ostream << "lsp: " << latencies.size() << " edit(s), " << std::fixed
+          << std::setprecision(3) << "p50 " << percentile(0.5) << " ms, p99 "
+          << percentile(0.99) << " ms, max " << percentile(1.0) << " ms; "
+          << reparsed_ << " of " << statements_
+          << " statement(s) parsed again" << "\n";
+}
+
+}  // namespace toolman::lsp
@@ -0,0 +1,187 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_LSP_SERVER_H_
+#define TOOLMAN_LSP_SERVER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "src/compiler.h"
+#include "src/json.h"
+#include "src/source_provider.h"
+#include "src/statement_splitter.h"
+#include "src/type_table.h"
+
+namespace toolman::lsp {
+
+// A position as the protocol counts it: lines and characters from 0.
+// Characters are code points, like the columns of the compiler; they only
+// differ from the protocol's UTF-16 units beyond the BMP.
+struct Position {
+  std::size_t line = 0;
+  std::size_t character = 0;
+};
+
+struct Range {
+  Position start;
+  Position end;
+};
+
+struct Location {
+  std::filesystem::path path;
+  Range range;
+};
+
+struct Diagnostic {
+  Range range;
+  Error::Level level;
+  std::string message;
+};
+
+// A document open in the editor, analysed again after every change.
+//
+// Analysis is incremental per top level statement, the unit the grammar can
+// be restarted at. The text is split by StatementSplitter, which does not
+// lex, and only the statements whose text changed are lexed, parsed and
+// walked again. Unchanged statements keep their declared types and their
+// diagnostics, moved to their new lines. They are walked again only when a
+// name they mention is declared or removed by the change, as that decides
+// whether their references resolve. Imported modules are compiled through
+// the compiler, which keeps them between analyses.
+class OpenDocument final {
+ public:
+  OpenDocument(const std::filesystem::path& path, std::string text)
+      : source_(std::make_shared<std::filesystem::path>(path)),
+        text_(std::move(text)) {}
+
+  // Replaces `range` by `text`, the whole document without a range.
+  void edit(const std::optional<Range>& range, const std::string& text);
+
+  void analyze(Compiler* compiler);
+
+  [[nodiscard]] const std::filesystem::path& path() const { return *source_; }
+
+  [[nodiscard]] const std::string& text() const { return text_; }
+
+  [[nodiscard]] const std::vector<Diagnostic>& diagnostics() const {
+    return diagnostics_;
+  }
+
+  // Where the type named at `position` is declared, in this document or in
+  // an imported one.
+  [[nodiscard]] std::optional<Location> definition(Position position) const;
+
+  // Every type visible in the document by name, imported ones included.
+  [[nodiscard]] std::map<std::string, std::shared_ptr<Type>> visible_types()
+      const;
+
+  // Statements lexed and parsed by the last analysis, of `statement_count`.
+  [[nodiscard]] std::size_t reparsed() const { return reparsed_; }
+
+  [[nodiscard]] std::size_t statement_count() const {
+    return statements_.size();
+  }
+
+ private:
+  struct Statement {
+    StatementSplitter::Kind kind;
+    std::uint64_t hash;
+    // Of the first character, when the statement was last analysed.
+    std::size_t line;
+    std::size_t column;
+    // Struct and enum types of a declaration.
+    std::vector<std::shared_ptr<Type>> types;
+    // Every word of the text, sorted, e.g. the type names it refers to.
+    std::vector<std::string> words;
+    std::vector<Diagnostic> diagnostics;
+    bool syntax_error = false;
+  };
+
+  // Byte offset of `position` in the text, clamped to its line.
+  [[nodiscard]] std::size_t offset_of(Position position) const;
+
+  // Lexes and parses `text`, the text of `statement`, then walks it unless
+  // it has syntax errors.
+  void compile_statement(const std::string& text, Statement* statement,
+                         PhaseListeners* phase_listeners);
+
+  // Moves a statement that did not change to its new first line.
+  static void move_statement(Statement* statement, std::size_t line);
+
+  std::shared_ptr<std::filesystem::path> source_;
+  std::string text_;
+  std::vector<Statement> statements_;
+  std::shared_ptr<TypeScope> type_scope_;
+  std::shared_ptr<OptionScope> option_scope_;
+  // Names visible at the last analysis.
+  std::set<std::string> names_;
+  std::vector<Diagnostic> diagnostics_;
+  TypeTable type_table_;
+  std::size_t reparsed_ = 0;
+};
+
+// Language server for `.tm` files, speaking the Language Server Protocol
+// over a byte stream: diagnostics, go to definition and completion of type
+// names.
+class Server final {
+ public:
+  // Open documents shadow the files of `sources`, which become the sources
+  // of `compiler`.
+  Server(Compiler* compiler, std::shared_ptr<SourceProvider> sources);
+
+  // Serves the messages read from `in` until the client exits or closes the
+  // stream. Returns the exit code of the process.
+  int run(std::istream& in, std::ostream& out);
+
+  // Latency of the analyses after edits, e.g. of a recorded session
+  // replayed through `run`.
+  void report(std::ostream& ostream) const;
+
+ private:
+  // The result of the request or notification `method`, std::nullopt if
+  // the method is unknown.
+  std::optional<json::Value> handle(const std::string& method,
+                                    const json::Value& params);
+
+  void open(const json::Value& params);
+  void change(const json::Value& params);
+  void close(const json::Value& params);
+  json::Value definition(const json::Value& params) const;
+  json::Value completion(const json::Value& params) const;
+
+  // Analyses `document` and queues its diagnostics.
+  void analyze(OpenDocument* document);
+
+  // After a change of the file at `path`: analyses the other documents
+  // again if they may import it.
+  void source_changed(const std::filesystem::path& path);
+
+  [[nodiscard]] OpenDocument* find(const json::Value& params) const;
+
+  Compiler* compiler_;
+  std::shared_ptr<OverlaySourceProvider> overlay_;
+  std::map<std::filesystem::path, std::unique_ptr<OpenDocument>> documents_;
+  // Notifications to send after the current message.
+  std::vector<json::Value> notifications_;
+  bool shutdown_ = false;
+  bool exit_ = false;
+  std::vector<std::chrono::steady_clock::duration> edit_latencies_;
+  std::size_t reparsed_ = 0;
+  std::size_t statements_ = 0;
+};
+
+}  // namespace toolman::lsp
+
+#endif  // TOOLMAN_LSP_SERVER_H_
@@ -2,39 +2,407 @@
 // Use of this source code is governed by a MIT license that can be
 // found in the LICENSE file.
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
+#include "src/compile_cache.h"
 #include "src/compiler.h"
+#include "src/depfile.h"
+#include "src/fragment_cache.h"
 #include "src/generator.h"
+#include "src/lsp_server.h"
+#include "src/mem_report.h"
+#include "src/perf_counters.h"
+#include "src/plugin.h"
+#include "src/schema_image.h"
 
 int main(int argc, char **argv) {
   std::string filename = "/Users/ty/Desktop/toolman_examples.tm";  // for debug
   toolman::generator::TargetLanguage target =
       toolman::generator::target_language_from_string("");
+  bool perf_counters_enabled = false;
+  bool mem_report_enabled = false;
+  bool profile_grammar_enabled = false;
+  // Compile and generate one top level statement at a time, for schemas too
+  // large to hold in memory.
+  bool stream = false;
+  // Fail with exit code 3 when the peak live heap exceeds this many bytes,
+  // so that memory regressions can be gated in tests. Only available with
+  // -DTOOLMAN_MEM_REPORT=ON.
+  std::optional<std::uint64_t> mem_budget;
+  // Also write the compiled document as a schema image to this file.
+  std::optional<std::string> emit_image;
+  // External generators, see src/plugin.h.
+  std::vector<std::string> plugins;
+  // Directory for the plugin outputs, stdout if unset.
+  std::optional<std::filesystem::path> plugin_out;
+  std::vector<std::string> import_paths;
+  // Read every source from this tar archive, rooted at the working
+  // directory, instead of the disk.
+  std::optional<std::string> source_archive;
+  // Directory of the compile cache, see src/compile_cache.h.
+  std::optional<std::string> compile_cache_dir;
+  // Directory of the code generated per type, see src/fragment_cache.h.
+  std::optional<std::string> incremental_dir;
+  // Generated code goes to this file instead of stdout.
+  std::optional<std::string> output;
+  // Depfile (-MD, -MF) listing every source read, for the target named by
+  // -MT or -o.
+  bool depfile_enabled = false;
+  std::optional<std::string> depfile;
+  std::optional<std::string> depfile_target;
+  bool depfile_phony_targets = false;
+  // Serve the language server protocol on stdin and stdout instead of
+  // compiling. With --perf-counters, the latency of the analyses after edits
+  // is reported on exit, e.g. to replay a recorded session as a benchmark.
+  bool lsp = false;
 
-  if (argc > 1) {
-    if (argc == 3) {
-      target = toolman::generator::target_language_from_string(argv[1]);
-      filename = argv[2];
+  std::vector<std::string> positional_args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--perf-counters") {
+      perf_counters_enabled = true;
+    } else if (arg == "--stream") {
+      stream = true;
+    } else if (arg == "--lsp") {
+      lsp = true;
+    } else if (arg == "--profile-grammar") {
+      profile_grammar_enabled = true;
+    } else if (arg == "--mem-report") {
+      mem_report_enabled = true;
+    } else if (arg.rfind("--mem-budget=", 0) == 0) {
+      mem_report_enabled = true;
+      auto bytes = arg.substr(std::string("--mem-budget=").size());
+      try {
+        std::size_t end = 0;
+        mem_budget = std::stoull(bytes, &end);
+        if (end != bytes.size() || bytes.front() == '-') {
+          throw std::invalid_argument(bytes);
+        }
+      } catch (std::invalid_argument &) {
+        std::cerr << "--mem-budget needs a number of bytes, not `" << bytes
+                  << "`" << std::endl;
+        return 1;
+      } catch (std::out_of_range &) {
+        std::cerr << "--mem-budget of " << bytes << " bytes is out of range"
+                  << std::endl;
+        return 1;
+      }
+    } else if (arg.rfind("--emit-image=", 0) == 0) {
+      emit_image = arg.substr(std::string("--emit-image=").size());
+    } else if (arg.rfind("--plugin=", 0) == 0) {
+      plugins.push_back(arg.substr(std::string("--plugin=").size()));
+    } else if (arg.rfind("--plugin-out=", 0) == 0) {
+      plugin_out = arg.substr(std::string("--plugin-out=").size());
+    } else if (arg.rfind("--compile-cache=", 0) == 0) {
+      compile_cache_dir = arg.substr(std::string("--compile-cache=").size());
+    } else if (arg.rfind("--incremental=", 0) == 0) {
+      incremental_dir = arg.substr(std::string("--incremental=").size());
+    } else if (arg.rfind("--source-archive=", 0) == 0) {
+      source_archive = arg.substr(std::string("--source-archive=").size());
+    } else if (arg == "-I" && i + 1 < argc) {
+      import_paths.emplace_back(argv[++i]);
+    } else if (arg.rfind("-I", 0) == 0 && arg.size() > 2) {
+      import_paths.push_back(arg.substr(2));
+    } else if (arg == "-o" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "-MD") {
+      depfile_enabled = true;
+    } else if (arg == "-MF" && i + 1 < argc) {
+      depfile_enabled = true;
+      depfile = argv[++i];
+    } else if (arg == "-MT" && i + 1 < argc) {
+      depfile_target = argv[++i];
+    } else if (arg == "-MP") {
+      depfile_phony_targets = true;
     } else {
-      filename = argv[1];
+      positional_args.push_back(std::move(arg));
     }
   }
 
+  if (positional_args.size() == 2) {
+    target = toolman::generator::target_language_from_string(positional_args[0]);
+    filename = positional_args[1];
+  } else if (!positional_args.empty()) {
+    filename = positional_args[0];
+  }
+
+  if (mem_budget.has_value() && !toolman::mem::enabled()) {
+    std::cerr << "--mem-budget needs toolman built with -DTOOLMAN_MEM_REPORT=ON"
+              << std::endl;
+    return 1;
+  }
+
+  // Plugin outputs are named after the plugins, two plugins of the same name
+  // would overwrite each other's output.
+  if (plugin_out.has_value()) {
+    std::set<std::string> plugin_names;
+    for (const auto &plugin : plugins) {
+      auto name = toolman::plugin::plugin_name(plugin);
+      if (!plugin_names.insert(name).second) {
+        std::cerr << "--plugin-out needs distinct plugin names, `" << name
+                  << "` is given twice" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  if (depfile_enabled) {
+    if (!depfile_target.has_value()) {
+      depfile_target = output;
+    }
+    if (!depfile_target.has_value()) {
+      std::cerr << "a depfile needs a target, pass -MT or -o" << std::endl;
+      return 1;
+    }
+    if (!depfile.has_value()) {
+      depfile = depfile_target.value() + ".d";
+    }
+  }
+
+  std::ofstream output_ofs;
+  if (output.has_value()) {
+    output_ofs.open(output.value());
+    if (!output_ofs) {
+      std::cerr << "cannot open " << output.value() << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &out = output.has_value() ? output_ofs : std::cout;
+
   toolman::Compiler compiler;
-  auto compile_res = compiler.compile(filename);
+  std::shared_ptr<toolman::SourceProvider> source_provider =
+      std::make_shared<toolman::DiskSourceProvider>();
+  if (source_archive.has_value()) {
+    try {
+      source_provider = toolman::ArchiveSourceProvider::open(
+          source_archive.value(), std::filesystem::current_path());
+    } catch (toolman::ArchiveError &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  compiler.set_source_provider(source_provider);
+  for (const auto &import_path : import_paths) {
+    compiler.add_import_path(import_path);
+  }
+  std::unique_ptr<toolman::PerfCounters> perf_counters;
+  if (perf_counters_enabled) {
+    perf_counters = std::make_unique<toolman::PerfCounters>();
+    compiler.add_phase_listener(perf_counters.get());
+  }
+  std::unique_ptr<toolman::mem::MemReport> mem_report;
+  if (mem_report_enabled) {
+    mem_report = std::make_unique<toolman::mem::MemReport>();
+    compiler.add_phase_listener(mem_report.get());
+  }
+  std::unique_ptr<toolman::GrammarProfile> grammar_profile;
+  if (profile_grammar_enabled) {
+    grammar_profile = std::make_unique<toolman::GrammarProfile>();
+    compiler.set_grammar_profile(grammar_profile.get());
+  }
 
-  for (const auto &error : compile_res.get_errors()) {
-    std::cout << error.error() << std::endl << std::endl;
+  auto report = [&]() {
+    if (perf_counters) {
+      perf_counters->report(std::cerr);
+    }
+    if (mem_report) {
+      mem_report->report(std::cerr);
+    }
+    if (grammar_profile) {
+      grammar_profile->report(std::cerr);
+    }
+  };
+
+  // Reports, then checks the memory budget.
+  auto finish = [&](int exit_code) {
+    report();
+    if (mem_budget.has_value() &&
+        toolman::mem::MemReport::peak_live_bytes() > mem_budget.value()) {
+      std::cerr << "peak live heap "
+                << toolman::mem::MemReport::peak_live_bytes()
+                << " bytes exceeds the budget of " << mem_budget.value()
+                << " bytes" << std::endl;
+      return 3;
+    }
+    return exit_code;
+  };
+
+  // Writes the depfile, a build would otherwise run with missing or partial
+  // dependencies and never notice.
+  auto emit_depfile =
+      [&](const std::vector<std::filesystem::path> &dependencies) {
+        std::ofstream depfile_ofs(depfile.value());
+        toolman::write_depfile(depfile_ofs, depfile_target.value(),
+                               dependencies, depfile_phony_targets);
+        depfile_ofs.close();
+        if (!depfile_ofs) {
+          std::cerr << "cannot write depfile " << depfile.value()
+                    << std::endl;
+          return false;
+        }
+        return true;
+      };
+
+  if (lsp) {
+    toolman::lsp::Server server(&compiler, source_provider);
+    auto exit_code = server.run(std::cin, std::cout);
+    if (perf_counters) {
+      server.report(std::cerr);
+    }
+    return finish(exit_code);
   }
 
-  if (compile_res.has_fatal_error()) {
-    return 1;
+  // A schema image has been compiled before, generate directly from it.
+  if (std::filesystem::path(filename).extension() == ".tmi") {
+    try {
+      auto image = toolman::image::SchemaImage::map(filename);
+      toolman::generator::generate(image->to_document(), target, out,
+                                   &compiler.phase_listeners());
+    } catch (toolman::image::ImageError &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+    return finish(0);
+  }
+
+  if (stream) {
+    if (!plugins.empty() || emit_image.has_value() ||
+        compile_cache_dir.has_value() || incremental_dir.has_value()) {
+      std::cerr << "--stream cannot be combined with --plugin, --emit-image, "
+                   "--compile-cache or --incremental"
+                << std::endl;
+      return 1;
+    }
+    auto generator = toolman::generator::make_generator(target);
+    auto compile_res = compiler.compile_streaming(
+        filename,
+        [&](const toolman::Document &document) {
+          generator->begin_stream(out, &document);
+        },
+        [&](const toolman::Document &chunk) {
+          toolman::PhaseScope generate_phase(&compiler.phase_listeners(),
+                                             toolman::Phase::Generate);
+          generator->generate_chunk(out, &chunk);
+        });
+    for (const auto &error : compile_res.get_errors()) {
+      std::cout << error.error() << std::endl << std::endl;
+    }
+    if (compile_res.has_fatal_error()) {
+      report();
+      return 1;
+    }
+    generator->end_stream(out, compile_res.get_document().get());
+    if (depfile_enabled && !emit_depfile(compiler.dependencies())) {
+      return finish(1);
+    }
+    return finish(0);
   }
 
-  toolman::generator::generate(compile_res.get_document(), target, std::cout);
-  return 0;
+  std::unique_ptr<toolman::Document> document;
+  std::vector<std::filesystem::path> dependencies;
+  auto source = std::filesystem::absolute(filename).lexically_normal();
+  std::optional<toolman::CompileCache> compile_cache;
+  if (compile_cache_dir.has_value()) {
+    compile_cache.emplace(compile_cache_dir.value(), import_paths);
+    if (auto hit = compile_cache->lookup(source, compiler.source_provider());
+        hit.has_value()) {
+      document = hit->image->to_document();
+      dependencies = std::move(hit->dependencies);
+    }
+  }
+
+  if (!document) {
+    auto compile_res = compiler.compile(filename);
+
+    for (const auto &error : compile_res.get_errors()) {
+      std::cout << error.error() << std::endl << std::endl;
+    }
+
+    if (compile_res.has_fatal_error()) {
+      report();
+      return 1;
+    }
+
+    document = compile_res.get_document();
+    dependencies = compiler.dependencies();
+    // Only clean compiles are cached, a hit would not repeat the warnings.
+    if (compile_cache.has_value() && !compile_res.has_error()) {
+      compile_cache->store(source, *document, dependencies,
+                           compiler.dependency_hashes());
+    }
+  }
+
+  if (depfile_enabled && !emit_depfile(dependencies)) {
+    return finish(1);
+  }
+
+  if (emit_image.has_value()) {
+    std::ofstream image_ofs(emit_image.value(),
+                            std::ios_base::out | std::ios_base::binary);
+    toolman::image::write_image(*document, image_ofs);
+    image_ofs.close();
+    if (!image_ofs) {
+      std::cerr << "cannot write schema image " << emit_image.value()
+                << std::endl;
+      return finish(1);
+    }
+  }
+
+  int exit_code = 0;
+  if (!plugins.empty()) {
+    auto results = toolman::plugin::run_plugins(
+        plugins, toolman::image::serialize_image(*document));
+    for (const auto &result : results) {
+      if (plugin_out.has_value()) {
+        auto path = plugin_out.value() / result.name;
+        std::ofstream ofs(path);
+        ofs << result.output;
+        ofs.close();
+        if (!ofs) {
+          std::cerr << "cannot write " << path.string() << std::endl;
+          exit_code = 1;
+        }
+      } else {
+        out << result.output;
+      }
+      std::cerr << result.error_output << "plugin " << result.name << ": "
+                << std::chrono::duration<double, std::milli>(result.time)
+                       .count()
+                << " ms, exit status " << result.exit_status << std::endl;
+      if (!result.ok()) {
+        exit_code = 1;
+      }
+    }
+  }
+
+  // With plugins, the builtin generator only runs for an explicit target.
+  if ((plugins.empty() || positional_args.size() == 2) &&
+      incremental_dir.has_value()) {
+    toolman::generator::FragmentCache fragment_cache(incremental_dir.value(),
+                                                     target, *document);
+    {
+      toolman::PhaseScope generate_phase(&compiler.phase_listeners(),
+                                         toolman::Phase::Generate);
+      auto generator = toolman::generator::make_generator(target);
+      generator->set_fragment_cache(&fragment_cache);
+      generator->generate(out, document);
+    }
+    fragment_cache.save();
+    std::cerr << "incremental: " << fragment_cache.regenerated()
+              << " type(s) regenerated, " << fragment_cache.reused()
+              << " reused" << std::endl;
+  } else if (plugins.empty() || positional_args.size() == 2) {
+    toolman::generator::generate(std::move(document), target, out,
+                                 &compiler.phase_listeners());
+  }
+  return finish(exit_code);
 }
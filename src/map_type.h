@@ -9,28 +9,28 @@
 #include <string>
 #include <utility>
 
+#include "src/mem_report.h"
 #include "src/primitive_type.h"
 #include "src/type.h"
 
 namespace toolman {
 
-class MapType final : public Type {
+class MapType final : public Type, private mem::Tracked<MapType> {
  public:
   using KeyType = PrimitiveType;
   using ValueType = Type;
 
-  template <typename SI>
-  explicit MapType(SI&& stmt_info) : Type("map", std::forward<SI>(stmt_info)) {}
+  static constexpr Kind kKind = Kind::Map;
 
-  template <typename SI>
+  MapType() : Type(Kind::Map, "map") {}
+
+  // Prefer TypeTable::map, which shares one MapType per key and value type.
   MapType(std::shared_ptr<PrimitiveType> key_type,
-          std::shared_ptr<Type> value_type, SI&& stmt_info)
-      : Type(std::forward<SI>(stmt_info)),
+          std::shared_ptr<Type> value_type)
+      : Type(Kind::Map, "map"),
         key_type_(std::move(key_type)),
         value_type_(std::move(value_type)) {}
 
-  [[nodiscard]] bool is_map() const override { return true; }
-
   [[nodiscard]] const std::shared_ptr<PrimitiveType>& get_key_type() const {
     return key_type_;
   }
@@ -55,7 +55,7 @@ class MapType final : public Type {
     if (!rhs.is_map()) {
       return false;
     }
-    return operator==(dynamic_cast<const MapType&>(rhs));
+    return operator==(static_cast<const MapType&>(rhs));
   }
 
   bool operator==(const MapType& rhs) const {
@@ -0,0 +1,69 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "src/mem_report.h"
+
+// Replacements of the global allocation functions. Every block carries its
+// size in a header so that unsized deletes can be accounted too. Only linked
+// into the toolman executable, never into libtoolman, so that processes
+// embedding the library keep their own allocator.
+namespace {
+constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+
+void* counted_alloc(std::size_t size) noexcept {
+  auto* block = static_cast<char*>(std::malloc(size + kHeaderSize));
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *reinterpret_cast<std::size_t*>(block) = size;
+  toolman::mem::record_allocate(size);
+  return block + kHeaderSize;
+}
+
+void counted_free(void* ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto* block = static_cast<char*>(ptr) - kHeaderSize;
+  toolman::mem::record_release(*reinterpret_cast<std::size_t*>(block));
+  std::free(block);
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (auto* ptr = counted_alloc(size); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { counted_free(ptr); }
+
+void operator delete[](void* ptr, std::size_t) noexcept { counted_free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
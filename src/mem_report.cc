@@ -0,0 +1,148 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/mem_report.h"
+
+#include <cxxabi.h>
+
+#include <array>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+
+namespace toolman::mem {
+
+namespace {
+// Index `kPhaseCount` collects everything outside of a compile phase.
+constexpr std::size_t kOutsidePhase = kPhaseCount;
+
+struct PhaseStats {
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes{0};
+  std::atomic<std::uint64_t> peak_live_bytes{0};
+};
+
+Counter heap;
+std::array<PhaseStats, kPhaseCount + 1> phase_stats;
+std::atomic<std::size_t> current_phase{kOutsidePhase};
+
+void update_peak(std::atomic<std::uint64_t>* peak, std::uint64_t live) {
+  auto prev = peak->load(std::memory_order_relaxed);
+  while (live > prev &&
+         !peak->compare_exchange_weak(prev, live, std::memory_order_relaxed)) {
+  }
+}
+
+std::mutex& class_counters_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<std::type_index, Counter>& class_counters() {
+  static std::map<std::type_index, Counter> counters;
+  return counters;
+}
+
+std::string class_name(const std::type_index& type) {
+  int status = 0;
+  std::unique_ptr<char, decltype(&std::free)> demangled(
+      abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), std::free);
+  std::string name = status == 0 ? demangled.get() : type.name();
+  if (name.rfind("toolman::", 0) == 0) {
+    name = name.substr(9);
+  }
+  return name;
+}
+
+void print_header(std::ostream& ostream, const char* name) {
+  ostream << std::left << std::setw(16) << name << std::right << std::setw(12)
+          << "allocations" << std::setw(14) << "bytes" << std::setw(14)
+          << "peak-live" << "\n";
+}
+
+void print_row(std::ostream& ostream, const std::string& name,
+               std::uint64_t allocations, std::uint64_t bytes,
+               std::uint64_t peak_live_bytes) {
+  ostream << std::left << std::setw(16) << name << std::right << std::setw(12)
+          << allocations << std::setw(14) << bytes << std::setw(14)
+          << peak_live_bytes << "\n";
+}
+}  // namespace
+
+void record_allocate(std::size_t bytes) {
+  heap.allocate(bytes);
+  auto& stats = phase_stats[current_phase.load(std::memory_order_relaxed)];
+  stats.allocations.fetch_add(1, std::memory_order_relaxed);
+  stats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  update_peak(&stats.peak_live_bytes, heap.live_bytes());
+}
+
+void record_release(std::size_t bytes) { heap.release(bytes); }
+
+Counter& class_counter(const std::type_info& type) {
+  std::lock_guard<std::mutex> lock(class_counters_mutex());
+  return class_counters().try_emplace(std::type_index(type)).first->second;
+}
+
+void MemReport::enter_phase(Phase phase) {
+  stack_.push_back(phase);
+  auto index = static_cast<std::size_t>(phase);
+  current_phase.store(index, std::memory_order_relaxed);
+  update_peak(&phase_stats[index].peak_live_bytes, heap.live_bytes());
+}
+
+void MemReport::exit_phase(Phase phase) {
+  if (stack_.empty() || stack_.back() != phase) {
+    return;
+  }
+  stack_.pop_back();
+  current_phase.store(
+      stack_.empty() ? kOutsidePhase : static_cast<std::size_t>(stack_.back()),
+      std::memory_order_relaxed);
+}
+
+std::uint64_t MemReport::peak_live_bytes() { return heap.peak_live_bytes(); }
+
+std::uint64_t MemReport::allocations() { return heap.allocations(); }
+
+void MemReport::report(std::ostream& ostream) const {
+  if (!enabled()) {
+    ostream << "memory report unavailable: toolman was built without "
+               "-DTOOLMAN_MEM_REPORT=ON"
+            << std::endl;
+    return;
+  }
+
+  ostream << "memory report: " << heap.allocations() << " allocations, "
+          << heap.bytes() << " bytes, peak live " << heap.peak_live_bytes()
+          << " bytes\n";
+
+  print_header(ostream, "phase");
+  for (std::size_t i = 0; i <= kPhaseCount; ++i) {
+    const auto& stats = phase_stats[i];
+    auto allocations = stats.allocations.load(std::memory_order_relaxed);
+    if (allocations == 0) {
+      continue;
+    }
+    print_row(ostream,
+              i == kOutsidePhase ? "(outside)"
+                                 : phase_name(static_cast<Phase>(i)),
+              allocations, stats.bytes.load(std::memory_order_relaxed),
+              stats.peak_live_bytes.load(std::memory_order_relaxed));
+  }
+
+  print_header(ostream, "IR class");
+  std::lock_guard<std::mutex> lock(class_counters_mutex());
+  for (const auto& [type, counter] : class_counters()) {
+    print_row(ostream, class_name(type), counter.allocations(),
+              counter.bytes(), counter.peak_live_bytes());
+  }
+  ostream << std::flush;
+}
+
+}  // namespace toolman::mem
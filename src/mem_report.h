@@ -0,0 +1,122 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_MEM_REPORT_H_
+#define TOOLMAN_MEM_REPORT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <typeinfo>
+#include <vector>
+
+#include "src/phase.h"
+
+// Allocation accounting is only compiled in when toolman is configured with
+// -DTOOLMAN_MEM_REPORT=ON, it replaces the global operator new/delete and
+// counts every IR object.
+namespace toolman::mem {
+
+// Whether this binary was built with allocation accounting.
+constexpr bool enabled() {
+#ifdef TOOLMAN_MEM_REPORT
+  return true;
+#else
+  return false;
+#endif
+}
+
+class Counter final {
+ public:
+  void allocate(std::size_t bytes) {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    auto live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    auto peak = peak_live_bytes_.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes_.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+  }
+
+  void release(std::size_t bytes) {
+    live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::uint64_t allocations() const {
+    return allocations_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t bytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t live_bytes() const {
+    return live_bytes_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t peak_live_bytes() const {
+    return peak_live_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::uint64_t> allocations_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+  std::atomic<std::uint64_t> live_bytes_{0};
+  std::atomic<std::uint64_t> peak_live_bytes_{0};
+};
+
+// Accounts a heap block of `bytes` to the heap and the current phase, called
+// by the allocation functions in src/mem_new.cc.
+void record_allocate(std::size_t bytes);
+
+void record_release(std::size_t bytes);
+
+// Returns the counter of the IR class `type`, registering it on first use.
+Counter& class_counter(const std::type_info& type);
+
+// Base class of the IR classes that are counted in the report. Only the
+// shallow `sizeof(T)` is accounted, heap memory owned by the object shows up
+// in the per phase numbers instead.
+template <typename T>
+class Tracked {
+#ifdef TOOLMAN_MEM_REPORT
+ protected:
+  Tracked() { counter().allocate(sizeof(T)); }
+  Tracked(const Tracked&) { counter().allocate(sizeof(T)); }
+  Tracked(Tracked&&) noexcept { counter().allocate(sizeof(T)); }
+  Tracked& operator=(const Tracked&) = default;
+  Tracked& operator=(Tracked&&) noexcept = default;
+  ~Tracked() { counter().release(sizeof(T)); }
+
+ private:
+  static Counter& counter() {
+    static Counter& counter = class_counter(typeid(T));
+    return counter;
+  }
+#endif
+};
+
+// Attributes heap allocations to the phase that is running when they happen,
+// and prints allocations, bytes and peak live bytes per phase and per IR
+// class.
+class MemReport final : public PhaseListener {
+ public:
+  void enter_phase(Phase phase) override;
+
+  void exit_phase(Phase phase) override;
+
+  // Peak of live heap bytes of the whole process.
+  [[nodiscard]] static std::uint64_t peak_live_bytes();
+
+  // Heap allocations of the whole process so far.
+  [[nodiscard]] static std::uint64_t allocations();
+
+  void report(std::ostream& ostream) const;
+
+ private:
+  std::vector<Phase> stack_;
+};
+
+}  // namespace toolman::mem
+
+#endif  // TOOLMAN_MEM_REPORT_H_
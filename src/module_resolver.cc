@@ -0,0 +1,58 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/module_resolver.h"
+
+namespace toolman {
+
+std::optional<std::filesystem::path> ModuleResolver::resolve(
+    const std::string& import_path) {
+  if (auto it = resolved_.find(import_path); it != resolved_.end()) {
+    return it->second;
+  }
+
+  std::optional<std::filesystem::path> found;
+  auto path = std::filesystem::path(import_path).lexically_normal();
+  if (path.is_absolute()) {
+    if (exists(path)) {
+      found = path;
+    }
+  } else {
+    std::vector<const std::filesystem::path*> search_paths{&base_path_};
+    for (const auto& import_search_path : import_paths_) {
+      search_paths.push_back(&import_search_path);
+    }
+    for (const auto* search_path : search_paths) {
+      auto candidate = (*search_path / path).lexically_normal();
+      if (exists(candidate)) {
+        found = candidate;
+        break;
+      }
+    }
+  }
+  resolved_.emplace(import_path, found);
+  return found;
+}
+
+std::optional<ModuleId> ModuleResolver::module_id(
+    const std::filesystem::path& path) {
+  if (auto it = module_ids_.find(path); it != module_ids_.end()) {
+    return it->second;
+  }
+  auto id = source_provider_->identity(path);
+  module_ids_.emplace(path, id);
+  return id;
+}
+
+bool ModuleResolver::exists(const std::filesystem::path& path) {
+  auto directory = path.parent_path().string();
+  auto it = directory_index_.find(directory);
+  if (it == directory_index_.end()) {
+    it = directory_index_
+             .emplace(directory, source_provider_->list_dir(directory)).first;
+  }
+  return it->second.count(path.filename().string()) > 0;
+}
+
+}  // namespace toolman
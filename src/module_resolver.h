@@ -0,0 +1,78 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_MODULE_RESOLVER_H_
+#define TOOLMAN_MODULE_RESOLVER_H_
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/source_provider.h"
+
+namespace toolman {
+
+// Resolves import paths against the directory of the compiled file and the
+// import search paths (`-I`), in that order.
+//
+// Every directory is listed at most once per run, candidates are looked up
+// in that index instead of being `stat`ed one by one.
+class ModuleResolver final {
+ public:
+  explicit ModuleResolver(std::shared_ptr<SourceProvider> source_provider)
+      : source_provider_(std::move(source_provider)) {}
+
+  void set_source_provider(std::shared_ptr<SourceProvider> source_provider) {
+    source_provider_ = std::move(source_provider);
+    clear_cache();
+  }
+
+  void set_base_path(std::filesystem::path base_path) {
+    base_path_ = std::move(base_path);
+  }
+
+  [[nodiscard]] const std::filesystem::path& base_path() const {
+    return base_path_;
+  }
+
+  void add_import_path(const std::filesystem::path& import_path) {
+    import_paths_.push_back(std::filesystem::absolute(import_path));
+  }
+
+  // Forgets every lookup made so far, keeping the import search paths.
+  void clear_cache() {
+    directory_index_.clear();
+    resolved_.clear();
+    module_ids_.clear();
+  }
+
+  // Returns the path of the module imported as `import_path`,
+  // std::nullopt if it is found nowhere.
+  std::optional<std::filesystem::path> resolve(const std::string& import_path);
+
+  // Returns the identity of the resolved module file at `path`.
+  std::optional<ModuleId> module_id(const std::filesystem::path& path);
+
+ private:
+  // Whether `path` names an entry of its (indexed) parent directory.
+  bool exists(const std::filesystem::path& path);
+
+  std::shared_ptr<SourceProvider> source_provider_;
+  std::filesystem::path base_path_;
+  std::vector<std::filesystem::path> import_paths_;
+  // Entry names of every directory listed so far.
+  std::unordered_map<std::string, std::set<std::string>> directory_index_;
+  std::map<std::string, std::optional<std::filesystem::path>> resolved_;
+  std::map<std::filesystem::path, std::optional<ModuleId>> module_ids_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_MODULE_RESOLVER_H_
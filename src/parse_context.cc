@@ -0,0 +1,57 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/parse_context.h"
+
+namespace toolman {
+
+void ParseContext::reset(const std::string& content) {
+  input_.load(content);
+  lexer_.setInputStream(&input_);
+  tokens_.setTokenSource(&lexer_);
+  parser_.setTokenStream(&tokens_);
+  if (error_listener_ != nullptr) {
+    error_listener_ = nullptr;
+    lexer_.removeErrorListeners();
+    lexer_.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+    parser_.removeErrorListeners();
+    parser_.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+  }
+}
+
+void ParseContext::set_error_listener(antlr4::ANTLRErrorListener* listener) {
+  error_listener_ = listener;
+  lexer_.removeErrorListeners();
+  lexer_.addErrorListener(listener);
+  parser_.removeErrorListeners();
+  parser_.addErrorListener(listener);
+}
+
+ParseContextPool::Lease::~Lease() {
+  if (context_) {
+    // Parse trees and tokens are not kept alive until the next lease.
+    context_->reset(std::string());
+    free_contexts().push_back(std::move(context_));
+  }
+}
+
+ParseContextPool::Lease ParseContextPool::acquire(const std::string& content) {
+  auto& contexts = free_contexts();
+  std::unique_ptr<ParseContext> context;
+  if (contexts.empty()) {
+    context = std::make_unique<ParseContext>();
+  } else {
+    context = std::move(contexts.back());
+    contexts.pop_back();
+  }
+  context->reset(content);
+  return Lease(std::move(context));
+}
+
+std::vector<std::unique_ptr<ParseContext>>& ParseContextPool::free_contexts() {
+  thread_local std::vector<std::unique_ptr<ParseContext>> contexts;
+  return contexts;
+}
+
+}  // namespace toolman
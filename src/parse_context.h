@@ -0,0 +1,80 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_PARSE_CONTEXT_H_
+#define TOOLMAN_PARSE_CONTEXT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ToolmanLexer.h"
+#include "ToolmanParser.h"
+
+namespace toolman {
+
+// The input stream, lexer, token stream and parser of one parse. They are
+// retargeted at every new input instead of being built again, which also
+// keeps the parser's ATN simulator.
+class ParseContext final {
+ public:
+  ParseContext() : lexer_(&input_), tokens_(&lexer_), parser_(&tokens_) {}
+
+  ParseContext(const ParseContext&) = delete;
+  ParseContext& operator=(const ParseContext&) = delete;
+
+  // Retargets every stage at `content`. Parse trees of the previous input
+  // are released.
+  void reset(const std::string& content);
+
+  // Reports the lexer and parser errors of the current input to `listener`
+  // instead of the console, until the next reset.
+  void set_error_listener(antlr4::ANTLRErrorListener* listener);
+
+  ToolmanLexer& lexer() { return lexer_; }
+  antlr4::CommonTokenStream& tokens() { return tokens_; }
+  ToolmanParser& parser() { return parser_; }
+
+ private:
+  antlr4::ANTLRInputStream input_;
+  ToolmanLexer lexer_;
+  antlr4::CommonTokenStream tokens_;
+  ToolmanParser parser_;
+  antlr4::ANTLRErrorListener* error_listener_ = nullptr;
+};
+
+// Parse contexts of the calling thread, leased for one parse each. A lease
+// taken while another is held, e.g. for an import compiled during the walk
+// of the importing file, gets a context of its own.
+class ParseContextPool final {
+ public:
+  class Lease final {
+   public:
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    Lease(Lease&&) = default;
+    Lease& operator=(Lease&&) = default;
+    ~Lease();
+
+    ParseContext* get() const { return context_.get(); }
+    ParseContext* operator->() const { return context_.get(); }
+
+   private:
+    friend class ParseContextPool;
+    explicit Lease(std::unique_ptr<ParseContext> context)
+        : context_(std::move(context)) {}
+
+    std::unique_ptr<ParseContext> context_;
+  };
+
+  // A context of the calling thread, reset to `content`.
+  static Lease acquire(const std::string& content);
+
+ private:
+  static std::vector<std::unique_ptr<ParseContext>>& free_contexts();
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_PARSE_CONTEXT_H_
@@ -0,0 +1,203 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+namespace toolman {
+
+namespace {
+#ifdef __linux__
+constexpr std::array<std::uint64_t, PerfCounters::kCounterCount>
+    kCounterConfigs = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int perf_event_open(perf_event_attr* attr, int group_fd) {
+  // Measure this process on any cpu.
+  return static_cast<int>(syscall(SYS_perf_event_open, attr, 0, -1, group_fd,
+                                  PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+void print_ratio(std::ostream& ostream, int width, bool valid, double value) {
+  if (valid) {
+    ostream << std::setw(width) << std::fixed << std::setprecision(2) << value;
+  } else {
+    ostream << std::setw(width) << "n/a";
+  }
+}
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+  group_index_.fill(-1);
+#ifdef __linux__
+  for (std::size_t i = 0; i < kCounterCount; ++i) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = kCounterConfigs[i];
+    attr.read_format = PERF_FORMAT_GROUP;
+    // The group leader starts disabled and enables the whole group at once.
+    attr.disabled = group_fd_ < 0 ? 1 : 0;
+    // User space only, so that it works with perf_event_paranoid <= 2.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    auto fd = perf_event_open(&attr, group_fd_);
+    if (fd < 0) {
+      if (unavailable_reason_.empty()) {
+        unavailable_reason_ = std::strerror(errno);
+      }
+      continue;
+    }
+    if (group_fd_ < 0) {
+      group_fd_ = fd;
+    }
+    fds_[i] = fd;
+    group_index_[i] = static_cast<int>(group_size_++);
+  }
+
+  if (available()) {
+    unavailable_reason_.clear();
+    ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#else
+  unavailable_reason_ = "perf_event_open is only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (auto fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+PerfCounters::Sample PerfCounters::sample() const {
+  Sample sample;
+#ifdef __linux__
+  if (available()) {
+    // PERF_FORMAT_GROUP layout: { u64 nr; u64 values[nr]; }
+    std::array<std::uint64_t, kCounterCount + 1> buf{};
+    auto size = static_cast<ssize_t>(sizeof(std::uint64_t) * (group_size_ + 1));
+    if (read(group_fd_, buf.data(), size) == size) {
+      for (std::size_t i = 0; i < kCounterCount; ++i) {
+        if (group_index_[i] >= 0) {
+          sample.counters[i] = buf[group_index_[i] + 1];
+        }
+      }
+    }
+  }
+#endif
+  sample.time = Clock::now();
+  return sample;
+}
+
+void PerfCounters::accumulate(const ActivePhase& active, const Sample& now) {
+  auto& totals = totals_[static_cast<std::size_t>(active.phase)];
+  totals.time += now.time - active.start.time;
+  for (std::size_t i = 0; i < kCounterCount; ++i) {
+    totals.counters[i] += now.counters[i] - active.start.counters[i];
+  }
+}
+
+void PerfCounters::enter_phase(Phase phase) {
+  auto now = sample();
+  if (!stack_.empty()) {
+    accumulate(stack_.back(), now);
+  }
+  stack_.push_back({phase, now});
+  ++totals_[static_cast<std::size_t>(phase)].entries;
+}
+
+void PerfCounters::exit_phase(Phase phase) {
+  if (stack_.empty() || stack_.back().phase != phase) {
+    return;
+  }
+  auto now = sample();
+  accumulate(stack_.back(), now);
+  stack_.pop_back();
+  if (!stack_.empty()) {
+    stack_.back().start = now;
+  }
+}
+
+void PerfCounters::report(std::ostream& ostream) const {
+  auto source_kb = static_cast<double>(source_bytes_) / 1024;
+  ostream << "perf counters: " << source_files_ << " source file(s), "
+          << std::fixed << std::setprecision(1) << source_kb << " KB" << "\n";
+  if (!available()) {
+    ostream << "perf counters unavailable (" << unavailable_reason_
+            << "), reporting wall time only" << "\n";
+  }
+
+  ostream << std::left << std::setw(11) << "phase" << std::right
+          << std::setw(7) << "calls" << std::setw(11) << "time(ms)"
+          << std::setw(16) << "instructions" << std::setw(16) << "cycles"
+          << std::setw(7) << "IPC" << std::setw(16) << "cache-miss/KB"
+          << std::setw(16) << "branch-miss/KB" << "\n";
+
+  auto print_row = [&](const char* name, const Totals& totals) {
+    auto has = [&](Counter counter) {
+      return available() && fds_[counter] >= 0;
+    };
+    ostream << std::left << std::setw(11) << name << std::right
+            << std::setw(7) << totals.entries << std::setw(11) << std::fixed
+            << std::setprecision(3)
+            << std::chrono::duration<double, std::milli>(totals.time).count();
+    for (auto counter : {Instructions, Cycles}) {
+      if (has(counter)) {
+        ostream << std::setw(16) << totals.counters[counter];
+      } else {
+        ostream << std::setw(16) << "n/a";
+      }
+    }
+    print_ratio(ostream, 7,
+                has(Instructions) && has(Cycles) && totals.counters[Cycles] > 0,
+                static_cast<double>(totals.counters[Instructions]) /
+                    static_cast<double>(totals.counters[Cycles]));
+    for (auto counter : {CacheMisses, BranchMisses}) {
+      print_ratio(ostream, 16, has(counter) && source_kb > 0,
+                  static_cast<double>(totals.counters[counter]) / source_kb);
+    }
+    ostream << "\n";
+  };
+
+  Totals sum;
+  for (std::size_t i = 0; i < kPhaseCount; ++i) {
+    const auto& totals = totals_[i];
+    if (totals.entries == 0) {
+      continue;
+    }
+    print_row(phase_name(static_cast<Phase>(i)), totals);
+    sum.time += totals.time;
+    sum.entries += totals.entries;
+    for (std::size_t c = 0; c < kCounterCount; ++c) {
+      sum.counters[c] += totals.counters[c];
+    }
+  }
+  print_row("total", sum);
+  ostream << std::flush;
+}
+
+}  // namespace toolman
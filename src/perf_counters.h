@@ -0,0 +1,102 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_PERF_COUNTERS_H_
+#define TOOLMAN_PERF_COUNTERS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "src/phase.h"
+
+namespace toolman {
+
+// Samples hardware performance counters (via perf_event_open) around every
+// compile phase. Time spent in a nested phase, e.g. compiling an imported
+// module while walking the importing one, is attributed to the inner phase
+// only.
+//
+// When the counters cannot be opened (non-Linux host, restrictive
+// perf_event_paranoid, no PMU in a VM, ...) only wall time is reported.
+class PerfCounters final : public PhaseListener {
+ public:
+  enum Counter : char {
+    Instructions,
+    Cycles,
+    CacheMisses,
+    BranchMisses,
+  };
+
+  static constexpr std::size_t kCounterCount = 4;
+
+  PerfCounters();
+  ~PerfCounters() override;
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  [[nodiscard]] bool available() const { return group_fd_ >= 0; }
+
+  // Why the counters are not available, empty if they are.
+  [[nodiscard]] const std::string& unavailable_reason() const {
+    return unavailable_reason_;
+  }
+
+  void enter_phase(Phase phase) override;
+
+  void exit_phase(Phase phase) override;
+
+  void source_loaded(const std::filesystem::path& source,
+                     std::size_t bytes) override {
+    source_bytes_ += bytes;
+    ++source_files_;
+  }
+
+  void report(std::ostream& ostream) const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Sample {
+    Clock::time_point time;
+    std::array<std::uint64_t, kCounterCount> counters{};
+  };
+
+  struct Totals {
+    Clock::duration time{};
+    std::array<std::uint64_t, kCounterCount> counters{};
+    std::uint64_t entries = 0;
+  };
+
+  struct ActivePhase {
+    Phase phase;
+    Sample start;
+  };
+
+  [[nodiscard]] Sample sample() const;
+
+  void accumulate(const ActivePhase& active, const Sample& now);
+
+  int group_fd_ = -1;
+  // File descriptor of every counter, -1 if that counter could not be opened.
+  std::array<int, kCounterCount> fds_;
+  // Position of every counter in a PERF_FORMAT_GROUP read.
+  std::array<int, kCounterCount> group_index_;
+  std::size_t group_size_ = 0;
+  std::string unavailable_reason_;
+
+  std::vector<ActivePhase> stack_;
+  std::array<Totals, kPhaseCount> totals_;
+  std::uint64_t source_bytes_ = 0;
+  std::uint64_t source_files_ = 0;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_PERF_COUNTERS_H_
@@ -0,0 +1,107 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_PHASE_H_
+#define TOOLMAN_PHASE_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+namespace toolman {
+
+// Phases of a toolman run that can be observed by a `PhaseListener`.
+enum class Phase : char { Lex, Parse, DeclScan, DeclWalk, RefWalk, Generate };
+
+constexpr std::size_t kPhaseCount = 6;
+
+inline const char* phase_name(Phase phase) {
+  switch (phase) {
+    case Phase::Lex:
+      return "lex";
+    case Phase::Parse:
+      return "parse";
+    case Phase::DeclScan:
+      return "decl-scan";
+    case Phase::DeclWalk:
+      return "decl-walk";
+    case Phase::RefWalk:
+      return "ref-walk";
+    case Phase::Generate:
+      return "generate";
+  }
+  return "";
+}
+
+class PhaseListener {
+ public:
+  virtual ~PhaseListener() = default;
+
+  virtual void enter_phase(Phase phase) = 0;
+  virtual void exit_phase(Phase phase) = 0;
+
+  // Called once for every source file read by the compiler.
+  virtual void source_loaded(const std::filesystem::path& source,
+                             std::size_t bytes) {}
+};
+
+class PhaseListeners final {
+ public:
+  void add(PhaseListener* listener) { listeners_.push_back(listener); }
+
+  [[nodiscard]] bool empty() const { return listeners_.empty(); }
+
+  void enter_phase(Phase phase) {
+    for (auto* listener : listeners_) {
+      listener->enter_phase(phase);
+    }
+  }
+
+  void exit_phase(Phase phase) {
+    // Leave in reverse order so that nested measurements stay balanced.
+    for (auto it = listeners_.rbegin(); it != listeners_.rend(); ++it) {
+      (*it)->exit_phase(phase);
+    }
+  }
+
+  void source_loaded(const std::filesystem::path& source, std::size_t bytes) {
+    for (auto* listener : listeners_) {
+      listener->source_loaded(source, bytes);
+    }
+  }
+
+ private:
+  std::vector<PhaseListener*> listeners_;
+};
+
+// Notifies the listeners about entering `phase` for the lifetime of the
+// scope. `listeners` may be null.
+class PhaseScope final {
+ public:
+  PhaseScope(PhaseListeners* listeners, Phase phase)
+      : listeners_(listeners != nullptr && !listeners->empty() ? listeners
+                                                                : nullptr),
+        phase_(phase) {
+    if (listeners_ != nullptr) {
+      listeners_->enter_phase(phase_);
+    }
+  }
+
+  ~PhaseScope() {
+    if (listeners_ != nullptr) {
+      listeners_->exit_phase(phase_);
+    }
+  }
+
+  PhaseScope(const PhaseScope&) = delete;
+  PhaseScope& operator=(const PhaseScope&) = delete;
+
+ private:
+  PhaseListeners* listeners_;
+  Phase phase_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_PHASE_H_
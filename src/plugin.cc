@@ -0,0 +1,169 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/plugin.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include "src/schema_image.h"
+
+extern char** environ;
+
+namespace toolman::plugin {
+
+namespace {
+// Creating the pipes and spawning must not interleave between threads,
+// otherwise a plugin could inherit the pipe ends of another one and never
+// see the end of its input.
+std::mutex spawn_mutex;
+
+bool make_pipe(std::array<int, 2>* fds) {
+  if (pipe(fds->data()) != 0) {
+    return false;
+  }
+  for (auto fd : *fds) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+  return true;
+}
+
+void close_fd(int* fd) {
+  if (*fd >= 0) {
+    close(*fd);
+    *fd = -1;
+  }
+}
+
+void run_plugin(std::string_view image, PluginResult* result) {
+  auto start = std::chrono::steady_clock::now();
+  std::array<int, 2> in{-1, -1}, out{-1, -1}, err{-1, -1};
+  pid_t pid = -1;
+  {
+    std::lock_guard<std::mutex> lock(spawn_mutex);
+    if (!make_pipe(&in) || !make_pipe(&out) || !make_pipe(&err)) {
+      result->error_output = std::strerror(errno);
+      for (auto* fds : {&in, &out, &err}) {
+        close_fd(&(*fds)[0]);
+        close_fd(&(*fds)[1]);
+      }
+      return;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+
+    auto version_arg = "--toolman-plugin-version=" +
+                       std::to_string(image::kVersion);
+    std::array<char*, 3> argv{const_cast<char*>(result->path.c_str()),
+                              version_arg.data(), nullptr};
+    auto rc = posix_spawnp(&pid, result->path.c_str(), &actions, nullptr,
+                           argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close_fd(&in[0]);
+    close_fd(&out[1]);
+    close_fd(&err[1]);
+    if (rc != 0) {
+      result->error_output =
+          "cannot run plugin `" + result->path + "`: " + std::strerror(rc);
+      close_fd(&in[1]);
+      close_fd(&out[0]);
+      close_fd(&err[0]);
+      return;
+    }
+  }
+
+  // Feed the image and drain both outputs at the same time, so that neither
+  // side blocks on a full pipe.
+  fcntl(in[1], F_SETFL, fcntl(in[1], F_GETFL) | O_NONBLOCK);
+  std::size_t written = 0;
+  if (image.empty()) {
+    close_fd(&in[1]);
+  }
+  std::array<char, 64 * 1024> buf{};
+  while (in[1] >= 0 || out[0] >= 0 || err[0] >= 0) {
+    std::array<pollfd, 3> fds{
+        pollfd{in[1], POLLOUT, 0},
+        pollfd{out[0], POLLIN, 0},
+        pollfd{err[0], POLLIN, 0},
+    };
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (in[1] >= 0 && fds[0].revents != 0) {
+      auto n = write(in[1], image.data() + written, image.size() - written);
+      if (n > 0) {
+        written += static_cast<std::size_t>(n);
+      }
+      if ((n < 0 && errno != EAGAIN && errno != EINTR) ||
+          written == image.size()) {
+        // Done, or the plugin closed its stdin early.
+        close_fd(&in[1]);
+      }
+    }
+    for (auto [index, fd, sink] :
+         {std::make_tuple(1, &out[0], &result->output),
+          std::make_tuple(2, &err[0], &result->error_output)}) {
+      if (*fd < 0 || fds[index].revents == 0) {
+        continue;
+      }
+      auto n = read(*fd, buf.data(), buf.size());
+      if (n > 0) {
+        sink->append(buf.data(), static_cast<std::size_t>(n));
+      } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        close_fd(fd);
+      }
+    }
+  }
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  result->exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  result->time = std::chrono::steady_clock::now() - start;
+}
+}  // namespace
+
+std::string plugin_name(const std::string& path) {
+  return std::filesystem::path(path).filename().string();
+}
+
+std::vector<PluginResult> run_plugins(const std::vector<std::string>& paths,
+                                      std::string_view image) {
+  // A plugin that exits without reading its input must not kill toolman.
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<PluginResult> results(paths.size());
+  std::vector<std::thread> threads;
+  threads.reserve(paths.size());
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    results[i].name = plugin_name(paths[i]);
+    results[i].path = paths[i];
+    threads.emplace_back(run_plugin, image, &results[i]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+}  // namespace toolman::plugin
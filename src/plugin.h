@@ -0,0 +1,48 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_PLUGIN_H_
+#define TOOLMAN_PLUGIN_H_
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Out-of-process generators.
+//
+// A plugin is an executable that reads a schema image (see schema_image.h)
+// of the compiled document from its stdin and writes the generated code to
+// its stdout. Diagnostics go to stderr, a non-zero exit status marks the
+// generation as failed. The plugin is started as
+//
+//   <plugin> --toolman-plugin-version=<image version>
+//
+// The document is serialized once and all plugins run concurrently.
+namespace toolman::plugin {
+
+struct PluginResult {
+  std::string name;
+  std::string path;
+  // Exit status of the plugin, -1 if it could not be run or was killed.
+  int exit_status = -1;
+  std::string output;
+  std::string error_output;
+  std::chrono::steady_clock::duration time{};
+
+  [[nodiscard]] bool ok() const { return exit_status == 0; }
+};
+
+// Name of the plugin at `path`, e.g. `toolman-gen-rust` for
+// `/usr/bin/toolman-gen-rust`.
+std::string plugin_name(const std::string& path);
+
+// Runs every plugin in `paths` concurrently with `image` on its stdin.
+// The results are in the order of `paths`.
+std::vector<PluginResult> run_plugins(const std::vector<std::string>& paths,
+                                      std::string_view image);
+
+}  // namespace toolman::plugin
+
+#endif  // TOOLMAN_PLUGIN_H_
@@ -8,11 +8,15 @@
 #include <string>
 #include <utility>
 
+#include "src/mem_report.h"
 #include "src/type.h"
 
 namespace toolman {
-class PrimitiveType final : public Type {
+class PrimitiveType final : public Type,
+                            private mem::Tracked<PrimitiveType> {
  public:
+  static constexpr Kind kKind = Kind::Primitive;
+
   // Enumeration of toolman primitive types
   enum class TypeKind : char {
     Bool,
@@ -25,12 +29,12 @@ class PrimitiveType final : public Type {
     Any,
   };
 
-  template <typename SI>
-  PrimitiveType(TypeKind type_kind, SI&& stmt_info)
-      : Type(type_kind_to_string(type_kind), std::forward<SI>(stmt_info)),
+  // Prefer TypeTable::primitive, which shares one PrimitiveType per kind.
+  explicit PrimitiveType(TypeKind type_kind)
+      : Type(Kind::Primitive, type_kind_to_string(type_kind)),
         type_kind_(type_kind) {}
 
-  [[nodiscard]] bool is_primitive() const override { return true; }
+  [[nodiscard]] TypeKind get_type_kind() const { return type_kind_; }
 
   [[nodiscard]] bool is_bool() const { return type_kind_ == TypeKind::Bool; }
 
@@ -67,7 +71,7 @@ class PrimitiveType final : public Type {
     if (!rhs.is_primitive()) {
       return false;
     }
-    return operator==(dynamic_cast<const PrimitiveType&>(rhs));
+    return operator==(static_cast<const PrimitiveType&>(rhs));
   }
 
   bool operator==(const PrimitiveType& rhs) const {
@@ -0,0 +1,576 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/schema_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/list_type.h"
+#include "src/map_type.h"
+#include "src/primitive_type.h"
+#include "src/type_table.h"
+
+namespace toolman::image {
+
+namespace {
+constexpr std::size_t kSectionAlignment = 8;
+
+class ImageWriter {
+ public:
+  std::string write(const Document& document) {
+    for (const auto& struct_type : document.get_struct_types()) {
+      structs_.push_back(type_index(struct_type));
+    }
+    for (const auto& enum_type : document.get_enum_types()) {
+      enums_.push_back(type_index(enum_type));
+    }
+    for (const auto& option : document.get_options()) {
+      append_option(*option);
+    }
+
+    ImageHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrderMark;
+    if (document.get_source()) {
+      header.source = intern(document.get_source()->string());
+    }
+
+    std::string out(sizeof(ImageHeader), '\0');
+    header.types = append_section(&out, types_);
+    header.fields = append_section(&out, fields_);
+    header.enum_fields = append_section(&out, enum_fields_);
+    header.comments = append_section(&out, comments_);
+    header.options = append_section(&out, options_);
+    header.structs = append_section(&out, structs_);
+    header.enums = append_section(&out, enums_);
+    header.strings = {static_cast<std::uint32_t>(out.size()),
+                      static_cast<std::uint32_t>(string_table_.size())};
+    out += string_table_;
+    header.size = static_cast<std::uint32_t>(out.size());
+    std::memcpy(out.data(), &header, sizeof(header));
+    return out;
+  }
+
+ private:
+  template <typename T>
+  static Section append_section(std::string* out, const std::vector<T>& items) {
+    out->resize((out->size() + kSectionAlignment - 1) / kSectionAlignment *
+                kSectionAlignment);
+    Section section{static_cast<std::uint32_t>(out->size()),
+                    static_cast<std::uint32_t>(items.size())};
+    out->append(reinterpret_cast<const char*>(items.data()),
+                items.size() * sizeof(T));
+    return section;
+  }
+
+  StringRef intern(const std::string& str) {
+    if (auto it = strings_.find(str); it != strings_.end()) {
+      return it->second;
+    }
+    StringRef ref{static_cast<std::uint32_t>(string_table_.size()),
+                  static_cast<std::uint32_t>(str.size())};
+    string_table_ += str;
+    strings_.emplace(str, ref);
+    return ref;
+  }
+
+  std::pair<std::uint32_t, std::uint32_t> append_comments(
+      const std::vector<std::string>& comments) {
+    auto first = static_cast<std::uint32_t>(comments_.size());
+    for (const auto& comment : comments) {
+      comments_.push_back(intern(comment));
+    }
+    return {first, static_cast<std::uint32_t>(comments.size())};
+  }
+
+  template <typename T>
+  static void set_location(const T& item, std::uint32_t* line,
+                           std::uint32_t* column) {
+    *line = item.get_stmt_info().get_line_no().first;
+    *column = item.get_stmt_info().get_column_no().first;
+  }
+
+  // Returns the index of `type`, appending it and every type it references on
+  // first use.
+  std::uint32_t type_index(const std::shared_ptr<Type>& type) {
+    if (auto it = type_indices_.find(type.get()); it != type_indices_.end()) {
+      return it->second;
+    }
+    auto index = static_cast<std::uint32_t>(types_.size());
+    type_indices_.emplace(type.get(), index);
+    types_.emplace_back();
+
+    TypeRecord record{};
+    record.name = intern(type->get_name());
+    if (type->is_primitive()) {
+      record.kind = TypeKind::Primitive;
+      record.primitive_kind = static_cast<std::uint8_t>(
+          std::static_pointer_cast<PrimitiveType>(type)->get_type_kind());
+    } else if (type->is_list()) {
+      record.kind = TypeKind::List;
+      record.first = type_index(
+          std::static_pointer_cast<ListType>(type)->get_elem_type());
+    } else if (type->is_map()) {
+      auto map = std::static_pointer_cast<MapType>(type);
+      record.kind = TypeKind::Map;
+      record.first = type_index(map->get_key_type());
+      record.second = type_index(map->get_value_type());
+    } else if (type->is_enum()) {
+      auto enum_type = std::static_pointer_cast<EnumType>(type);
+      record.kind = TypeKind::Enum;
+      record.module = module_of(*enum_type);
+      set_location(*enum_type, &record.line, &record.column);
+      record.first = static_cast<std::uint32_t>(enum_fields_.size());
+      record.second = static_cast<std::uint32_t>(enum_type->get_fields().size());
+      for (const auto& field : enum_type->get_fields()) {
+        EnumFieldRecord field_record{};
+        field_record.name = intern(field.get_name());
+        field_record.value = field.get_value();
+        std::tie(field_record.first_comment, field_record.comment_count) =
+            append_comments(field.get_comments());
+        set_location(field, &field_record.line, &field_record.column);
+        enum_fields_.push_back(field_record);
+      }
+    } else {
+      // Struct and oneof types share the field layout.
+      auto custom_type = std::static_pointer_cast<CustomType<Field>>(type);
+      record.kind = type->is_oneof() ? TypeKind::Oneof : TypeKind::Struct;
+      if (type->is_struct()) {
+        record.module = module_of(*custom_type);
+      }
+      set_location(*custom_type, &record.line, &record.column);
+      // Field types first, so that the fields of this type stay contiguous.
+      std::vector<std::uint32_t> field_types;
+      for (const auto& field : custom_type->get_fields()) {
+        field_types.push_back(type_index(field.get_type()));
+      }
+      record.first = static_cast<std::uint32_t>(fields_.size());
+      record.second = static_cast<std::uint32_t>(field_types.size());
+      auto field_type = field_types.cbegin();
+      for (const auto& field : custom_type->get_fields()) {
+        FieldRecord field_record{};
+        field_record.name = intern(field.get_name());
+        field_record.type = *field_type++;
+        field_record.optional = field.is_optional() ? 1 : 0;
+        std::tie(field_record.first_comment, field_record.comment_count) =
+            append_comments(field.get_comments());
+        set_location(field, &field_record.line, &field_record.column);
+        fields_.push_back(field_record);
+      }
+    }
+    types_[index] = record;
+    return index;
+  }
+
+  StringRef module_of(const HasStmtInfo& type) {
+    auto source = type.get_stmt_info().get_source();
+    return source ? intern(source->string()) : StringRef{};
+  }
+
+  void append_option(const Option& option) {
+    OptionRecord record{};
+    record.name = intern(option.get_name());
+    if (option.is_bool()) {
+      record.kind = OptionKind::Bool;
+      record.bool_value =
+          dynamic_cast<const BoolOption&>(option).get_value() ? 1 : 0;
+    } else if (option.is_numeric()) {
+      record.kind = OptionKind::Numeric;
+      record.numeric_value =
+          dynamic_cast<const NumericOption&>(option).get_value();
+    } else {
+      record.kind = OptionKind::String;
+      record.string_value =
+          intern(dynamic_cast<const StringOption&>(option).get_value());
+    }
+    options_.push_back(record);
+  }
+
+  std::vector<TypeRecord> types_;
+  std::vector<FieldRecord> fields_;
+  std::vector<EnumFieldRecord> enum_fields_;
+  std::vector<StringRef> comments_;
+  std::vector<OptionRecord> options_;
+  std::vector<std::uint32_t> structs_;
+  std::vector<std::uint32_t> enums_;
+  std::unordered_map<const Type*, std::uint32_t> type_indices_;
+  std::unordered_map<std::string, StringRef> strings_;
+  std::string string_table_;
+};
+}  // namespace
+
+void write_image(const Document& document, std::ostream& ostream) {
+  auto image = serialize_image(document);
+  ostream.write(image.data(), static_cast<std::streamsize>(image.size()));
+}
+
+std::string serialize_image(const Document& document) {
+  return ImageWriter().write(document);
+}
+
+std::unique_ptr<SchemaImage> SchemaImage::map(
+    const std::filesystem::path& path) {
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw ImageError("cannot open schema image `" + path.string() +
+                     "`: " + std::strerror(errno));
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size < 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(ImageHeader)) {
+    close(fd);
+    throw ImageError("`" + path.string() + "` is not a schema image");
+  }
+  auto size = static_cast<std::size_t>(st.st_size);
+  auto* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw ImageError("cannot map schema image `" + path.string() +
+                     "`: " + std::strerror(errno));
+  }
+  std::unique_ptr<SchemaImage> image(
+      new SchemaImage(static_cast<const char*>(data), size, true));
+  image->validate();
+  return image;
+}
+
+std::unique_ptr<SchemaImage> SchemaImage::view(std::string_view buffer) {
+  if (buffer.size() < sizeof(ImageHeader) ||
+      reinterpret_cast<std::uintptr_t>(buffer.data()) % kSectionAlignment !=
+          0) {
+    throw ImageError("buffer is not a schema image");
+  }
+  std::unique_ptr<SchemaImage> image(
+      new SchemaImage(buffer.data(), buffer.size(), false));
+  image->validate();
+  return image;
+}
+
+SchemaImage::~SchemaImage() {
+  if (mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+void SchemaImage::validate() const {
+  const auto& h = header();
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw ImageError("bad schema image magic");
+  }
+  if (h.version != kVersion) {
+    throw ImageError("unsupported schema image version " +
+                     std::to_string(h.version));
+  }
+  if (h.byte_order != kByteOrderMark) {
+    throw ImageError("schema image byte order does not match this host");
+  }
+  if (h.size > size_) {
+    throw ImageError("truncated schema image");
+  }
+
+  auto check_section = [&](const Section& section, std::size_t item_size) {
+    if (section.offset % kSectionAlignment != 0 ||
+        static_cast<std::uint64_t>(section.offset) +
+                static_cast<std::uint64_t>(section.count) * item_size >
+            h.size) {
+      throw ImageError("corrupt schema image section");
+    }
+  };
+  check_section(h.types, sizeof(TypeRecord));
+  check_section(h.fields, sizeof(FieldRecord));
+  check_section(h.enum_fields, sizeof(EnumFieldRecord));
+  check_section(h.comments, sizeof(StringRef));
+  check_section(h.options, sizeof(OptionRecord));
+  check_section(h.structs, sizeof(std::uint32_t));
+  check_section(h.enums, sizeof(std::uint32_t));
+  if (static_cast<std::uint64_t>(h.strings.offset) + h.strings.count >
+      h.size) {
+    throw ImageError("corrupt schema image string table");
+  }
+
+  auto check_string = [&](StringRef ref) {
+    if (static_cast<std::uint64_t>(ref.offset) + ref.length >
+        h.strings.count) {
+      throw ImageError("corrupt schema image string reference");
+    }
+  };
+  auto check_range = [&](std::uint64_t first, std::uint64_t count,
+                         std::uint64_t limit) {
+    if (first + count > limit) {
+      throw ImageError("corrupt schema image reference");
+    }
+  };
+
+  check_string(h.source);
+  for (std::uint32_t i = 0; i < h.types.count; ++i) {
+    const auto& record = type(i);
+    check_string(record.name);
+    check_string(record.module);
+    switch (record.kind) {
+      case TypeKind::Primitive:
+        if (record.primitive_kind >
+            static_cast<std::uint8_t>(PrimitiveType::TypeKind::Any)) {
+          throw ImageError("corrupt schema image primitive kind");
+        }
+        break;
+      case TypeKind::List:
+        check_range(record.first, 1, h.types.count);
+        break;
+      case TypeKind::Map:
+        check_range(record.first, 1, h.types.count);
+        check_range(record.second, 1, h.types.count);
+        if (type(record.first).kind != TypeKind::Primitive) {
+          throw ImageError("corrupt schema image map key");
+        }
+        break;
+      case TypeKind::Struct:
+      case TypeKind::Oneof:
+        check_range(record.first, record.second, h.fields.count);
+        break;
+      case TypeKind::Enum:
+        check_range(record.first, record.second, h.enum_fields.count);
+        break;
+      default:
+        throw ImageError("corrupt schema image type kind");
+    }
+  }
+  // Lists and maps must end in another kind of type. Map keys are
+  // primitives, so each of them nests at most one list or map and the walk
+  // from a type is a chain.
+  enum class Visit : std::uint8_t { None, Visiting, Done };
+  std::vector<Visit> visits(h.types.count, Visit::None);
+  std::vector<std::uint32_t> chain;
+  for (std::uint32_t i = 0; i < h.types.count; ++i) {
+    chain.clear();
+    auto j = i;
+    while (visits[j] == Visit::None) {
+      const auto& record = type(j);
+      if (record.kind != TypeKind::List && record.kind != TypeKind::Map) {
+        break;
+      }
+      visits[j] = Visit::Visiting;
+      chain.push_back(j);
+      j = record.kind == TypeKind::List ? record.first : record.second;
+    }
+    if (visits[j] == Visit::Visiting) {
+      throw ImageError("corrupt schema image type cycle");
+    }
+    for (auto k : chain) {
+      visits[k] = Visit::Done;
+    }
+  }
+
+  for (std::uint32_t i = 0; i < h.fields.count; ++i) {
+    const auto& record = field(i);
+    check_string(record.name);
+    check_range(record.type, 1, h.types.count);
+    check_range(record.first_comment, record.comment_count, h.comments.count);
+  }
+  for (std::uint32_t i = 0; i < h.enum_fields.count; ++i) {
+    const auto& record = enum_field(i);
+    check_string(record.name);
+    check_range(record.first_comment, record.comment_count, h.comments.count);
+  }
+  for (std::uint32_t i = 0; i < h.comments.count; ++i) {
+    check_string(section<StringRef>(h.comments)[i]);
+  }
+  for (std::uint32_t i = 0; i < h.options.count; ++i) {
+    check_string(option(i).name);
+    check_string(option(i).string_value);
+    if (static_cast<std::uint8_t>(option(i).kind) >
+        static_cast<std::uint8_t>(OptionKind::String)) {
+      throw ImageError("corrupt schema image option kind");
+    }
+  }
+  for (std::uint32_t i = 0; i < h.structs.count; ++i) {
+    check_range(struct_type(i), 1, h.types.count);
+    if (type(struct_type(i)).kind != TypeKind::Struct) {
+      throw ImageError("corrupt schema image struct list");
+    }
+  }
+  for (std::uint32_t i = 0; i < h.enums.count; ++i) {
+    check_range(enum_type(i), 1, h.types.count);
+    if (type(enum_type(i)).kind != TypeKind::Enum) {
+      throw ImageError("corrupt schema image enum list");
+    }
+  }
+}
+
+std::unique_ptr<Document> SchemaImage::to_document() const {
+  std::map<std::string_view, std::shared_ptr<std::filesystem::path>> sources;
+  auto source_of = [&](StringRef ref) {
+    auto& source = sources[string(ref)];
+    if (!source) {
+      source = std::make_shared<std::filesystem::path>(string(ref));
+    }
+    return source;
+  };
+  auto stmt_info = [](std::uint32_t line, std::uint32_t column,
+                      std::shared_ptr<std::filesystem::path> source) {
+    return StmtInfo({line, line}, {column, column}, std::move(source));
+  };
+  auto comments = [&](std::uint32_t first, std::uint32_t count) {
+    std::vector<std::string> comments;
+    for (auto i = first; i < first + count; ++i) {
+      comments.emplace_back(comment(i));
+    }
+    return comments;
+  };
+
+  auto document = std::make_unique<Document>();
+  auto document_source = source_of(header().source);
+  document->set_source(document_source);
+
+  // Create every declared type first, so that fields can refer to any of
+  // them. Primitives, lists and maps are interned bottom-up afterwards.
+  std::vector<std::shared_ptr<Type>> types;
+  types.reserve(type_count());
+  for (std::uint32_t i = 0; i < type_count(); ++i) {
+    const auto& record = type(i);
+    auto source = record.module.length > 0 ? source_of(record.module)
+                                           : document_source;
+    auto info = stmt_info(record.line, record.column, source);
+    switch (record.kind) {
+      case TypeKind::Primitive:
+      case TypeKind::List:
+      case TypeKind::Map:
+        types.emplace_back();
+        break;
+      case TypeKind::Struct:
+        types.push_back(std::make_shared<StructType>(
+            std::string(string(record.name)), std::move(info)));
+        break;
+      case TypeKind::Enum:
+        types.push_back(std::make_shared<EnumType>(
+            std::string(string(record.name)), std::move(info)));
+        break;
+      case TypeKind::Oneof:
+        types.push_back(std::make_shared<OneofType>(std::move(info)));
+        break;
+    }
+  }
+
+  // validate() rejected cyclic lists and maps, so every chain ends. It is
+  // walked down, then the types are interned on the way back up.
+  TypeTable type_table;
+  auto resolve_primitive = [&](std::uint32_t i) {
+    if (!types[i]) {
+      types[i] = type_table.primitive(
+          static_cast<PrimitiveType::TypeKind>(type(i).primitive_kind));
+    }
+  };
+  std::vector<std::uint32_t> chain;
+  for (std::uint32_t i = 0; i < type_count(); ++i) {
+    chain.clear();
+    for (auto j = i; !types[j];) {
+      const auto& record = type(j);
+      if (record.kind == TypeKind::Primitive) {
+        resolve_primitive(j);
+      } else {
+        chain.push_back(j);
+        j = record.kind == TypeKind::List ? record.first : record.second;
+      }
+    }
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      const auto& record = type(*it);
+      if (record.kind == TypeKind::List) {
+        types[*it] = type_table.list(types[record.first]);
+      } else {
+        resolve_primitive(record.first);
+        types[*it] = type_table.map(
+            std::static_pointer_cast<PrimitiveType>(types[record.first]),
+            types[record.second]);
+      }
+    }
+  }
+
+  for (std::uint32_t i = 0; i < type_count(); ++i) {
+    const auto& record = type(i);
+    auto source = record.module.length > 0 ? source_of(record.module)
+                                           : document_source;
+    switch (record.kind) {
+      case TypeKind::Primitive:
+      case TypeKind::List:
+      case TypeKind::Map:
+        break;
+      case TypeKind::Enum: {
+        auto enum_type = std::static_pointer_cast<EnumType>(types[i]);
+        for (auto f = record.first; f < record.first + record.second; ++f) {
+          const auto& field_record = enum_field(f);
+          auto field = EnumField(
+              std::string(string(field_record.name)),
+              stmt_info(field_record.line, field_record.column, source),
+              comments(field_record.first_comment,
+                       field_record.comment_count));
+          field.set_value(field_record.value);
+          enum_type->append_field(field);
+        }
+        break;
+      }
+      case TypeKind::Struct:
+      case TypeKind::Oneof: {
+        auto custom_type =
+            std::static_pointer_cast<CustomType<Field>>(types[i]);
+        for (auto f = record.first; f < record.first + record.second; ++f) {
+          const auto& field_record = field(f);
+          auto field = Field(
+              std::string(string(field_record.name)),
+              stmt_info(field_record.line, field_record.column, source),
+              comments(field_record.first_comment,
+                       field_record.comment_count));
+          field.set_type(types[field_record.type]);
+          field.set_optional(field_record.optional != 0);
+          custom_type->append_field(field);
+        }
+        break;
+      }
+    }
+  }
+
+  for (std::uint32_t i = 0; i < struct_count(); ++i) {
+    document->insert_struct_type(
+        std::static_pointer_cast<StructType>(types[struct_type(i)]));
+  }
+  for (std::uint32_t i = 0; i < enum_count(); ++i) {
+    document->insert_enum_type(
+        std::static_pointer_cast<EnumType>(types[enum_type(i)]));
+  }
+  for (std::uint32_t i = 0; i < option_count(); ++i) {
+    const auto& record = option(i);
+    auto name = std::string(string(record.name));
+    switch (record.kind) {
+      case OptionKind::Bool: {
+        auto bool_option = std::make_shared<BoolOption>(name);
+        bool_option->set_value(record.bool_value != 0);
+        document->insert_option(bool_option);
+        break;
+      }
+      case OptionKind::Numeric: {
+        auto numeric_option = std::make_shared<NumericOption>(name);
+        numeric_option->set_value(record.numeric_value);
+        document->insert_option(numeric_option);
+        break;
+      }
+      case OptionKind::String: {
+        auto string_option = std::make_shared<StringOption>(name);
+        string_option->set_value(std::string(string(record.string_value)));
+        document->insert_option(string_option);
+        break;
+      }
+    }
+  }
+  return document;
+}
+
+}  // namespace toolman::image
@@ -0,0 +1,220 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_SCHEMA_IMAGE_H_
+#define TOOLMAN_SCHEMA_IMAGE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "src/document.h"
+
+// A schema image is a versioned, position independent binary form of a
+// compiled `Document` together with every imported type it references.
+//
+// All records are fixed size and refer to each other by index, and to the
+// string table by offset, so a loader can map the file and read the IR in
+// place:
+//
+//   ImageHeader
+//   TypeRecord[type_count]
+//   FieldRecord[field_count]
+//   EnumFieldRecord[enum_field_count]
+//   StringRef[comment_count]
+//   OptionRecord[option_count]
+//   uint32_t[struct_count]    indices of the document's structs
+//   uint32_t[enum_count]      indices of the document's enums
+//   char[string_size]         string table
+namespace toolman::image {
+
+constexpr char kMagic[4] = {'T', 'M', 'S', 'I'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+enum class TypeKind : std::uint8_t { Primitive, List, Map, Struct, Enum, Oneof };
+
+enum class OptionKind : std::uint8_t { Bool, Numeric, String };
+
+struct StringRef {
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+struct Section {
+  std::uint32_t offset;
+  std::uint32_t count;
+};
+
+struct ImageHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t size;
+  StringRef source;
+  Section types;
+  Section fields;
+  Section enum_fields;
+  Section comments;
+  Section options;
+  Section structs;
+  Section enums;
+  Section strings;
+};
+
+struct TypeRecord {
+  TypeKind kind;
+  // `PrimitiveType::TypeKind` of primitive types.
+  std::uint8_t primitive_kind;
+  std::uint16_t reserved;
+  StringRef name;
+  // Module that declares a struct or enum.
+  StringRef module;
+  // List: element type. Map: key type. Struct, enum and oneof: first field.
+  std::uint32_t first;
+  // Map: value type. Struct, enum and oneof: number of fields.
+  std::uint32_t second;
+  // Declaration of a struct, enum or oneof, zero for the shared types.
+  std::uint32_t line;
+  std::uint32_t column;
+};
+
+struct FieldRecord {
+  StringRef name;
+  std::uint32_t type;
+  std::uint32_t optional;
+  std::uint32_t first_comment;
+  std::uint32_t comment_count;
+  std::uint32_t line;
+  std::uint32_t column;
+};
+
+struct EnumFieldRecord {
+  StringRef name;
+  std::int32_t value;
+  std::uint32_t first_comment;
+  std::uint32_t comment_count;
+  std::uint32_t line;
+  std::uint32_t column;
+};
+
+struct OptionRecord {
+  StringRef name;
+  OptionKind kind;
+  std::uint8_t reserved[3];
+  std::uint32_t bool_value;
+  double numeric_value;
+  StringRef string_value;
+};
+
+class ImageError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Serializes `document` and every type it references.
+void write_image(const Document& document, std::ostream& ostream);
+
+std::string serialize_image(const Document& document);
+
+// Read-only view of a schema image. The view either maps a file or refers to
+// a caller owned buffer, records are read in place without deserialization.
+class SchemaImage final {
+ public:
+  // Maps the image at `path`, throws `ImageError` if it is not a valid image.
+  static std::unique_ptr<SchemaImage> map(const std::filesystem::path& path);
+
+  // Views an image held in `buffer`, which must outlive the returned view and
+  // be aligned to 8 bytes.
+  static std::unique_ptr<SchemaImage> view(std::string_view buffer);
+
+  ~SchemaImage();
+
+  SchemaImage(const SchemaImage&) = delete;
+  SchemaImage& operator=(const SchemaImage&) = delete;
+
+  [[nodiscard]] const ImageHeader& header() const {
+    return *reinterpret_cast<const ImageHeader*>(data_);
+  }
+
+  [[nodiscard]] std::string_view string(StringRef ref) const {
+    return {data_ + header().strings.offset + ref.offset, ref.length};
+  }
+
+  [[nodiscard]] std::string_view source() const {
+    return string(header().source);
+  }
+
+  [[nodiscard]] std::uint32_t type_count() const {
+    return header().types.count;
+  }
+
+  [[nodiscard]] const TypeRecord& type(std::uint32_t index) const {
+    return section<TypeRecord>(header().types)[index];
+  }
+
+  [[nodiscard]] const FieldRecord& field(std::uint32_t index) const {
+    return section<FieldRecord>(header().fields)[index];
+  }
+
+  [[nodiscard]] const EnumFieldRecord& enum_field(std::uint32_t index) const {
+    return section<EnumFieldRecord>(header().enum_fields)[index];
+  }
+
+  [[nodiscard]] std::string_view comment(std::uint32_t index) const {
+    return string(section<StringRef>(header().comments)[index]);
+  }
+
+  [[nodiscard]] std::uint32_t option_count() const {
+    return header().options.count;
+  }
+
+  [[nodiscard]] const OptionRecord& option(std::uint32_t index) const {
+    return section<OptionRecord>(header().options)[index];
+  }
+
+  [[nodiscard]] std::uint32_t struct_count() const {
+    return header().structs.count;
+  }
+
+  // Type index of the `index`-th struct declared by the document.
+  [[nodiscard]] std::uint32_t struct_type(std::uint32_t index) const {
+    return section<std::uint32_t>(header().structs)[index];
+  }
+
+  [[nodiscard]] std::uint32_t enum_count() const {
+    return header().enums.count;
+  }
+
+  [[nodiscard]] std::uint32_t enum_type(std::uint32_t index) const {
+    return section<std::uint32_t>(header().enums)[index];
+  }
+
+  // Builds the IR of the image, e.g. to run a generator on it.
+  [[nodiscard]] std::unique_ptr<Document> to_document() const;
+
+ private:
+  SchemaImage(const char* data, std::size_t size, bool mapped)
+      : data_(data), size_(size), mapped_(mapped) {}
+
+  template <typename T>
+  [[nodiscard]] const T* section(const Section& section) const {
+    return reinterpret_cast<const T*>(data_ + section.offset);
+  }
+
+  // Checks the header and that every section and reference is in bounds.
+  void validate() const;
+
+  const char* data_;
+  std::size_t size_;
+  bool mapped_;
+};
+
+}  // namespace toolman::image
+
+#endif  // TOOLMAN_SCHEMA_IMAGE_H_
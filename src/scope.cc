@@ -15,5 +15,14 @@ void decl_buildin_option(OptionScope* option_scope) {
   option_scope->declare(
       std::make_shared<std::remove_const_t<decltype(option_java_package)>>(
           option_java_package));
+  option_scope->declare(
+      std::make_shared<std::remove_const_t<decltype(option_go_json_codec)>>(
+          option_go_json_codec));
+  option_scope->declare(
+      std::make_shared<std::remove_const_t<decltype(option_java_json_codec)>>(
+          option_java_json_codec));
+  option_scope->declare(
+      std::make_shared<std::remove_const_t<decltype(option_ts_json_codec)>>(
+          option_ts_json_codec));
 }
 }  // namespace toolman::buildin
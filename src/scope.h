@@ -5,10 +5,15 @@
 #ifndef TOOLMAN_SCOPE_H_
 #define TOOLMAN_SCOPE_H_
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "src/option.h"
 #include "src/type.h"
@@ -22,37 +27,125 @@ class Scope {
       const_iterator;
 
   // Lookup returns the `T` with the given name if it is
-  // found in this scope, otherwise it returns std::nullopt.
-  std::optional<std::shared_ptr<T>> lookup(const std::string& name) {
-    if (const auto it = data_.find(name); data_.end() != it) {
-      return {it->second};
-    }
-    return std::nullopt;
+  // found in this scope or in one of the linked scopes,
+  // otherwise it returns std::nullopt.
+  // The own items are searched first, then the linked scopes
+  // in the order they were linked.
+  std::optional<std::shared_ptr<T>> lookup(const std::string& name) const {
+    std::optional<std::shared_ptr<T>> found;
+    visit([&](const Scope& scope) {
+      if (const auto it = scope.data_.find(name); scope.data_.end() != it) {
+        found = it->second;
+        return true;
+      }
+      return false;
+    });
+    return found;
   }
 
   // Declare a `T` into the scope.
-  // If the scope did not have this scope present, `true` is returned.
-  // If the map did have this key present, the value is updated,
-  // and the `false` is returned.
+  // If the name is not visible in the scope yet, `true` is returned.
+  // If it is, either declared here or in a linked scope,
+  // the scope is not changed and `false` is returned.
   bool declare(std::shared_ptr<T> item) {
-    auto res = data_.emplace(item->get_name(), std::move(item));
-    return res.second;
+    auto name = item->get_name();
+    return declare(std::move(item), name);
   }
 
   bool declare(std::shared_ptr<T> item, const std::string& alias_name) {
+    if (lookup(alias_name).has_value()) {
+      return false;
+    }
     auto res = data_.emplace(alias_name, std::move(item));
     return res.second;
   }
 
+  // Makes every item of `scope` visible in this scope without copying them,
+  // used for `from 'xxx.tm' import *`.
+  void link(std::shared_ptr<const Scope> scope) {
+    if (scope.get() != this) {
+      linked_.push_back(std::move(scope));
+    }
+  }
+
+  // Iterates the items declared in this scope, linked scopes are not
+  // included.
   [[nodiscard]] iterator begin() const { return data_.begin(); }
   [[nodiscard]] iterator end() const { return data_.end(); }
 
   [[nodiscard]] const_iterator cbegin() const { return data_.cbegin(); }
   [[nodiscard]] const_iterator cend() const { return data_.cend(); }
 
+  // Names of every item visible in this scope, linked scopes included.
+  [[nodiscard]] std::set<std::string> visible_names() const {
+    std::set<std::string> names;
+    collect_names(&names);
+    return names;
+  }
+
  private:
+  void collect_names(std::set<std::string>* names) const {
+    visit([&](const Scope& scope) {
+      for (const auto& item : scope.data_) {
+        names->insert(item.first);
+      }
+      return false;
+    });
+  }
+
+  // The scopes a `visit` went through. Lookups run per type reference and
+  // per keystroke in the language server, so the first scopes are kept on
+  // the stack and checked linearly, only large import graphs allocate.
+  class VisitedScopes {
+   public:
+    // Marks `scope` visited, false if it already was.
+    bool insert(const Scope* scope) {
+      auto end = inline_.begin() + std::min(size_, inline_.size());
+      if (std::find(inline_.begin(), end, scope) != end) {
+        return false;
+      }
+      if (size_ < inline_.size()) {
+        inline_[size_++] = scope;
+        return true;
+      }
+      return overflow_.insert(scope).second;
+    }
+
+   private:
+    std::array<const Scope*, 16> inline_;
+    std::size_t size_ = 0;
+    std::set<const Scope*> overflow_;
+  };
+
+  // Calls `f` with this scope, then with the linked scopes depth first in
+  // the order they were linked, until `f` returns true. A scope reached
+  // through several imports is visited once, so diamond imports cost no
+  // more than the number of scopes.
+  template <typename F>
+  void visit(F f) const {
+    if (f(*this) || linked_.empty()) {
+      return;
+    }
+    VisitedScopes visited;
+    visited.insert(this);
+    visit_linked(f, &visited);
+  }
+
+  template <typename F>
+  bool visit_linked(F& f, VisitedScopes* visited) const {
+    for (const auto& scope : linked_) {
+      if (visited->insert(scope.get()) &&
+          (f(*scope) || scope->visit_linked(f, visited))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   // Map of names to `T`
   std::map<std::string, std::shared_ptr<T>> data_;
+  // Scopes whose items are visible in this scope, searched in order.
+  std::vector<std::shared_ptr<const Scope>> linked_;
 };
 
 class TypeScope final : public Scope<Type> {};
@@ -62,6 +155,9 @@ class OptionScope final : public Scope<Option> {};
 namespace buildin {
 const auto option_use_java8_optional = BoolOption("use_java8_optional");
 const auto option_java_package = StringOption("java_package");
+const auto option_go_json_codec = BoolOption("go_json_codec");
+const auto option_java_json_codec = BoolOption("java_json_codec");
+const auto option_ts_json_codec = BoolOption("ts_json_codec");
 
 void decl_buildin_option(OptionScope* option_scope);
 }  // namespace buildin
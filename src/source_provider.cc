@@ -0,0 +1,222 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/source_provider.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+namespace toolman {
+
+namespace {
+std::filesystem::path normal(const std::filesystem::path& path) {
+  return std::filesystem::absolute(path).lexically_normal();
+}
+}  // namespace
+
+std::unique_ptr<std::istream> SourceProvider::open(
+    const std::filesystem::path& path) {
+  auto content = read(path);
+  if (!content.has_value()) {
+    return nullptr;
+  }
+  return std::make_unique<std::istringstream>(std::move(content.value()));
+}
+
+std::set<std::string> DiskSourceProvider::list_dir(
+    const std::filesystem::path& directory) {
+  std::set<std::string> entries;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(directory, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    entries.insert(it->path().filename().string());
+  }
+  return entries;
+}
+
+std::optional<ModuleId> DiskSourceProvider::identity(
+    const std::filesystem::path& path) {
+  struct stat st {};
+  if (stat(path.c_str(), &st) != 0) {
+    return std::nullopt;
+  }
+  return ModuleId{static_cast<std::uint64_t>(st.st_dev),
+                  static_cast<std::uint64_t>(st.st_ino)};
+}
+
+std::optional<std::string> DiskSourceProvider::read(
+    const std::filesystem::path& path) {
+  auto ifs = std::ifstream(path, std::ios_base::in | std::ios_base::binary);
+  if (!ifs.is_open()) {
+    return std::nullopt;
+  }
+  return std::string(std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>());
+}
+
+std::unique_ptr<std::istream> DiskSourceProvider::open(
+    const std::filesystem::path& path) {
+  auto ifs = std::make_unique<std::ifstream>(
+      path, std::ios_base::in | std::ios_base::binary);
+  if (!ifs->is_open()) {
+    return nullptr;
+  }
+  return ifs;
+}
+
+void OverlaySourceProvider::set_file(const std::filesystem::path& path,
+                                     std::string content) {
+  auto [it, inserted] = files_.try_emplace(normal(path));
+  if (inserted) {
+    it->second.inode = next_inode_++;
+  }
+  it->second.content = std::move(content);
+}
+
+void OverlaySourceProvider::remove_file(const std::filesystem::path& path) {
+  files_.erase(normal(path));
+}
+
+std::set<std::string> OverlaySourceProvider::list_dir(
+    const std::filesystem::path& directory) {
+  std::set<std::string> entries;
+  if (underlying_) {
+    entries = underlying_->list_dir(directory);
+  }
+  for (const auto& [path, file] : files_) {
+    if (path.parent_path() == directory) {
+      entries.insert(path.filename().string());
+    }
+  }
+  return entries;
+}
+
+std::optional<ModuleId> OverlaySourceProvider::identity(
+    const std::filesystem::path& path) {
+  if (auto it = files_.find(path); it != files_.end()) {
+    return ModuleId{kDevice, it->second.inode};
+  }
+  return underlying_ ? underlying_->identity(path) : std::nullopt;
+}
+
+std::optional<std::string> OverlaySourceProvider::read(
+    const std::filesystem::path& path) {
+  if (auto it = files_.find(path); it != files_.end()) {
+    return it->second.content;
+  }
+  return underlying_ ? underlying_->read(path) : std::nullopt;
+}
+
+namespace {
+constexpr std::size_t kTarBlockSize = 512;
+
+// A NUL terminated field of at most `size` characters.
+std::string_view tar_string(const char* field, std::size_t size) {
+  std::size_t length = 0;
+  while (length < size && field[length] != '\0') {
+    ++length;
+  }
+  return std::string_view(field, length);
+}
+
+std::uint64_t tar_octal(const char* field, std::size_t size) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    if (field[i] >= '0' && field[i] <= '7') {
+      value = value * 8 + static_cast<std::uint64_t>(field[i] - '0');
+    } else if (field[i] != ' ' || value != 0) {
+      break;
+    }
+  }
+  return value;
+}
+}  // namespace
+
+ArchiveSourceProvider::ArchiveSourceProvider(
+    std::string archive, const std::filesystem::path& mount_point)
+    : archive_(std::move(archive)) {
+  auto root = normal(mount_point);
+  std::string long_name;
+  std::size_t offset = 0;
+  while (offset + kTarBlockSize <= archive_.size()) {
+    const char* header = archive_.data() + offset;
+    if (header[0] == '\0') {
+      // End of archive marker.
+      break;
+    }
+    auto size = tar_octal(header + 124, 12);
+    auto type = header[156];
+    offset += kTarBlockSize;
+    if (size > archive_.size() - offset) {
+      throw ArchiveError("truncated archive entry `" +
+                         std::string(tar_string(header, 100)) + "`");
+    }
+    std::string_view content(archive_.data() + offset, size);
+    offset += (size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize;
+
+    if (type == 'L') {
+      // GNU long name of the next entry.
+      long_name = std::string(tar_string(content.data(), content.size()));
+      continue;
+    }
+    std::string name;
+    if (!long_name.empty()) {
+      name = std::exchange(long_name, std::string());
+    } else {
+      name = std::string(tar_string(header, 100));
+      auto prefix = tar_string(header + 345, 155);
+      if (tar_string(header + 257, 5) == "ustar" && !prefix.empty()) {
+        name = std::string(prefix) + "/" + name;
+      }
+    }
+    if (type != '0' && type != '\0' && type != '7') {
+      continue;
+    }
+    auto path = (root / std::filesystem::path(name).relative_path())
+                    .lexically_normal();
+    entries_[path] = Entry{entries_.size(), content};
+    directories_[path.parent_path()].insert(path.filename().string());
+  }
+}
+
+std::unique_ptr<ArchiveSourceProvider> ArchiveSourceProvider::open(
+    const std::filesystem::path& path,
+    const std::filesystem::path& mount_point) {
+  auto archive = DiskSourceProvider().read(path);
+  if (!archive.has_value()) {
+    throw ArchiveError("cannot open archive `" + path.string() + "`");
+  }
+  return std::make_unique<ArchiveSourceProvider>(std::move(archive.value()),
+                                                 mount_point);
+}
+
+std::set<std::string> ArchiveSourceProvider::list_dir(
+    const std::filesystem::path& directory) {
+  if (auto it = directories_.find(directory); it != directories_.end()) {
+    return it->second;
+  }
+  return {};
+}
+
+std::optional<ModuleId> ArchiveSourceProvider::identity(
+    const std::filesystem::path& path) {
+  if (auto it = entries_.find(path); it != entries_.end()) {
+    return ModuleId{kDevice, it->second.inode};
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> ArchiveSourceProvider::read(
+    const std::filesystem::path& path) {
+  if (auto it = entries_.find(path); it != entries_.end()) {
+    return std::string(it->second.content);
+  }
+  return std::nullopt;
+}
+
+}  // namespace toolman
@@ -0,0 +1,144 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_SOURCE_PROVIDER_H_
+#define TOOLMAN_SOURCE_PROVIDER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace toolman {
+
+// Identity of a module file, the same for every path that reaches it,
+// e.g. through symlinks or different relative spellings. Only meaningful
+// within one source provider.
+struct ModuleId {
+  std::uint64_t device;
+  std::uint64_t inode;
+
+  bool operator<(const ModuleId& rhs) const {
+    return std::tie(device, inode) < std::tie(rhs.device, rhs.inode);
+  }
+
+  bool operator==(const ModuleId& rhs) const {
+    return device == rhs.device && inode == rhs.inode;
+  }
+};
+
+// Where the compiler reads sources from. Paths are absolute and lexically
+// normal.
+class SourceProvider {
+ public:
+  virtual ~SourceProvider() = default;
+
+  // Names of the entries of `directory`, empty if it does not exist.
+  [[nodiscard]] virtual std::set<std::string> list_dir(
+      const std::filesystem::path& directory) = 0;
+
+  // Identity of the file at `path`, std::nullopt if there is none.
+  [[nodiscard]] virtual std::optional<ModuleId> identity(
+      const std::filesystem::path& path) = 0;
+
+  // Content of the file at `path`, std::nullopt if there is none.
+  [[nodiscard]] virtual std::optional<std::string> read(
+      const std::filesystem::path& path) = 0;
+
+  // Stream over the file at `path`, null if there is none. For reading
+  // large files piecewise; by default the whole file is read.
+  [[nodiscard]] virtual std::unique_ptr<std::istream> open(
+      const std::filesystem::path& path);
+};
+
+// The real file system.
+class DiskSourceProvider final : public SourceProvider {
+ public:
+  std::set<std::string> list_dir(
+      const std::filesystem::path& directory) override;
+  std::optional<ModuleId> identity(const std::filesystem::path& path) override;
+  std::optional<std::string> read(const std::filesystem::path& path) override;
+  std::unique_ptr<std::istream> open(
+      const std::filesystem::path& path) override;
+};
+
+// In-memory files over another provider, e.g. the unsaved buffers of an
+// editor over the disk. Files set here shadow the underlying ones.
+class OverlaySourceProvider final : public SourceProvider {
+ public:
+  // `underlying` may be null, only the overlay files exist then.
+  explicit OverlaySourceProvider(std::shared_ptr<SourceProvider> underlying)
+      : underlying_(std::move(underlying)) {}
+
+  void set_file(const std::filesystem::path& path, std::string content);
+
+  void remove_file(const std::filesystem::path& path);
+
+  std::set<std::string> list_dir(
+      const std::filesystem::path& directory) override;
+  std::optional<ModuleId> identity(const std::filesystem::path& path) override;
+  std::optional<std::string> read(const std::filesystem::path& path) override;
+
+ private:
+  // Kept apart from the device numbers of the underlying provider.
+  static constexpr std::uint64_t kDevice =
+      std::numeric_limits<std::uint64_t>::max();
+
+  struct File {
+    std::uint64_t inode;
+    std::string content;
+  };
+
+  std::shared_ptr<SourceProvider> underlying_;
+  std::map<std::filesystem::path, File> files_;
+  std::uint64_t next_inode_ = 0;
+};
+
+class ArchiveError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// The regular files of a tar archive (ustar or GNU), read only, with the
+// archive root at `mount_point`.
+class ArchiveSourceProvider final : public SourceProvider {
+ public:
+  ArchiveSourceProvider(std::string archive,
+                        const std::filesystem::path& mount_point);
+
+  // Reads the archive file at `path`, throws ArchiveError if it is not one.
+  static std::unique_ptr<ArchiveSourceProvider> open(
+      const std::filesystem::path& path,
+      const std::filesystem::path& mount_point);
+
+  std::set<std::string> list_dir(
+      const std::filesystem::path& directory) override;
+  std::optional<ModuleId> identity(const std::filesystem::path& path) override;
+  std::optional<std::string> read(const std::filesystem::path& path) override;
+
+ private:
+  static constexpr std::uint64_t kDevice =
+      std::numeric_limits<std::uint64_t>::max() - 1;
+
+  struct Entry {
+    std::uint64_t inode;
+    std::string_view content;
+  };
+
+  std::string archive_;
+  std::map<std::filesystem::path, Entry> entries_;
+  std::map<std::filesystem::path, std::set<std::string>> directories_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_SOURCE_PROVIDER_H_
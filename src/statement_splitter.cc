@@ -0,0 +1,122 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/statement_splitter.h"
+
+#include <cctype>
+
+namespace toolman {
+
+namespace {
+bool is_word_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+}  // namespace
+
+std::optional<char> StatementSplitter::take(std::string* text) {
+  auto c = istream_->rdbuf()->sbumpc();
+  if (c == std::char_traits<char>::eof()) {
+    return std::nullopt;
+  }
+  auto ch = static_cast<char>(c);
+  text->push_back(ch);
+  if (ch == '\n') {
+    ++line_;
+    column_ = 0;
+  } else if ((static_cast<unsigned char>(ch) & 0xC0) != 0x80) {
+    // Columns count code points, not UTF-8 continuation bytes.
+    ++column_;
+  }
+  return ch;
+}
+
+std::optional<StatementSplitter::Statement> StatementSplitter::next() {
+  Statement statement{std::string(), Kind::Trailing, line_, column_};
+  std::string first_word;
+  bool in_first_word = false;
+  std::size_t depth = 0;
+
+  while (auto c = take(&statement.text)) {
+    if (in_first_word && !is_word_char(*c)) {
+      in_first_word = false;
+    }
+    switch (*c) {
+      case '/':
+        if (peek() == '/') {
+          while (peek() != '\n' && take(&statement.text)) {
+          }
+          continue;
+        }
+        if (peek() == '*') {
+          take(&statement.text);
+          char previous = '\0';
+          while (auto in_comment = take(&statement.text)) {
+            if (previous == '*' && *in_comment == '/') {
+              break;
+            }
+            previous = *in_comment;
+          }
+          continue;
+        }
+        break;
+      case '"':
+      case '\'':
+        while (auto in_string = take(&statement.text)) {
+          if (*in_string == '\\') {
+            take(&statement.text);
+          } else if (*in_string == *c || *in_string == '\n') {
+            break;
+          }
+        }
+        break;
+      case '(':
+      case '[':
+      case '{':
+        ++depth;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        if (depth > 0 && --depth == 0) {
+          statement.kind = Kind::Declaration;
+          return statement;
+        }
+        break;
+      case ';':
+        if (depth == 0) {
+          if (first_word == "from") {
+            statement.kind = Kind::Import;
+          } else if (first_word == "option") {
+            statement.kind = Kind::Option;
+          } else {
+            statement.kind = Kind::Declaration;
+          }
+          return statement;
+        }
+        break;
+      default:
+        if (first_word.empty() && is_word_char(*c)) {
+          in_first_word = true;
+        }
+        if (in_first_word) {
+          first_word.push_back(*c);
+        }
+        break;
+    }
+  }
+
+  if (statement.text.empty()) {
+    return std::nullopt;
+  }
+  // Text after the last statement, parsed as is unless it is blank.
+  for (auto c : statement.text) {
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      statement.kind = Kind::Declaration;
+      break;
+    }
+  }
+  return statement;
+}
+
+}  // namespace toolman
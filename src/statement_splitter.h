@@ -0,0 +1,53 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_STATEMENT_SPLITTER_H_
+#define TOOLMAN_STATEMENT_SPLITTER_H_
+
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <string>
+
+namespace toolman {
+
+// Splits a source into its top level statements without lexing it, so that
+// a large file can be compiled one statement at a time.
+//
+// A statement ends with a `;` or with the bracket closing its outermost
+// bracket, outside of comments and string literals. Whitespace and comments
+// in front of a statement belong to it, so that the statements concatenated
+// give back the source.
+class StatementSplitter final {
+ public:
+  enum class Kind : char { Import, Option, Declaration, Trailing };
+
+  struct Statement {
+    std::string text;
+    Kind kind;
+    // Position of the first character in the source, like ANTLR's: lines
+    // start at 1, columns at 0.
+    std::size_t line;
+    std::size_t column;
+  };
+
+  explicit StatementSplitter(std::istream* istream) : istream_(istream) {}
+
+  // The next statement, std::nullopt at the end of the source.
+  std::optional<Statement> next();
+
+ private:
+  // Appends the next character to `text`, std::nullopt at the end.
+  std::optional<char> take(std::string* text);
+
+  [[nodiscard]] int peek() const { return istream_->rdbuf()->sgetc(); }
+
+  std::istream* istream_;
+  std::size_t line_ = 1;
+  std::size_t column_ = 0;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_STATEMENT_SPLITTER_H_
@@ -10,8 +10,12 @@
 #include <string>
 #include <utility>
 
+#include "src/mem_report.h"
+
 namespace toolman {
-class StmtInfo final {
+// Where a declaration is in its source. Lines start at 1 and columns at 0,
+// like ANTLR's; the end column is one past the last character.
+class StmtInfo final : private mem::Tracked<StmtInfo> {
  public:
   StmtInfo(unsigned int start_line_no, unsigned int start_column_no,
            std::shared_ptr<std::filesystem::path> source)
@@ -0,0 +1,205 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/toolman_c.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/compiler.h"
+#include "src/generator.h"
+#include "src/source_provider.h"
+
+struct toolman_compiler {
+  toolman_compiler()
+      : overlay(std::make_shared<toolman::OverlaySourceProvider>(
+            std::make_shared<toolman::DiskSourceProvider>())) {
+    compiler.set_source_provider(overlay);
+  }
+
+  toolman::Compiler compiler;
+  std::shared_ptr<toolman::OverlaySourceProvider> overlay;
+};
+
+struct toolman_result {
+  struct Diagnostic {
+    std::string message;
+    bool fatal;
+  };
+
+  std::unique_ptr<toolman::Document> document;
+  std::vector<Diagnostic> diagnostics;
+  // Generated code by target, rendered once.
+  std::map<toolman_target, std::string> outputs;
+};
+
+namespace {
+toolman_result* make_result(toolman::CompileResult compile_result) {
+  auto result = new toolman_result();
+  for (const auto& error : compile_result.get_errors()) {
+    result->diagnostics.push_back({error.error(), error.is_fatal()});
+  }
+  result->document = compile_result.get_document();
+  return result;
+}
+
+toolman_result* make_failure(std::string message) {
+  auto result = new toolman_result();
+  result->diagnostics.push_back({std::move(message), true});
+  return result;
+}
+
+// Exceptions must not cross the C boundary.
+template <typename F>
+toolman_result* compile_guarded(F compile) {
+  try {
+    return make_result(compile());
+  } catch (toolman::FileNotFoundError& e) {
+    return make_failure("file not found: " + e.filepath()->string());
+  } catch (std::exception& e) {
+    return make_failure(e.what());
+  }
+}
+
+// The language of `target`, nothing if it is not one of toolman_target, as
+// C callers may pass any int.
+std::optional<toolman::generator::TargetLanguage> target_language(
+    toolman_target target) {
+  switch (target) {
+    case TOOLMAN_TARGET_GO:
+      return toolman::generator::TargetLanguage::GOLANG;
+    case TOOLMAN_TARGET_JAVA:
+      return toolman::generator::TargetLanguage::JAVA;
+    case TOOLMAN_TARGET_TYPESCRIPT:
+      return toolman::generator::TargetLanguage::TYPESCRIPT;
+  }
+  return std::nullopt;
+}
+}  // namespace
+
+extern "C" {
+
+toolman_compiler* toolman_compiler_new(void) { return new toolman_compiler(); }
+
+void toolman_compiler_free(toolman_compiler* compiler) { delete compiler; }
+
+void toolman_compiler_add_import_path(toolman_compiler* compiler,
+                                      const char* path) {
+  if (compiler != nullptr && path != nullptr) {
+    compiler->compiler.add_import_path(path);
+  }
+}
+
+void toolman_compiler_set_file(toolman_compiler* compiler, const char* path,
+                               const char* data, size_t size) {
+  if (compiler != nullptr && path != nullptr &&
+      (data != nullptr || size == 0)) {
+    compiler->overlay->set_file(
+        path, std::string(data == nullptr ? "" : data, size));
+  }
+}
+
+void toolman_compiler_remove_file(toolman_compiler* compiler,
+                                  const char* path) {
+  if (compiler != nullptr && path != nullptr) {
+    compiler->overlay->remove_file(path);
+  }
+}
+
+toolman_result* toolman_compile_file(toolman_compiler* compiler,
+                                     const char* path) {
+  if (compiler == nullptr || path == nullptr) {
+    return make_failure("invalid argument");
+  }
+  return compile_guarded([&]() { return compiler->compiler.compile(path); });
+}
+
+toolman_result* toolman_compile_buffer(toolman_compiler* compiler,
+                                       const char* path, const char* data,
+                                       size_t size) {
+  if (compiler == nullptr || (data == nullptr && size != 0)) {
+    return make_failure("invalid argument");
+  }
+  return compile_guarded([&]() {
+    std::istringstream content(std::string(data == nullptr ? "" : data, size));
+    return compiler->compiler.compile(path != nullptr ? path : "buffer.tm",
+                                      content);
+  });
+}
+
+void toolman_result_free(toolman_result* result) { delete result; }
+
+int toolman_result_ok(const toolman_result* result) {
+  if (result == nullptr) {
+    return 0;
+  }
+  for (const auto& diagnostic : result->diagnostics) {
+    if (diagnostic.fatal) {
+      return 0;
+    }
+  }
+  return result->document != nullptr;
+}
+
+size_t toolman_result_diagnostic_count(const toolman_result* result) {
+  return result == nullptr ? 0 : result->diagnostics.size();
+}
+
+const char* toolman_result_diagnostic_message(const toolman_result* result,
+                                              size_t index) {
+  if (result == nullptr || index >= result->diagnostics.size()) {
+    return nullptr;
+  }
+  return result->diagnostics[index].message.c_str();
+}
+
+int toolman_result_diagnostic_is_fatal(const toolman_result* result,
+                                       size_t index) {
+  if (result == nullptr || index >= result->diagnostics.size()) {
+    return 0;
+  }
+  return result->diagnostics[index].fatal;
+}
+
+toolman_status toolman_generate(toolman_result* result, toolman_target target,
+                                char* buffer, size_t capacity, size_t* length) {
+  auto language = target_language(target);
+  if (result == nullptr || (buffer == nullptr && capacity != 0) ||
+      !language) {
+    return TOOLMAN_INVALID_ARGUMENT;
+  }
+  if (!toolman_result_ok(result)) {
+    return TOOLMAN_COMPILE_FAILED;
+  }
+  auto it = result->outputs.find(target);
+  if (it == result->outputs.end()) {
+    // Exceptions must not cross the C boundary.
+    try {
+      std::ostringstream ostream;
+      toolman::generator::generate(result->document, *language, ostream);
+      it = result->outputs.emplace(target, ostream.str()).first;
+    } catch (std::exception& e) {
+      result->diagnostics.push_back({e.what(), false});
+      return TOOLMAN_GENERATE_FAILED;
+    }
+  }
+  const auto& output = it->second;
+  if (length != nullptr) {
+    *length = output.size();
+  }
+  if (capacity <= output.size()) {
+    return TOOLMAN_BUFFER_TOO_SMALL;
+  }
+  std::memcpy(buffer, output.data(), output.size());
+  buffer[output.size()] = '\0';
+  return TOOLMAN_OK;
+}
+
+}  // extern "C"
@@ -0,0 +1,99 @@
+/* Copyright 2020 the Toolman project authors. All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file. */
+
+#ifndef TOOLMAN_TOOLMAN_C_H_
+#define TOOLMAN_TOOLMAN_C_H_
+
+/* C API of libtoolman, for embedding the compiler in other processes.
+ *
+ * Handles are opaque. A compiler may be used by one thread at a time,
+ * distinct compilers may be used concurrently. A result stays valid until it
+ * is freed, independently of its compiler. */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on every incompatible change of this header. */
+#define TOOLMAN_C_API_VERSION 1
+
+typedef struct toolman_compiler toolman_compiler;
+typedef struct toolman_result toolman_result;
+
+typedef enum toolman_status {
+  TOOLMAN_OK = 0,
+  /* The result has fatal diagnostics, nothing can be generated from it. */
+  TOOLMAN_COMPILE_FAILED = 1,
+  /* The output did not fit, see `toolman_generate`. */
+  TOOLMAN_BUFFER_TOO_SMALL = 2,
+  TOOLMAN_INVALID_ARGUMENT = 3,
+  /* The generator failed, its message is appended to the diagnostics of the
+   * result as a non fatal diagnostic. */
+  TOOLMAN_GENERATE_FAILED = 4,
+} toolman_status;
+
+typedef enum toolman_target {
+  TOOLMAN_TARGET_GO = 0,
+  TOOLMAN_TARGET_JAVA = 1,
+  TOOLMAN_TARGET_TYPESCRIPT = 2,
+} toolman_target;
+
+toolman_compiler* toolman_compiler_new(void);
+
+void toolman_compiler_free(toolman_compiler* compiler);
+
+/* Adds a directory to search for imported modules. */
+void toolman_compiler_add_import_path(toolman_compiler* compiler,
+                                      const char* path);
+
+/* Sets the content of the file at `path` for every later compile of
+ * `compiler`, shadowing the file on disk if there is one. Used for unsaved
+ * editor buffers, also when they are imported. */
+void toolman_compiler_set_file(toolman_compiler* compiler, const char* path,
+                               const char* data, size_t size);
+
+/* Undoes `toolman_compiler_set_file`. */
+void toolman_compiler_remove_file(toolman_compiler* compiler,
+                                  const char* path);
+
+/* Compiles the file at `path`. Never returns NULL, failures are reported as
+ * diagnostics of the result. */
+toolman_result* toolman_compile_file(toolman_compiler* compiler,
+                                     const char* path);
+
+/* Compiles `size` bytes at `data` as the file at `path`, which is only used
+ * to resolve imports and in diagnostics and may be NULL. */
+toolman_result* toolman_compile_buffer(toolman_compiler* compiler,
+                                       const char* path, const char* data,
+                                       size_t size);
+
+void toolman_result_free(toolman_result* result);
+
+/* Whether the result has no fatal diagnostics. */
+int toolman_result_ok(const toolman_result* result);
+
+size_t toolman_result_diagnostic_count(const toolman_result* result);
+
+/* The message of the `index`th diagnostic, owned by the result. */
+const char* toolman_result_diagnostic_message(const toolman_result* result,
+                                              size_t index);
+
+int toolman_result_diagnostic_is_fatal(const toolman_result* result,
+                                       size_t index);
+
+/* Generates code for `target` into `buffer` of `capacity` bytes, NUL
+ * terminated. The length of the whole output, without the NUL, is stored in
+ * `length` if it is not NULL, also when TOOLMAN_BUFFER_TOO_SMALL is returned,
+ * so that the call can be retried with a large enough buffer. Returns
+ * TOOLMAN_INVALID_ARGUMENT for a `target` that is not a toolman_target. */
+toolman_status toolman_generate(toolman_result* result, toolman_target target,
+                                char* buffer, size_t capacity, size_t* length);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // TOOLMAN_TOOLMAN_C_H_
@@ -8,25 +8,32 @@
 #include <string>
 #include <utility>
 
-#include "src/stmt_info.h"
-
 namespace toolman {
 
-class Type : public HasStmtInfo {
+// Types carry no source location: primitives, lists and maps are shared by
+// every use, see src/type_table.h. Declared types are a CustomType, which
+// records where they are declared.
+class Type {
  public:
+  // Tags the concrete class of a type, so that code can switch on it instead
+  // of probing with dynamic_cast, see src/type_visitor.h.
+  enum class Kind : char { Primitive, List, Map, Struct, Enum, Oneof };
+
   [[nodiscard]] virtual const std::string& get_name() const { return name_; }
 
-  [[nodiscard]] virtual bool is_primitive() const { return false; }
+  [[nodiscard]] Kind kind() const { return kind_; }
 
-  [[nodiscard]] virtual bool is_enum() const { return false; }
+  [[nodiscard]] bool is_primitive() const { return kind_ == Kind::Primitive; }
 
-  [[nodiscard]] virtual bool is_struct() const { return false; }
+  [[nodiscard]] bool is_enum() const { return kind_ == Kind::Enum; }
 
-  [[nodiscard]] virtual bool is_list() const { return false; }
+  [[nodiscard]] bool is_struct() const { return kind_ == Kind::Struct; }
 
-  [[nodiscard]] virtual bool is_map() const { return false; }
+  [[nodiscard]] bool is_list() const { return kind_ == Kind::List; }
 
-  [[nodiscard]] virtual bool is_oneof() const { return false; }
+  [[nodiscard]] bool is_map() const { return kind_ == Kind::Map; }
+
+  [[nodiscard]] bool is_oneof() const { return kind_ == Kind::Oneof; }
 
   [[nodiscard]] virtual std::string to_string() const = 0;
 
@@ -36,12 +43,13 @@ class Type : public HasStmtInfo {
   virtual ~Type() = default;
 
  protected:
-  template <typename S, typename SI>
-  Type(S&& name, SI&& stmt_info)
-      : name_(std::forward<S>(name)),
-        HasStmtInfo(std::forward<SI>(stmt_info)) {}
+  template <typename S>
+  Type(Kind kind, S&& name) : name_(std::forward<S>(name)), kind_(kind) {}
 
   std::string name_;
+
+ private:
+  Kind kind_;
 };
 
 }  // namespace toolman
@@ -0,0 +1,165 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/type_hash.h"
+
+#include <algorithm>
+
+#include "src/hash.h"
+#include "src/type_visitor.h"
+
+namespace toolman {
+
+void TypeHasher::describe(const Type* type, std::string* out) {
+  if (type == nullptr) {
+    out->append("?");
+    return;
+  }
+  visit_type(*type, Overloaded{
+                        [&](const PrimitiveType& primitive) {
+                          out->append(primitive.to_string());
+                        },
+                        [&](const ListType& list) {
+                          out->append("[");
+                          describe(list.get_elem_type().get(), out);
+                          out->append("]");
+                        },
+                        [&](const MapType& map) {
+                          out->append("{");
+                          describe(map.get_key_type().get(), out);
+                          out->append(":");
+                          describe(map.get_value_type().get(), out);
+                          out->append("}");
+                        },
+                        [&](const OneofType& oneof) {
+                          out->append("(");
+                          for (const auto& field : oneof.get_fields()) {
+                            out->append(field.get_name()).append(":");
+                            describe(field.get_type().get(), out);
+                            out->append("|");
+                          }
+                          out->append(")");
+                        },
+                        [&](const auto& custom_type) {
+                          out->append(custom_type.is_struct() ? "struct "
+                                                              : "enum ")
+                              .append(custom_type.get_name());
+                        },
+                    });
+}
+
+std::uint64_t TypeHasher::declaration_hash(const Type* type) {
+  if (auto it = declaration_hashes_.find(type);
+      it != declaration_hashes_.end()) {
+    return it->second;
+  }
+  // A NUL separates the parts, names and comments never contain one.
+  std::string declaration;
+  auto append_comments = [&](const std::vector<std::string>& comments) {
+    for (const auto& comment : comments) {
+      declaration.append("///").append(comment).push_back('\0');
+    }
+  };
+  if (auto struct_type = type_cast<StructType>(type)) {
+    declaration.append("struct ").append(type->get_name()).push_back('\0');
+    for (const auto& field : struct_type->get_fields()) {
+      append_comments(field.get_comments());
+      declaration.append(field.get_name()).append(":");
+      describe(field.get_type().get(), &declaration);
+      declaration.append(field.is_optional() ? "?" : "").push_back('\0');
+    }
+  } else if (auto enum_type = type_cast<EnumType>(type)) {
+    declaration.append("enum ").append(type->get_name()).push_back('\0');
+    for (const auto& field : enum_type->get_fields()) {
+      append_comments(field.get_comments());
+      declaration.append(field.get_name())
+          .append("=")
+          .append(std::to_string(field.get_value()))
+          .push_back('\0');
+    }
+  } else {
+    describe(type, &declaration);
+  }
+  auto hash = hash::fnv1a(declaration);
+  declaration_hashes_.emplace(type, hash);
+  return hash;
+}
+
+void TypeHasher::direct_references(const Type* type,
+                                   std::set<const Type*>* references) {
+  auto visit_field_type = [&](const Type* field_type, const auto& visit) {
+    if (field_type == nullptr) {
+      return;
+    }
+    switch (field_type->kind()) {
+      case Type::Kind::List:
+        visit(static_cast<const ListType*>(field_type)->get_elem_type().get(),
+              visit);
+        break;
+      case Type::Kind::Map: {
+        auto map = static_cast<const MapType*>(field_type);
+        visit(map->get_key_type().get(), visit);
+        visit(map->get_value_type().get(), visit);
+        break;
+      }
+      case Type::Kind::Oneof:
+        for (const auto& field :
+             static_cast<const OneofType*>(field_type)->get_fields()) {
+          visit(field.get_type().get(), visit);
+        }
+        break;
+      case Type::Kind::Struct:
+      case Type::Kind::Enum:
+        references->insert(field_type);
+        break;
+      case Type::Kind::Primitive:
+        break;
+    }
+  };
+  if (auto struct_type = type_cast<StructType>(type)) {
+    for (const auto& field : struct_type->get_fields()) {
+      visit_field_type(field.get_type().get(), visit_field_type);
+    }
+  }
+}
+
+const std::vector<const Type*>& TypeHasher::closure(const Type* type) {
+  if (auto it = closures_.find(type); it != closures_.end()) {
+    return it->second;
+  }
+  std::set<const Type*> reached;
+  std::vector<const Type*> pending{type};
+  while (!pending.empty()) {
+    auto current = pending.back();
+    pending.pop_back();
+    std::set<const Type*> references;
+    direct_references(current, &references);
+    for (auto reference : references) {
+      if (reached.insert(reference).second) {
+        pending.push_back(reference);
+      }
+    }
+  }
+  std::vector<const Type*> sorted(reached.begin(), reached.end());
+  std::sort(sorted.begin(), sorted.end(), [](auto lhs, auto rhs) {
+    return lhs->get_name() < rhs->get_name();
+  });
+  return closures_.emplace(type, std::move(sorted)).first->second;
+}
+
+std::uint64_t TypeHasher::closure_hash(const Type* type) {
+  auto hash = hash::kFnvOffsetBasis;
+  auto append = [&](std::uint64_t value) {
+    hash = hash::fnv1a(
+        std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)),
+        hash);
+  };
+  append(declaration_hash(type));
+  for (auto reference : closure(type)) {
+    append(declaration_hash(reference));
+  }
+  return hash;
+}
+
+}  // namespace toolman
@@ -0,0 +1,50 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_TYPE_HASH_H_
+#define TOOLMAN_TYPE_HASH_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "src/custom_type.h"
+#include "src/type.h"
+
+namespace toolman {
+
+// Content hashes of declared types, for regenerating only the types that
+// changed. Results are memoized, a hasher must not outlive the types.
+class TypeHasher final {
+ public:
+  // Hash of the declaration of `type` alone: its name, its fields and the
+  // names of the types they refer to.
+  std::uint64_t declaration_hash(const Type* type);
+
+  // Struct and enum types reached from the fields of `type`, through lists,
+  // maps and oneofs, transitively. `type` itself is left out unless it is
+  // recursive. Sorted by name.
+  const std::vector<const Type*>& closure(const Type* type);
+
+  // Hash of the declarations of `type` and of its closure, changes whenever
+  // anything `type` depends on changes.
+  std::uint64_t closure_hash(const Type* type);
+
+ private:
+  // Declared types referenced directly by the fields of `type`.
+  static void direct_references(const Type* type,
+                                std::set<const Type*>* references);
+
+  // Appends a canonical spelling of a field type to `out`.
+  static void describe(const Type* type, std::string* out);
+
+  std::map<const Type*, std::uint64_t> declaration_hashes_;
+  std::map<const Type*, std::vector<const Type*>> closures_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_TYPE_HASH_H_
@@ -0,0 +1,40 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#include "src/type_table.h"
+
+namespace toolman {
+
+TypeTable::TypeTable() {
+  for (std::size_t i = 0; i < primitives_.size(); ++i) {
+    primitives_[i] = std::make_shared<PrimitiveType>(
+        static_cast<PrimitiveType::TypeKind>(i));
+  }
+}
+
+std::shared_ptr<ListType> TypeTable::list(
+    const std::shared_ptr<Type>& elem_type) {
+  auto& list = lists_[elem_type.get()];
+  if (!list) {
+    list = std::make_shared<ListType>(elem_type);
+  }
+  return list;
+}
+
+std::shared_ptr<MapType> TypeTable::map(
+    const std::shared_ptr<PrimitiveType>& key_type,
+    const std::shared_ptr<Type>& value_type) {
+  auto& map = maps_[{key_type.get(), value_type.get()}];
+  if (!map) {
+    map = std::make_shared<MapType>(key_type, value_type);
+  }
+  return map;
+}
+
+void TypeTable::clear() {
+  lists_.clear();
+  maps_.clear();
+}
+
+}  // namespace toolman
@@ -0,0 +1,73 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_TYPE_TABLE_H_
+#define TOOLMAN_TYPE_TABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "src/list_type.h"
+#include "src/map_type.h"
+#include "src/primitive_type.h"
+#include "src/type.h"
+
+namespace toolman {
+
+// Hash-conses the structural types: primitives, lists and maps. Each
+// distinct one is created once and shared by every use, so two types from
+// the same table are structurally equal if and only if they are the same
+// object, and a Type* can key maps and caches.
+//
+// Struct, enum and oneof types are nominal, their identity is their
+// declaration. Element types must be built first, i.e. bottom-up.
+class TypeTable {
+ public:
+  TypeTable();
+
+  [[nodiscard]] const std::shared_ptr<PrimitiveType>& primitive(
+      PrimitiveType::TypeKind type_kind) const {
+    return primitives_[static_cast<std::size_t>(type_kind)];
+  }
+
+  [[nodiscard]] std::shared_ptr<ListType> list(
+      const std::shared_ptr<Type>& elem_type);
+
+  [[nodiscard]] std::shared_ptr<MapType> map(
+      const std::shared_ptr<PrimitiveType>& key_type,
+      const std::shared_ptr<Type>& value_type);
+
+  // Forgets the lists and maps, the types already handed out stay valid.
+  void clear();
+
+  [[nodiscard]] std::size_t size() const {
+    return primitives_.size() + lists_.size() + maps_.size();
+  }
+
+ private:
+  struct PairHash {
+    std::size_t operator()(
+        const std::pair<const Type*, const Type*>& key) const {
+      auto hash = std::hash<const Type*>()(key.first);
+      return hash ^ (std::hash<const Type*>()(key.second) + 0x9e3779b9 +
+                     (hash << 6) + (hash >> 2));
+    }
+  };
+
+  std::array<std::shared_ptr<PrimitiveType>,
+             static_cast<std::size_t>(PrimitiveType::TypeKind::Any) + 1>
+      primitives_;
+  std::unordered_map<const Type*, std::shared_ptr<ListType>> lists_;
+  std::unordered_map<std::pair<const Type*, const Type*>,
+                     std::shared_ptr<MapType>, PairHash>
+      maps_;
+};
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_TYPE_TABLE_H_
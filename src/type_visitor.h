@@ -0,0 +1,96 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLMAN_TYPE_VISITOR_H_
+#define TOOLMAN_TYPE_VISITOR_H_
+
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "src/custom_type.h"
+#include "src/list_type.h"
+#include "src/map_type.h"
+#include "src/primitive_type.h"
+#include "src/type.h"
+
+namespace toolman {
+
+// Returns `type` as a T, or nullptr when it is of another kind. Checks
+// Type::kind() instead of going through RTTI like dynamic_cast.
+template <typename T>
+[[nodiscard]] const T* type_cast(const Type* type) {
+  return type != nullptr && type->kind() == T::kKind
+             ? static_cast<const T*>(type)
+             : nullptr;
+}
+
+template <typename T>
+[[nodiscard]] T* type_cast(Type* type) {
+  return type != nullptr && type->kind() == T::kKind ? static_cast<T*>(type)
+                                                     : nullptr;
+}
+
+template <typename T>
+[[nodiscard]] std::shared_ptr<T> type_pointer_cast(
+    const std::shared_ptr<Type>& type) {
+  return type != nullptr && type->kind() == T::kKind
+             ? std::static_pointer_cast<T>(type)
+             : nullptr;
+}
+
+// Combines lambdas into one visitor, the most specific overload wins.
+template <typename... Fs>
+struct Overloaded : Fs... {
+  using Fs::operator()...;
+};
+template <typename... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+// Calls the overload of `visitor` taking the concrete class of `type`, e.g.
+//
+//   visit_type(*type, Overloaded{
+//       [](const ListType& list) { ... },
+//       [](const auto& other) { ... }});
+//
+// Dispatch is a single switch on Type::kind(), every overload must return the
+// same type.
+template <typename Visitor>
+decltype(auto) visit_type(const Type& type, Visitor&& visitor) {
+  switch (type.kind()) {
+    case Type::Kind::Primitive:
+      return std::forward<Visitor>(visitor)(
+          static_cast<const PrimitiveType&>(type));
+    case Type::Kind::List:
+      return std::forward<Visitor>(visitor)(static_cast<const ListType&>(type));
+    case Type::Kind::Map:
+      return std::forward<Visitor>(visitor)(static_cast<const MapType&>(type));
+    case Type::Kind::Struct:
+      return std::forward<Visitor>(visitor)(
+          static_cast<const StructType&>(type));
+    case Type::Kind::Enum:
+      return std::forward<Visitor>(visitor)(static_cast<const EnumType&>(type));
+    case Type::Kind::Oneof:
+      return std::forward<Visitor>(visitor)(
+          static_cast<const OneofType&>(type));
+  }
+  throw std::logic_error("unknown type kind");
+}
+
+// Where `type` is declared, nullptr for list, map and primitive types.
+[[nodiscard]] inline const StmtInfo* declaration_of(const Type& type) {
+  return visit_type(type, [](const auto& concrete) -> const StmtInfo* {
+    using Concrete = std::decay_t<decltype(concrete)>;
+    if constexpr (std::is_base_of_v<HasStmtInfo, Concrete>) {
+      return &concrete.get_stmt_info();
+    } else {
+      return nullptr;
+    }
+  });
+}
+
+}  // namespace toolman
+
+#endif  // TOOLMAN_TYPE_VISITOR_H_
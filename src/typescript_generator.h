@@ -5,20 +5,45 @@
 #ifndef TOOLMAN_TYPESCRIPT_GENERATOR_H_
 #define TOOLMAN_TYPESCRIPT_GENERATOR_H_
 
+#include <cstddef>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "src/document.h"
 #include "src/field.h"
 #include "src/generator.h"
 #include "src/list_type.h"
 #include "src/map_type.h"
 #include "src/primitive_type.h"
+#include "src/scope.h"
 #include "src/type.h"
+#include "src/type_visitor.h"
 
 namespace toolman::generator {
 class TypescriptGenerator : public Generator {
  protected:
+  void before_generate_document(std::ostream& ostream,
+                                const Document* document) override {
+    json_codec_ = false;
+    for (const auto& opt : document->get_options()) {
+      if (opt->get_name() == buildin::option_ts_json_codec.get_name()) {
+        auto bool_opt = std::dynamic_pointer_cast<
+            decltype(buildin::option_ts_json_codec)>(opt);
+        json_codec_ = bool_opt->get_value();
+      }
+    }
+    source_ = document->get_source();
+  }
+
+  void after_generate_document(std::ostream& ostream,
+                               const Document* document) override {
+    if (json_codec_) {
+      ostream << kJsonRuntime;
+    }
+  }
+
   void after_generate_enum(std::ostream& ostream,
                            const Document* document) override {
     ostream << NL;
@@ -32,27 +57,583 @@ class TypescriptGenerator : public Generator {
   void generate_struct(
       std::ostream& ostream,
       const std::shared_ptr<StructType>& struct_type) override {
-    ostream << "export interface " << struct_type->get_name() << " {" << NL;
-    for (const auto& field : struct_type->get_fields()) {
-      generate_doc_comment(ostream, field.get_comments(), INDENT_1);
+    const auto& lowered_struct = lowered(struct_type.get());
+    ostream << "export interface " << lowered_struct.name << " {" << NL;
+    const auto& fields = struct_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      generate_doc_comment(ostream, fields[i].get_comments(), INDENT_1);
       ostream << INDENT_1;
-      generate_field(ostream, &field);
+      generate_field(ostream, fields[i], lowered_struct.fields[i]);
       ostream << NL;
     }
     ostream << "}" << NL;
+    if (json_codec_) {
+      generate_serialize(ostream, *struct_type);
+      generate_decode(ostream, *struct_type);
+    }
   }
 
   void generate_enum(std::ostream& ostream,
                      const std::shared_ptr<EnumType>& enum_type) override {
-    ostream << "export enum " << enum_type->get_name() << " {" << NL;
-    for (const auto& field : enum_type->get_fields()) {
-      ostream << INDENT_1 << field.get_name() << "=" << field.get_value() << ","
-              << NL;
+    const auto& lowered_enum = lowered(enum_type.get());
+    ostream << "export enum " << lowered_enum.name << " {" << NL;
+    const auto& fields = enum_type->get_fields();
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << INDENT_1 << lowered_enum.fields[i].name << "="
+              << fields[i].get_value() << "," << NL;
     }
     ostream << "}" << NL;
+    if (json_codec_) {
+      ostream << "export function decode" << lowered_enum.name
+              << "(json: unknown): " << lowered_enum.name << " {" << NL
+              << INDENT_1 << "if (!$isEnum(json, " << lowered_enum.name
+              << ")) {" << NL << INDENT_2 << "$decodeError(\"\", \""
+              << lowered_enum.name << "\");" << NL << INDENT_1 << "}" << NL
+              << INDENT_1 << "return json;" << NL << "}" << NL;
+    }
   }
 
  private:
+  // JSON codec, with `option ts_json_codec = true;`.
+  //
+  // serializeFoo(value) writes a Foo as JSON.stringify would, with the
+  // members in schema order, but without looking up the shape of the value:
+  // the members are known, and the JSON is concatenated from literals and
+  // the values. Primitives are type checked on the way, so that a value
+  // that does not match its type throws a TypeError naming the field
+  // instead of writing JSON no reader would accept. Optional fields that
+  // are null or undefined are left out. Enums are written as numbers,
+  // oneofs as an object of the alternative that is set, as the Go and Java
+  // codecs read them. Errors name elements `[]` and map values `{}`, the
+  // path is static.
+  //
+  // decodeFoo(json) checks that `json`, e.g. from JSON.parse, is a Foo and
+  // copies it to a new object with the members of the interface. The checks
+  // are inlined for every member, nothing walks a schema at run time. The
+  // first member that does not match its type throws a DecodeError with the
+  // path to it, e.g. `$.bars[2].ok`, built only then. Unknown members are
+  // ignored. Null or missing optional fields are left undefined; a null
+  // list or map is empty, as the Go codec writes nil ones.
+  //
+  // Structs and enums of other documents only have these functions if their
+  // document has the option too. Their structs are written by
+  // JSON.stringify and decoded as JSON.parse returned them, once checked to
+  // be objects; their enums are written and checked as 32-bit integers.
+
+  // State of the serializer while generating one function.
+  struct JsonOutput {
+    // JSON text to append before the next value, in a literal.
+    std::string pending;
+    // Whether `s`, the JSON written so far, is declared.
+    bool declared = false;
+    // Suffix of the next local.
+    std::size_t locals = 0;
+  };
+
+  void generate_serialize(std::ostream& ostream,
+                          const StructType& struct_type) const {
+    const auto& lowered_struct = lowered(&struct_type);
+    const auto& name = lowered_struct.name;
+    const auto& fields = struct_type.get_fields();
+    ostream << "export function serialize" << name << "(value: " << name
+            << "): string {" << NL << INDENT_1 << "$serializeObject(value, \""
+            << name << "\");" << NL;
+    JsonOutput output{"{"};
+    // Whether a field is written before the current one, or may be.
+    bool preceded = false;
+    bool maybe_preceded = false;
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      const auto& field = fields[i];
+      const auto& member = lowered_struct.fields[i].name;
+      auto key = "\"" + field.get_name() + "\":";
+      std::size_t level = 1;
+      if (field.is_optional()) {
+        flush_json(ostream, &output, level);
+        ostream << INDENT_1 << "if (value." << member << " != null) {" << NL;
+        ++level;
+      }
+      if (preceded) {
+        key = "," + key;
+      } else if (maybe_preceded) {
+        flush_json(ostream, &output, level);
+        ostream << indentation(level) << "if (s.length > 1) {" << NL
+                << indentation(level + 1) << "s += \",\";" << NL
+                << indentation(level) << "}" << NL;
+      }
+      output.pending += key;
+      serialize_json(ostream, field.get_type().get(), "value." + member,
+                     name + "." + member, &output, level);
+      if (field.is_optional()) {
+        flush_json(ostream, &output, level);
+        ostream << INDENT_1 << "}" << NL;
+        maybe_preceded = true;
+      } else {
+        preceded = true;
+      }
+    }
+    output.pending += "}";
+    ostream << INDENT_1 << "return ";
+    if (output.declared) {
+      ostream << "s + ";
+    }
+    ostream << js_string(output.pending) << ";" << NL << "}" << NL;
+  }
+
+  // Appends `value`, a TypeScript expression of `type`, to `s`. `path`
+  // names the value in errors.
+  void serialize_json(std::ostream& ostream, const Type* type,
+                      const std::string& value, const std::string& path,
+                      JsonOutput* output, std::size_t level) const {
+    auto indent = indentation(level);
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+      case Type::Kind::Enum:
+      case Type::Kind::Struct:
+        append_json(ostream, serialize_expression(type, value, path), output,
+                    level);
+        break;
+      case Type::Kind::List: {
+        const auto* list = static_cast<const ListType*>(type);
+        auto array = "a" + std::to_string(output->locals);
+        auto index = "i" + std::to_string(output->locals);
+        ++output->locals;
+        ostream << indent << "const " << array << " = $serializeArray("
+                << value << ", " << js_string(path) << ");" << NL;
+        output->pending += "[";
+        flush_json(ostream, output, level);
+        ostream << indent << "for (let " << index << " = 0; " << index
+                << " < " << array << ".length; " << index << "++) {" << NL
+                << indent << INDENT_1 << "if (" << index << " > 0) {" << NL
+                << indent << INDENT_2 << "s += \",\";" << NL << indent
+                << INDENT_1 << "}" << NL;
+        serialize_json(ostream, list->get_elem_type().get(),
+                       array + "[" + index + "]", path + "[]", output,
+                       level + 1);
+        flush_json(ostream, output, level + 1);
+        ostream << indent << "}" << NL;
+        output->pending = "]";
+        break;
+      }
+      case Type::Kind::Map: {
+        const auto* map = static_cast<const MapType*>(type);
+        auto object = "m" + std::to_string(output->locals);
+        auto keys = "k" + std::to_string(output->locals);
+        auto index = "i" + std::to_string(output->locals);
+        ++output->locals;
+        ostream << indent << "const " << object << " = $serializeObject("
+                << value << ", " << js_string(path) << ");" << NL;
+        output->pending += "{";
+        flush_json(ostream, output, level);
+        ostream << indent << "for (let " << index << " = 0, " << keys
+                << " = Object.keys(" << object << "); " << index << " < "
+                << keys << ".length; " << index << "++) {" << NL << indent
+                << INDENT_1 << "s += (" << index << " > 0 ? \",\" : \"\") + "
+                << "$serializeString(" << keys << "[" << index << "], "
+                << js_string(path) << ") + \":\";" << NL;
+        serialize_json(ostream, map->get_value_type().get(),
+                       object + "[" + keys + "[" + index + "]]", path + "{}",
+                       output, level + 1);
+        flush_json(ostream, output, level + 1);
+        ostream << indent << "}" << NL;
+        output->pending = "}";
+        break;
+      }
+      case Type::Kind::Oneof: {
+        const auto* oneof = static_cast<const OneofType*>(type);
+        const auto& lowered_oneof = lowered(oneof);
+        const auto& alternatives = oneof->get_fields();
+        auto object = "o" + std::to_string(output->locals);
+        ++output->locals;
+        ostream << indent << "const " << object << " = $serializeObject("
+                << value << ", " << js_string(path) << ");" << NL;
+        if (!output->declared) {
+          flush_json(ostream, output, level);
+        }
+        auto pending = output->pending;
+        std::string names;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto& member = lowered_oneof.fields[i].name;
+          ostream << (i == 0 ? indent : " else ") << "if (" << object << "."
+                  << member << " !== undefined) {" << NL;
+          output->pending =
+              pending + "{\"" + alternatives[i].get_name() + "\":";
+          serialize_json(ostream, alternatives[i].get_type().get(),
+                         object + "." + member, path + "." + member, output,
+                         level + 1);
+          flush_json(ostream, output, level + 1);
+          ostream << indent << "}";
+          names += (i == 0 ? "" : ", ") + member;
+        }
+        ostream << " else {" << NL << indent << INDENT_1
+                << "$serializeError(" << js_string(path) << ", "
+                << js_string("one of " + names) << ");" << NL << indent << "}"
+                << NL;
+        // Every alternative ends its object.
+        output->pending = "}";
+        break;
+      }
+    }
+  }
+
+  void generate_decode(std::ostream& ostream,
+                       const StructType& struct_type) const {
+    const auto& lowered_struct = lowered(&struct_type);
+    const auto& name = lowered_struct.name;
+    const auto& fields = struct_type.get_fields();
+    ostream << "export function decode" << name << "(json: unknown): " << name
+            << " {" << NL << INDENT_1 << "if (!$isObject(json)) {" << NL
+            << INDENT_2 << "$decodeError(\"\", \"object\");" << NL << INDENT_1
+            << "}" << NL;
+    std::size_t locals = 0;
+    std::vector<std::string> values;
+    for (const auto& field : fields) {
+      const auto* type = field.get_type().get();
+      auto json = "j" + std::to_string(locals++);
+      auto path = js_string("." + field.get_name());
+      ostream << INDENT_1 << "const " << json << " = json." << field.get_name()
+              << ";" << NL;
+      if (!field.is_optional()) {
+        values.push_back(
+            decode_json(ostream, type, json, path, true, 1, &locals));
+        continue;
+      }
+      auto value = "f" + std::to_string(locals++);
+      ostream << INDENT_1 << "let " << value << ": " << decoded_type(type)
+              << " | undefined;" << NL << INDENT_1 << "if (" << json
+              << " != null) {" << NL;
+      auto decoded = decode_json(ostream, type, json, path, false, 2, &locals);
+      ostream << INDENT_2 << value << " = " << decoded << ";" << NL << INDENT_1
+              << "}" << NL;
+      values.push_back(value);
+    }
+    ostream << INDENT_1 << "return {" << (fields.empty() ? "" : NL);
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+      ostream << INDENT_2 << lowered_struct.fields[i].name << ": " << values[i]
+              << "," << NL;
+    }
+    ostream << (fields.empty() ? "" : INDENT_1) << "};" << NL << "}" << NL;
+  }
+
+  // Checks `json`, a local of unknown type, and returns an expression of it
+  // decoded as `type`. `path`, an expression evaluated on errors only, is
+  // the path to it. A `nullable` null list or map is decoded as empty.
+  //
+  // The statements are written before the expression, which the caller ends.
+  [[nodiscard]] std::string decode_json(std::ostream& ostream,
+                                        const Type* type,
+                                        const std::string& json,
+                                        const std::string& path,
+                                        bool nullable, std::size_t level,
+                                        std::size_t* locals) const {
+    auto indent = indentation(level);
+    auto fail = [&](const std::string& condition,
+                    const std::string& expected) {
+      ostream << indent << "if (" << condition << ") {" << NL << indent
+              << INDENT_1 << "$decodeError(" << path << ", "
+              << js_string(expected) << ");" << NL << indent << "}" << NL;
+    };
+    auto local = [locals] { return std::to_string((*locals)++); };
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+        switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            fail("typeof " + json + " !== \"boolean\"", "boolean");
+            break;
+          case PrimitiveType::TypeKind::I32:
+            fail("!$isInt32(" + json + ")", "32-bit integer");
+            break;
+          case PrimitiveType::TypeKind::U32:
+            fail("!$isUint32(" + json + ")", "unsigned 32-bit integer");
+            break;
+          case PrimitiveType::TypeKind::I64:
+            fail("!$isInteger(" + json + ")", "integer");
+            break;
+          case PrimitiveType::TypeKind::U64:
+            fail("!$isUnsigned(" + json + ")", "unsigned integer");
+            break;
+          case PrimitiveType::TypeKind::Float:
+            fail("typeof " + json + " !== \"number\"", "number");
+            break;
+          case PrimitiveType::TypeKind::String:
+            fail("typeof " + json + " !== \"string\"", "string");
+            break;
+          case PrimitiveType::TypeKind::Any:
+            break;
+        }
+        return json;
+      case Type::Kind::Enum: {
+        const auto& name = type_to_ts_type(type);
+        if (!declared_here(type)) {
+          fail("!$isInt32(" + json + ")", "32-bit integer");
+          return json;
+        }
+        fail("!$isEnum(" + json + ", " + name + ")", name);
+        return json;
+      }
+      case Type::Kind::Struct: {
+        const auto& name = type_to_ts_type(type);
+        if (!declared_here(type)) {
+          return "$decodeForeign<" + name + ">(" + json + ", " + path + ")";
+        }
+        auto value = "s" + local();
+        // Nested decoders do not know their path, it is prefixed to theirs.
+        ostream << indent << "let " << value << ": " << name << ";" << NL
+                << indent << "try {" << NL << indent << INDENT_1 << value
+                << " = decode" << name << "(" << json << ");" << NL << indent
+                << "} catch (e) {" << NL << indent << INDENT_1
+                << "throw $decodeNested(e, " << path << ");" << NL << indent
+                << "}" << NL;
+        return value;
+      }
+      case Type::Kind::List: {
+        const auto* elem_type =
+            static_cast<const ListType*>(type)->get_elem_type().get();
+        auto suffix = local();
+        auto value = "l" + suffix;
+        auto index = "i" + suffix;
+        auto elem = "e" + suffix;
+        ostream << indent << "const " << value << ": "
+                << decoded_type(elem_type) << "[] = [];" << NL;
+        auto outer = indent;
+        if (nullable) {
+          ostream << indent << "if (" << json << " !== null) {" << NL;
+          indent = indentation(++level);
+        }
+        fail("!Array.isArray(" + json + ")", "array");
+        ostream << indent << "for (let " << index << " = 0; " << index << " < "
+                << json << ".length; " << index << "++) {" << NL << indent
+                << INDENT_1 << "const " << elem << " = " << json << "["
+                << index << "];" << NL;
+        auto elem_path = concat_js(path, "\"[\" + " + index + " + \"]\"");
+        auto elem_value = decode_json(ostream, elem_type, elem, elem_path,
+                                      true, level + 1, locals);
+        ostream << indent << INDENT_1 << value << ".push(" << elem_value
+                << ");" << NL << indent << "}" << NL;
+        if (nullable) {
+          ostream << outer << "}" << NL;
+        }
+        return value;
+      }
+      case Type::Kind::Map: {
+        const auto* map = static_cast<const MapType*>(type);
+        const auto* key_type =
+            static_cast<const PrimitiveType*>(map->get_key_type().get());
+        const auto* value_type = map->get_value_type().get();
+        auto suffix = local();
+        auto value = "m" + suffix;
+        auto key = "k" + suffix;
+        auto elem = "e" + suffix;
+        // Without a prototype, so that a member `__proto__` is a key.
+        ostream << indent << "const " << value << ": {[key: string]: "
+                << decoded_type(value_type) << "} = Object.create(null);" << NL;
+        auto outer = indent;
+        if (nullable) {
+          ostream << indent << "if (" << json << " !== null) {" << NL;
+          indent = indentation(++level);
+        }
+        fail("!$isObject(" + json + ")", "object");
+        ostream << indent << "for (const " << key << " of Object.keys(" << json
+                << ")) {" << NL << indent << INDENT_1 << "const " << elem
+                << " = " << json << "[" << key << "];" << NL;
+        auto elem_path =
+            concat_js(path, "\"[\" + JSON.stringify(" + key + ") + \"]\"");
+        auto check_key = [&](const std::string& condition,
+                             const std::string& expected) {
+          ostream << indent << INDENT_1 << "if (" << condition << ") {" << NL
+                  << indent << INDENT_2 << "$decodeError(" << elem_path << ", "
+                  << js_string(expected) << ");" << NL << indent << INDENT_1
+                  << "}" << NL;
+        };
+        auto number_key = "!$isNumberKey(" + key + ") || ";
+        switch (key_type->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            check_key(key + " !== \"true\" && " + key + " !== \"false\"",
+                      "boolean key");
+            break;
+          case PrimitiveType::TypeKind::I32:
+            check_key(number_key + "!$isInt32(+" + key + ")",
+                      "32-bit integer key");
+            break;
+          case PrimitiveType::TypeKind::U32:
+            check_key(number_key + "!$isUint32(+" + key + ")",
+                      "unsigned 32-bit integer key");
+            break;
+          case PrimitiveType::TypeKind::I64:
+            check_key(number_key + "!$isInteger(+" + key + ")", "integer key");
+            break;
+          case PrimitiveType::TypeKind::U64:
+            check_key(number_key + "!$isUnsigned(+" + key + ")",
+                      "unsigned integer key");
+            break;
+          case PrimitiveType::TypeKind::Float:
+            check_key("!$isNumberKey(" + key + ")", "number key");
+            break;
+          case PrimitiveType::TypeKind::String:
+          case PrimitiveType::TypeKind::Any:
+            break;
+        }
+        auto elem_value = decode_json(ostream, value_type, elem, elem_path,
+                                      true, level + 1, locals);
+        ostream << indent << INDENT_1 << value << "[" << key
+                << "] = " << elem_value << ";" << NL << indent << "}" << NL;
+        if (nullable) {
+          ostream << outer << "}" << NL;
+        }
+        return value;
+      }
+      case Type::Kind::Oneof: {
+        const auto* oneof = static_cast<const OneofType*>(type);
+        const auto& lowered_oneof = lowered(oneof);
+        const auto& alternatives = oneof->get_fields();
+        auto suffix = local();
+        auto value = "u" + suffix;
+        auto keys = "k" + suffix;
+        auto elem = "e" + suffix;
+        std::string names;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          names += (i == 0 ? "" : ", ") + alternatives[i].get_name();
+        }
+        auto expected = "one of " + names;
+        ostream << indent << "let " << value << ": " << decoded_type(type)
+                << ";" << NL;
+        fail("!$isObject(" + json + ")", "object");
+        ostream << indent << "const " << keys << " = Object.keys(" << json
+                << ");" << NL;
+        fail(keys + ".length !== 1", expected);
+        ostream << indent << "switch (" << keys << "[0]) {" << NL;
+        for (std::size_t i = 0; i < alternatives.size(); ++i) {
+          const auto& alternative = alternatives[i].get_name();
+          ostream << indent << INDENT_1 << "case " << js_string(alternative)
+                  << ": {" << NL << indent << INDENT_2 << "const " << elem
+                  << " = " << json << "." << alternative << ";" << NL;
+          auto alternative_value = decode_json(
+              ostream, alternatives[i].get_type().get(), elem,
+              concat_js(path, js_string("." + alternative)), true, level + 2,
+              locals);
+          ostream << indent << INDENT_2 << value << " = {"
+                  << lowered_oneof.fields[i].name << ": " << alternative_value
+                  << "};" << NL << indent << INDENT_2 << "break;" << NL
+                  << indent << INDENT_1 << "}" << NL;
+        }
+        ostream << indent << INDENT_1 << "default:" << NL << indent << INDENT_2
+                << "$decodeError(" << path << ", " << js_string(expected)
+                << ");" << NL << indent << "}" << NL;
+        return value;
+      }
+    }
+    return json;
+  }
+
+  // The TypeScript type of a decoded value of `type`.
+  [[nodiscard]] std::string decoded_type(const Type* type) const {
+    if (const auto* oneof = type_cast<OneofType>(type)) {
+      std::ostringstream union_type;
+      union_type << "(";
+      generate_oneof(union_type, oneof);
+      union_type << ")";
+      return union_type.str();
+    }
+    return type_to_ts_type(type);
+  }
+
+  // `left + right`, two expressions, merging adjacent string literals.
+  [[nodiscard]] static std::string concat_js(const std::string& left,
+                                             const std::string& right) {
+    if (!left.empty() && left.back() == '"' && right.front() == '"') {
+      return left.substr(0, left.size() - 1) + right.substr(1);
+    }
+    return left + " + " + right;
+  }
+
+  // An expression of the JSON of `value`, of a type without members.
+  [[nodiscard]] std::string serialize_expression(
+      const Type* type, const std::string& value,
+      const std::string& path) const {
+    auto arguments = value + ", " + js_string(path) + ")";
+    if (type->is_enum()) {
+      if (!declared_here(type)) {
+        return "$serializeInt32(" + arguments;
+      }
+      return "$serializeEnum(" + value + ", " + type_to_ts_type(type) + ", " +
+             js_string(path) + ")";
+    } else if (type->is_struct()) {
+      if (!declared_here(type)) {
+        return "$serializeForeign(" + arguments;
+      }
+      return "serialize" + type_to_ts_type(type) + "(" + value + ")";
+    }
+    switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+      case PrimitiveType::TypeKind::Bool:
+        return "$serializeBoolean(" + arguments;
+      case PrimitiveType::TypeKind::I32:
+        return "$serializeInt32(" + arguments;
+      case PrimitiveType::TypeKind::U32:
+        return "$serializeUint32(" + arguments;
+      case PrimitiveType::TypeKind::I64:
+        return "$serializeInt64(" + arguments;
+      case PrimitiveType::TypeKind::U64:
+        return "$serializeUint64(" + arguments;
+      case PrimitiveType::TypeKind::Float:
+        return "$serializeFloat(" + arguments;
+      case PrimitiveType::TypeKind::String:
+        return "$serializeString(" + arguments;
+      case PrimitiveType::TypeKind::Any:
+        return "$serializeAny(" + value + ")";
+    }
+    return "";
+  }
+
+  // Appends the pending JSON text and `expression` to `s`.
+  static void append_json(std::ostream& ostream, const std::string& expression,
+                          JsonOutput* output, std::size_t level) {
+    ostream << indentation(level) << (output->declared ? "s += " : "let s = ");
+    if (!output->pending.empty()) {
+      ostream << js_string(output->pending) << " + ";
+    }
+    ostream << expression << ";" << NL;
+    output->pending.clear();
+    output->declared = true;
+  }
+
+  // Appends the pending JSON text to `s`, declaring it if needed.
+  static void flush_json(std::ostream& ostream, JsonOutput* output,
+                         std::size_t level) {
+    if (output->pending.empty()) {
+      return;
+    }
+    ostream << indentation(level) << (output->declared ? "s += " : "let s = ")
+            << js_string(output->pending) << ";" << NL;
+    output->pending.clear();
+    output->declared = true;
+  }
+
+  // A string literal of `text`, JSON punctuation and field names.
+  [[nodiscard]] static std::string js_string(const std::string& text) {
+    std::string literal = "\"";
+    for (auto c : text) {
+      if (c == '"' || c == '\\') {
+        literal.push_back('\\');
+      }
+      literal.push_back(c);
+    }
+    return literal + "\"";
+  }
+
+  // Whether the struct or enum `type` is declared in the document being
+  // generated, and so has the functions of the codec.
+  [[nodiscard]] bool declared_here(const Type* type) const {
+    auto source = declaration_of(*type)->get_source();
+    return source == source_ || (source && source_ && *source == *source_);
+  }
+
+  [[nodiscard]] static std::string indentation(std::size_t level) {
+    std::string indent;
+    for (std::size_t i = 0; i < level; ++i) {
+      indent += INDENT_1;
+    }
+    return indent;
+  }
+
   void generate_doc_comment(std::ostream& ostream,
                             std::vector<std::string> comments,
                             std::string indent) {
@@ -66,54 +647,212 @@ class TypescriptGenerator : public Generator {
     ostream << indent << "*/" << NL;
   }
 
-  void generate_field(std::ostream& ostream, const Field* field) const {
-    ostream << field->get_name();
-    if (field->is_optional()) {
+  void generate_field(std::ostream& ostream, const Field& field,
+                      const LoweredField& lowered_field) const {
+    ostream << lowered_field.name;
+    if (field.is_optional()) {
       ostream << "?";
     }
     ostream << ": ";
-    if (field->get_type()->is_oneof()) {
-      auto oneof = std::dynamic_pointer_cast<OneofType>(field->get_type());
-      auto oneof_fields = oneof->get_fields();
-      for (auto it = oneof_fields.begin(); it != oneof_fields.end(); ++it) {
-        ostream << "{ ";
-        generate_field(ostream, &(*it));
-        ostream << " }";
-        if (it != (oneof_fields.end() - 1)) {
-          ostream << " | ";
-        }
-      }
+    if (const auto* oneof = type_cast<OneofType>(field.get_type().get())) {
+      generate_oneof(ostream, oneof);
     } else {
-      ostream << type_to_ts_type(field->get_type().get());
+      ostream << type_to_ts_type(field.get_type().get());
     }
     ostream << ";";
   }
 
-  [[nodiscard]] static std::string type_to_ts_type(Type* type) {
-    if (type->is_primitive()) {
-      auto primitive = dynamic_cast<PrimitiveType*>(type);
-      if (primitive->is_bool()) {
-        return "boolean";
-      } else if (primitive->is_numeric()) {
-        return "number";
-      } else if (primitive->is_string()) {
-        return "string";
-      } else if (primitive->is_any()) {
-        return "any";
-      }
-    } else if (type->is_struct() || type->is_enum()) {
-      return type->get_name();
-    } else if (type->is_map()) {
-      auto map = dynamic_cast<MapType*>(type);
-      return "{[key: " + type_to_ts_type(map->get_key_type().get()) +
-             "]: " + type_to_ts_type(map->get_value_type().get()) + ";}";
-    } else if (type->is_list()) {
-      auto list = dynamic_cast<ListType*>(type);
-      return "{[index: number]: " +
-             type_to_ts_type(list->get_elem_type().get()) + ";}";
+  void generate_oneof(std::ostream& ostream, const OneofType* oneof) const {
+    const auto& lowered_oneof = lowered(oneof);
+    const auto& alternatives = oneof->get_fields();
+    for (std::size_t i = 0; i < alternatives.size(); ++i) {
+      if (i > 0) {
+        ostream << " | ";
+      }
+      ostream << "{ ";
+      generate_field(ostream, alternatives[i], lowered_oneof.fields[i]);
+      ostream << " }";
+    }
+  }
+
+  [[nodiscard]] const std::string& type_to_ts_type(const Type* type) const {
+    return render(type);
+  }
+
+  [[nodiscard]] std::string render_type(const Type* type,
+                                        unsigned flags) const override {
+    switch (type->kind()) {
+      case Type::Kind::Primitive:
+        switch (static_cast<const PrimitiveType*>(type)->get_type_kind()) {
+          case PrimitiveType::TypeKind::Bool:
+            return "boolean";
+          case PrimitiveType::TypeKind::I32:
+          case PrimitiveType::TypeKind::U32:
+          case PrimitiveType::TypeKind::I64:
+          case PrimitiveType::TypeKind::U64:
+          case PrimitiveType::TypeKind::Float:
+            return "number";
+          case PrimitiveType::TypeKind::String:
+            return "string";
+          case PrimitiveType::TypeKind::Any:
+            return "any";
+        }
+        break;
+      case Type::Kind::Struct:
+      case Type::Kind::Enum:
+        return type->get_name();
+      case Type::Kind::Map: {
+        auto map = static_cast<const MapType*>(type);
+        return "{[key: " + type_to_ts_type(map->get_key_type().get()) +
+               "]: " + type_to_ts_type(map->get_value_type().get()) + ";}";
+      }
+      case Type::Kind::List: {
+        auto list = static_cast<const ListType*>(type);
+        return "{[index: number]: " +
+               type_to_ts_type(list->get_elem_type().get()) + ";}";
+      }
+      case Type::Kind::Oneof:
+        break;
     }
     return "";
   }
+
+  // Functions used by the generated ones, emitted at the end of the
+  // document. The serializers take `any` as they check the type themselves,
+  // the predicates of the decoders narrow `unknown`.
+  static constexpr char kJsonRuntime[] = R"ts(// JSON codec runtime.
+function $serializeError(path: string, expected: string): never {
+    throw new TypeError(path + ": expected " + expected);
+}
+function $serializeObject(value: any, path: string): {[key: string]: any} {
+    if (typeof value !== "object" || value === null || Array.isArray(value)) {
+        $serializeError(path, "object");
+    }
+    return value;
+}
+function $serializeArray(value: any, path: string): any[] {
+    if (!Array.isArray(value)) {
+        $serializeError(path, "array");
+    }
+    return value;
+}
+function $serializeBoolean(value: any, path: string): string {
+    if (typeof value !== "boolean") {
+        $serializeError(path, "boolean");
+    }
+    return value ? "true" : "false";
+}
+function $serializeInt32(value: any, path: string): string {
+    if ((value | 0) !== value) {
+        $serializeError(path, "32-bit integer");
+    }
+    return "" + value;
+}
+function $serializeUint32(value: any, path: string): string {
+    if (value >>> 0 !== value) {
+        $serializeError(path, "unsigned 32-bit integer");
+    }
+    return "" + value;
+}
+function $serializeInt64(value: any, path: string): string {
+    if (!Number.isInteger(value)) {
+        $serializeError(path, "integer");
+    }
+    return "" + value;
+}
+function $serializeUint64(value: any, path: string): string {
+    if (!Number.isInteger(value) || value < 0) {
+        $serializeError(path, "unsigned integer");
+    }
+    return "" + value;
+}
+function $serializeFloat(value: any, path: string): string {
+    if (!Number.isFinite(value)) {
+        $serializeError(path, "finite number");
+    }
+    return "" + value;
+}
+// Most strings need no escapes, quoting them is faster than JSON.stringify.
+const $serializeEscapes = /["\\\u0000-\u001f\ud800-\udfff]/;
+function $serializeString(value: any, path: string): string {
+    if (typeof value !== "string") {
+        $serializeError(path, "string");
+    }
+    if ($serializeEscapes.test(value)) {
+        return JSON.stringify(value);
+    }
+    return "\"" + value + "\"";
+}
+function $serializeEnum(value: any, names: {[value: number]: string},
+                        path: string): string {
+    if (typeof value !== "number" || typeof names[value] !== "string") {
+        $serializeError(path, "enum value");
+    }
+    return "" + value;
+}
+function $serializeForeign(value: any, path: string): string {
+    return JSON.stringify($serializeObject(value, path));
+}
+function $serializeAny(value: any): string {
+    const json = JSON.stringify(value);
+    return json === undefined ? "null" : json;
+}
+// Thrown by the decoders at the first value that is not of its type.
+export class DecodeError extends Error {
+    // From the decoded value, `$`, e.g. `$.bars[2].ok`.
+    path: string;
+    expected: string;
+    constructor(path: string, expected: string) {
+        super(path + ": expected " + expected);
+        this.name = "DecodeError";
+        this.path = path;
+        this.expected = expected;
+    }
+}
+function $decodeError(path: string, expected: string): never {
+    throw new DecodeError("$" + path, expected);
+}
+// Prefixes `path` to the one of an error thrown by a nested decoder.
+function $decodeNested(error: unknown, path: string): unknown {
+    if (error instanceof DecodeError) {
+        error.path = "$" + path + error.path.slice(1);
+        error.message = error.path + ": expected " + error.expected;
+    }
+    return error;
+}
+function $decodeForeign<T>(json: unknown, path: string): T {
+    if (!$isObject(json)) {
+        $decodeError(path, "object");
+    }
+    return json as unknown as T;
+}
+function $isObject(value: unknown): value is {[key: string]: unknown} {
+    return typeof value === "object" && value !== null && !Array.isArray(value);
+}
+function $isInt32(value: unknown): value is number {
+    return typeof value === "number" && (value | 0) === value;
+}
+function $isUint32(value: unknown): value is number {
+    return typeof value === "number" && value >>> 0 === value;
+}
+function $isInteger(value: unknown): value is number {
+    return Number.isInteger(value);
+}
+function $isUnsigned(value: unknown): value is number {
+    return Number.isInteger(value) && (value as number) >= 0;
+}
+function $isEnum(value: unknown, names: {[value: number]: string}):
+    value is number {
+    return typeof value === "number" && typeof names[value] === "string";
+}
+// Map keys are numbers as JavaScript writes them.
+function $isNumberKey(key: string): boolean {
+    return "" + +key === key;
+}
+)ts";
+
+  bool json_codec_ = false;
+  std::shared_ptr<std::filesystem::path> source_;
 };
 }  // namespace toolman::generator
 
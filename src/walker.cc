@@ -16,17 +16,15 @@ void DeclPhaseWalker::enterImportStatement(
   import_builder_.start_import(str_lit.substr(1, str_lit.length() - 2));
 }
 
-void DeclPhaseWalker::exitImportStatement(
-    ToolmanParser::ImportStatementContext *node) {
-  import_builder_.end_import();
-
+void declare_imports(const Import &import, Compiler *compiler,
+                     TypeScope *type_scope, HasMultiError *errors) {
   // import regular imports.
-  for (auto const &[filename, import_names] : import().get_regular_imports()) {
+  for (auto const &[filename, import_names] : import.get_regular_imports()) {
     std::shared_ptr<Module> module;
     try {
-      module = compiler()->compile_module(filename);
+      module = compiler->compile_module(filename);
     } catch (FileNotFoundError &e) {
-      push_error(UnresolvedImportError(filename));
+      errors->push_error(UnresolvedImportError(filename));
       continue;
     }
 
@@ -35,36 +33,36 @@ void DeclPhaseWalker::exitImportStatement(
               module->type_scope()->lookup(import_name.original_name);
           import_type.has_value()) {
         if (import_name.local_name.has_value()) {
-          type_scope_->declare(import_type.value(),
-                               import_name.local_name.value());
+          type_scope->declare(import_type.value(),
+                              import_name.local_name.value());
         } else {
-          type_scope_->declare(import_type.value());
+          type_scope->declare(import_type.value());
         }
       } else {
-        push_error(ImportError(import_name.original_name, filename));
+        errors->push_error(ImportError(import_name.original_name, filename));
       }
     }
   }
 
   // import namespace.
-  for (auto const &filename : import().get_namespaces_imports()) {
+  for (auto const &filename : import.get_namespaces_imports()) {
     std::shared_ptr<Module> module;
     try {
-      module = compiler()->compile_module(filename);
+      module = compiler->compile_module(filename);
     } catch (FileNotFoundError &e) {
-      push_error(UnresolvedImportError(filename));
+      errors->push_error(UnresolvedImportError(filename));
       continue;
     }
-    for (auto it = module->type_scope()->cbegin();
-         it != module->type_scope()->cend(); it++) {
-      type_scope_->declare(it->second, it->first);
-    }
-    //    for (auto const&[name, type] : *module->type_scope()) {
-    //        type_scope_->declare(type, name);
-    //    }
+    type_scope->link(module->type_scope());
   }
 }
 
+void DeclPhaseWalker::exitImportStatement(
+    ToolmanParser::ImportStatementContext *node) {
+  import_builder_.end_import();
+  declare_imports(import(), compiler(), type_scope_.get(), this);
+}
+
 void DeclPhaseWalker::enterFromImport(ToolmanParser::FromImportContext *node) {
   import_builder_.set_import_star(false);
 }
@@ -83,47 +81,62 @@ void DeclPhaseWalker::enterImportNameAlias(
   import_builder_.start_import_name_alias(node->identifierName()->getText());
 }
 
-void FieldTypeBuilder::start_type(const std::shared_ptr<Type> &type) {
-  if (!type_stack_.empty()) {
-    if (type_stack_.top()->is_list()) {
-      if (TypeLocation::ListElement == current_type_location_) {
-        auto list_type = std::dynamic_pointer_cast<ListType>(type_stack_.top());
-        list_type->set_elem_type(type);
-      }
-
-    } else if (type_stack_.top()->is_map()) {
-      auto map_type = std::dynamic_pointer_cast<MapType>(type_stack_.top());
-
-      if (TypeLocation::MapKey == current_type_location_) {
-        // The key of the map must be a primitive type.
-        if (!type->is_primitive()) {
-          throw MapKeyTypeMustBePrimitiveError(type);
-        } else {
-          map_type->set_key_type(
-              std::dynamic_pointer_cast<PrimitiveType>(type));
-        }
-      } else if (TypeLocation::MapValue == current_type_location_) {
-        map_type->set_value_type(type);
-      }
-    }
-  }
+void FieldTypeBuilder::start_map_or_list_type(Type::Kind kind) {
+  type_stack_.push(PendingType{kind, current_type_location_, nullptr, nullptr});
+}
 
-  if (type->is_map() || type->is_list()) {
-    type_stack_.push(type);
-  } else {
+void FieldTypeBuilder::start_type(const std::shared_ptr<Type> &type) {
+  if (type_stack_.empty()) {
     current_single_type_ = type;
+  } else {
+    set_element_type(current_type_location_, type);
   }
 }
 
 std::shared_ptr<Type> FieldTypeBuilder::end_map_or_list_type() {
-  auto top = type_stack_.top();
+  auto pending = std::move(type_stack_.top());
   type_stack_.pop();
+
+  // A missing element type has been reported already, e.g. an unknown
+  // custom type, the enclosing types are left incomplete as well.
+  std::shared_ptr<Type> type;
+  if (pending.kind == Type::Kind::List) {
+    if (pending.value_type) {
+      type = type_table_->list(pending.value_type);
+    }
+  } else if (pending.key_type && pending.value_type) {
+    // The key of the map must be a primitive type.
+    if (!pending.key_type->is_primitive()) {
+      throw MapKeyTypeMustBePrimitiveError(pending.key_type);
+    }
+    type = type_table_->map(
+        std::static_pointer_cast<PrimitiveType>(pending.key_type),
+        pending.value_type);
+  }
+
   if (type_stack_.empty()) {
-    return top;
+    return type;
   }
+  set_element_type(pending.location, type);
   return std::shared_ptr<Type>(nullptr);
 }
 
+void FieldTypeBuilder::set_element_type(TypeLocation location,
+                                        const std::shared_ptr<Type> &type) {
+  auto &top = type_stack_.top();
+  switch (location) {
+    case TypeLocation::ListElement:
+    case TypeLocation::MapValue:
+      top.value_type = type;
+      break;
+    case TypeLocation::MapKey:
+      top.key_type = type;
+      break;
+    case TypeLocation::Top:
+      break;
+  }
+}
+
 std::shared_ptr<Type> FieldTypeBuilder::end_single_type() {
   if (type_stack_.empty()) {
     return current_single_type_;
@@ -23,18 +23,35 @@
 #include "src/list_type.h"
 #include "src/map_type.h"
 #include "src/scope.h"
+#include "src/type_table.h"
+#include "src/type_visitor.h"
 
 namespace toolman {
 
 class Compiler;
 
+// Compiles the modules of `import` through `compiler` and declares the
+// imported types into `type_scope`. Unresolved modules and names are pushed
+// to `errors`.
+void declare_imports(const Import& import, Compiler* compiler,
+                     TypeScope* type_scope, HasMultiError* errors);
+
+// Columns of `token` within its line.
+inline std::pair<unsigned int, unsigned int> token_columns(
+    const antlr4::Token& token) {
+  auto start = static_cast<unsigned int>(token.getCharPositionInLine());
+  auto length =
+      static_cast<unsigned int>(token.getStopIndex() - token.getStartIndex());
+  return {start, start + length + 1};
+}
+
+// Lines of `node` and columns of its first token.
 template <typename NODE, typename SOURCE>
 StmtInfo get_stmt_info(NODE* node, SOURCE&& source) {
   auto id_start_token = node->getStart();
-  return StmtInfo(
-      {id_start_token->getLine(), node->getStop()->getLine()},
-      {id_start_token->getStartIndex(), id_start_token->getStopIndex()},
-      std::forward<SOURCE>(source));
+  return StmtInfo({id_start_token->getLine(), node->getStop()->getLine()},
+                  token_columns(*id_start_token),
+                  std::forward<SOURCE>(source));
 }
 
 class ImportBuilder {
@@ -45,7 +62,8 @@ class ImportBuilder {
 
   void end_import() {
     if (current_import_name_.has_value()) {
-      current_import_names_.push_back(current_import_name_.value());
+      current_import_names_.push_back(std::move(*current_import_name_));
+      current_import_name_.reset();
     }
     if (is_star_) {
       import_.add_import_star(current_filename_);
@@ -57,17 +75,18 @@ class ImportBuilder {
 
   void start_import_name(std::string import_name) {
     if (current_import_name_.has_value()) {
-      current_import_names_.push_back(current_import_name_.value());
+      current_import_names_.push_back(std::move(*current_import_name_));
     }
-    current_import_name_ = std::make_optional<ImportName>(
+    current_import_name_.emplace(
         ImportName{std::move(import_name), std::nullopt});
   }
 
   void start_import_name_alias(std::string alias_name) {
-    current_import_name_.value().original_name = std::move(alias_name);
+    current_import_name_.value().local_name = std::move(alias_name);
   }
 
-  Import import() { return std::move(import_); }
+  // Takes the imports collected so far.
+  Import import() { return std::exchange(import_, Import()); }
 
   void set_import_star(bool is_star) { is_star_ = is_star; }
 
@@ -130,11 +149,11 @@ class DeclPhaseWalker final : public ToolmanParserBaseListener,
     StmtInfo stmt_info = get_stmt_info(node->identifierName(), source_);
     if (auto search = type_scope_->lookup(node->identifierName()->getText());
         search.has_value()) {
-      push_error(DuplicateTypeDeclError(search.value(), stmt_info));
+      push_error(DuplicateTypeDeclError(search.value(), std::move(stmt_info)));
       return;
     } else {
       type_scope_->declare(std::make_shared<DECL_TYPE>(
-          DECL_TYPE(node->identifierName()->getText(), stmt_info)));
+          node->identifierName()->getText(), std::move(stmt_info)));
     }
   }
 
@@ -147,14 +166,22 @@ class DeclPhaseWalker final : public ToolmanParserBaseListener,
   Compiler* compiler_;
 };
 
+// Builds field types bottom-up: a list or map is interned in the TypeTable
+// once its element types are known.
 class FieldTypeBuilder {
  public:
   enum class TypeLocation : char { Top, ListElement, MapKey, MapValue };
 
+  explicit FieldTypeBuilder(TypeTable* type_table) : type_table_(type_table) {}
+
   void set_type_location(TypeLocation type_location) {
     current_type_location_ = type_location;
   }
 
+  // Opens a list or map, its element types follow.
+  void start_map_or_list_type(Type::Kind kind);
+
+  // Any type besides map and list.
   void start_type(const std::shared_ptr<Type>& type);
 
   // If return value is not null-pointer
@@ -167,7 +194,22 @@ class FieldTypeBuilder {
   std::shared_ptr<Type> end_single_type();
 
  private:
-  std::stack<std::shared_ptr<Type>> type_stack_;
+  // A list or map whose element types are being built.
+  struct PendingType {
+    Type::Kind kind;
+    // Where the type goes in the enclosing one.
+    TypeLocation location;
+    // The key of a map.
+    std::shared_ptr<Type> key_type;
+    // The element of a list or the value of a map.
+    std::shared_ptr<Type> value_type;
+  };
+
+  void set_element_type(TypeLocation location,
+                        const std::shared_ptr<Type>& type);
+
+  TypeTable* type_table_;
+  std::stack<PendingType> type_stack_;
   std::shared_ptr<Type> current_single_type_;
   TypeLocation current_type_location_ = TypeLocation::Top;
 };
@@ -182,26 +224,33 @@ class CustomTypeBuilder {
   }
 
   [[nodiscard]] std::shared_ptr<CustomType<FIELD>> end_custom_type() {
-    auto ret = current_custom_type_;
-    current_custom_type_.reset();
-    return ret;
+    return std::exchange(current_custom_type_, nullptr);
   }
 
-  void start_field(FIELD field) {
-    current_field_ = std::optional<FIELD>(std::move(field));
+  [[nodiscard]] const std::shared_ptr<CustomType<FIELD>>& current_custom_type()
+      const {
+    return current_custom_type_;
+  }
+
+  // Constructs the current field in place from `args`, the arguments of a
+  // FIELD constructor or a FIELD to move from.
+  template <typename... Args>
+  void start_field(Args&&... args) {
+    current_field_.emplace(std::forward<Args>(args)...);
   }
 
   void clear_current_field() { current_field_ = std::nullopt; }
 
+  // Moves the current field into the current custom type. Throws
+  // DuplicateFieldDeclError if the type has a field of the same name.
   void end_field() {
     if (current_field_.has_value()) {
-      if (!current_custom_type_->append_field(current_field_.value())) {
-        auto current_field = current_field_.value();
-        throw DuplicateFieldDeclError(
-            current_custom_type_->get_field_by_name(current_field.get_name())
-                .value(),
-            current_field.get_stmt_info());
+      if (const auto* first = current_custom_type_->get_field_by_name(
+              current_field_->get_name());
+          first != nullptr) {
+        throw DuplicateFieldDeclError(*first, current_field_->get_stmt_info());
       }
+      current_custom_type_->append_field(std::move(*current_field_));
       clear_current_field();
     }
   }
@@ -235,12 +284,16 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
  public:
   enum class BuildState : char { IN_STRUCT, IN_ONEOF, RECURSIVE_ONFOF };
 
+  // Field types are interned in `type_table`, which must outlive the walker.
   RefPhaseWalker(std::shared_ptr<TypeScope> type_scope,
                  std::shared_ptr<OptionScope> option_scope,
-                 std::shared_ptr<std::filesystem::path> source)
+                 std::shared_ptr<std::filesystem::path> source,
+                 TypeTable* type_table)
       : type_scope_(std::move(type_scope)),
         option_scope_(std::move(option_scope)),
         source_(std::move(source)),
+        type_table_(type_table),
+        field_type_builder_(type_table),
         enum_builder_(),
         build_state_(BuildState::IN_STRUCT) {}
   std::unique_ptr<Document> get_document() {
@@ -292,18 +345,18 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
       // Logically, this situation will not happen
       throw std::runtime_error("The type name`" + type_name + "` not found.");
     }
-    auto search = std::dynamic_pointer_cast<StructType>(search_opt.value());
+    auto search = type_pointer_cast<StructType>(search_opt.value());
     if (!search) {
       // Logically, this situation will not happen
       throw std::runtime_error("The type name`" + type_name + "` is " +
-                               search->to_string());
+                               search_opt.value()->to_string());
     }
     build_state_ = BuildState::IN_STRUCT;
     struct_builder_.start_custom_type(search);
   }
 
   void exitStructDecl(ToolmanParser::StructDeclContext* node) override {
-    document_->insert_struct_type(std::dynamic_pointer_cast<StructType>(
+    document_->insert_struct_type(std::static_pointer_cast<StructType>(
         struct_builder_.end_custom_type()));
   }
 
@@ -312,13 +365,14 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
     for (auto& dc : node->DocumentComment()) {
       comments.push_back(dc->getText().substr(3));
     }
-    auto field = Field(node->identifierName()->getText(),
-                       get_stmt_info(node, source_), comments);
-
     if (build_state_ == BuildState::IN_STRUCT) {
-      struct_builder_.start_field(field);
+      struct_builder_.start_field(node->identifierName()->getText(),
+                                  get_stmt_info(node, source_),
+                                  std::move(comments));
     } else if (build_state_ == BuildState::IN_ONEOF) {
-      oneof_builder_.start_field(field);
+      oneof_builder_.start_field(node->identifierName()->getText(),
+                                 get_stmt_info(node, source_),
+                                 std::move(comments));
     }
   }
 
@@ -342,9 +396,8 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
     field_type_builder_.set_type_location(FieldTypeBuilder::TypeLocation::Top);
   }
 
-  void enterListType(ToolmanParser::ListTypeContext* node) override {
-    field_type_builder_.start_type(
-        std::make_shared<ListType>(ListType(get_stmt_info(node, source_))));
+  void enterListType(ToolmanParser::ListTypeContext*) override {
+    field_type_builder_.start_map_or_list_type(Type::Kind::List);
   }
 
   void exitListType(ToolmanParser::ListTypeContext*) override {
@@ -362,17 +415,18 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
         FieldTypeBuilder::TypeLocation::ListElement);
   }
 
-  void enterMapType(ToolmanParser::MapTypeContext* node) override {
+  void enterMapType(ToolmanParser::MapTypeContext*) override {
+    field_type_builder_.start_map_or_list_type(Type::Kind::Map);
+  }
+
+  void exitMapType(ToolmanParser::MapTypeContext*) override {
+    std::shared_ptr<Type> type;
     try {
-      field_type_builder_.start_type(
-          std::make_shared<MapType>(MapType(get_stmt_info(node, source_))));
+      type = field_type_builder_.end_map_or_list_type();
     } catch (MapKeyTypeMustBePrimitiveError& e) {
       push_error(e);
     }
-  }
-
-  void exitMapType(ToolmanParser::MapTypeContext*) override {
-    if (auto type = field_type_builder_.end_map_or_list_type(); type) {
+    if (type) {
       if (build_state_ == BuildState::IN_STRUCT) {
         struct_builder_.set_current_field_type(type);
       } else if (build_state_ == BuildState::IN_ONEOF) {
@@ -409,8 +463,7 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
     } else {
       type_kind = PrimitiveType::TypeKind::Any;
     }
-    field_type_builder_.start_type(std::make_shared<PrimitiveType>(
-        PrimitiveType(type_kind, get_stmt_info(node, source_))));
+    field_type_builder_.start_type(type_table_->primitive(type_kind));
   }
 
   void exitPrimitiveType(ToolmanParser::PrimitiveTypeContext*) override {
@@ -451,18 +504,18 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
       // Logically, this situation will not happen
       throw std::runtime_error("The type name`" + type_name + "` not found.");
     }
-    auto search = std::dynamic_pointer_cast<EnumType>(search_opt.value());
+    auto search = type_pointer_cast<EnumType>(search_opt.value());
     if (!search) {
       // Logically, this situation will not happen
       throw std::runtime_error("The type name`" + type_name + "` is " +
-                               search->to_string());
+                               search_opt.value()->to_string());
     }
     enum_builder_.start_custom_type(search);
   }
 
   void exitEnumDecl(ToolmanParser::EnumDeclContext*) override {
     document_->insert_enum_type(
-        std::dynamic_pointer_cast<EnumType>(enum_builder_.end_custom_type()));
+        std::static_pointer_cast<EnumType>(enum_builder_.end_custom_type()));
   }
 
   void enterEnumField(ToolmanParser::EnumFieldContext* node) override {
@@ -470,17 +523,21 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
     for (auto& dc : node->DocumentComment()) {
       comments.push_back(dc->getText().substr(3));
     }
-    auto enum_field = EnumField(node->identifierName()->getText(),
-                                get_stmt_info(node, source_), comments);
-
     auto value = std::stoi(node->intgerLiteral()->getText());
-    if (!enum_field.set_value(value)) {
-      push_error(
-          DuplicateEnumFieldValueError(EnumField::get_by_value(value).value(),
-                                       get_stmt_info(node, source_)));
+    // Values only have to be unique within their enum.
+    const auto* enum_type = static_cast<const EnumType*>(
+        enum_builder_.current_custom_type().get());
+    if (const auto* first = enum_type->get_field_by_value(value);
+        first != nullptr) {
+      push_error(DuplicateEnumFieldValueError(*first,
+                                              get_stmt_info(node, source_)));
       return;
     }
-    enum_builder_.start_field(enum_field);
+    auto enum_field = EnumField(node->identifierName()->getText(),
+                                get_stmt_info(node, source_),
+                                std::move(comments));
+    enum_field.set_value(value);
+    enum_builder_.start_field(std::move(enum_field));
   }
 
   void exitEnumField(ToolmanParser::EnumFieldContext* node) override {
@@ -499,7 +556,7 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
     }
     build_state_ = BuildState::IN_ONEOF;
     oneof_builder_.start_custom_type(
-        std::make_shared<OneofType>(OneofType(get_stmt_info(node, source_))));
+        std::make_shared<OneofType>(get_stmt_info(node, source_)));
   }
 
   void exitOneofType(ToolmanParser::OneofTypeContext*) override {
@@ -518,6 +575,7 @@ class RefPhaseWalker final : public ToolmanParserBaseListener,
   std::shared_ptr<TypeScope> type_scope_;
   std::shared_ptr<OptionScope> option_scope_;
   std::shared_ptr<std::filesystem::path> source_;
+  TypeTable* type_table_;
   BuildState build_state_;
 };
 
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+# Copyright 2020 the Toolman project authors. All rights reserved.
+# Use of this source code is governed by a MIT license that can be
+# found in the LICENSE file.
+
+"""Benchmarks the toolman executable on generated fixtures.
+
+Each case writes its fixture, which only depends on the case, and times
+whole toolman runs on it. With --baseline, another toolman build is timed on
+the same fixture for a before and after comparison.
+
+    test/bench.py warm-start build/src/toolman [--baseline old/toolman]
+    test/bench.py warm-start build/src/toolman --fixture /tmp/warm-start
+
+Cases:
+  warm-start  latency of compiling the first file of a run, without the
+              compile cache, on a compile cache miss and on a hit; the run
+              without the cache is the number from before the cache
+  small-files throughput of compiling a schema that imports 300 small
+              modules, which import each other
+  deep-schema time of the ref-walk and generate phases per target on 200
+              structs whose fields nest lists and maps 12 levels deep
+"""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def write(directory, name, lines):
+    with open(os.path.join(directory, name), "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def struct(name, fields):
+    lines = ["type %s struct {" % name]
+    for i, (field, field_type) in enumerate(fields):
+        lines.append("  /// %s of %s" % (field, name))
+        comma = "," if i < len(fields) - 1 else ""
+        lines.append("  %s: %s%s" % (field, field_type, comma))
+    lines.append("}")
+    return lines
+
+
+def warm_start_fixture(directory):
+    """A service schema of 60 structs importing three modules."""
+    modules = ("common", "users", "billing")
+    for m, module in enumerate(modules):
+        lines = []
+        if m > 0:
+            lines.append("from \"%s.tm\" import *;" % modules[m - 1])
+        for i in range(15):
+            name = "%s%d" % (module.capitalize(), i)
+            lines += struct(name, [("id", "i64"), ("name", "string"),
+                                   ("tags", "[string]"),
+                                   ("attributes", "{string: any}?")])
+        write(directory, module + ".tm", lines)
+    lines = ["from \"%s.tm\" import *;" % m for m in modules]
+    for i in range(60):
+        module = modules[i % len(modules)].capitalize()
+        lines += struct("Service%d" % i, [
+            ("id", "i64"),
+            ("owner", "%s%d" % (module, i % 15)),
+            ("history", "[%s%d]" % (module, (i + 1) % 15)),
+            ("limits", "{string: u64}"),
+            ("choice", "(text: string | count: i32)"),
+            ("enabled", "bool?"),
+        ])
+    write(directory, "main.tm", lines)
+    return os.path.join(directory, "main.tm")
+
+
+def small_files_fixture(directory):
+    """300 modules of 3 structs, each importing the two before it."""
+    modules = 300
+    for m in range(modules):
+        lines = ["from \"module%d.tm\" import *;" % i
+                 for i in range(max(m - 2, 0), m)]
+        for i in range(3):
+            field_type = "Module%d_%d" % (m - 1, i) if m > 0 else "string"
+            lines += struct("Module%d_%d" % (m, i),
+                            [("id", "i64"), ("parent", field_type + "?"),
+                             ("labels", "{string: string}")])
+        write(directory, "module%d.tm" % m, lines)
+    lines = ["from \"module%d.tm\" import *;" % m for m in range(modules)]
+    lines += struct("Root", [("module%d" % m, "Module%d_0" % m)
+                             for m in range(0, modules, 10)])
+    write(directory, "main.tm", lines)
+    return os.path.join(directory, "main.tm"), modules + 1
+
+
+def deep_schema_fixture(directory):
+    """200 structs of 20 fields, lists and maps nested 12 levels deep."""
+    structs, fields, depth = 200, 20, 12
+    lines = []
+    for s in range(structs):
+        members = []
+        for f in range(fields):
+            field_type = "Deep%d" % ((s + 1) % structs) if f % 2 else "string"
+            for d in range(depth):
+                field_type = ("[%s]" if (d + f) % 2 else "{string: %s}") % (
+                    field_type)
+            members.append(("field_%d" % f, field_type))
+        lines += struct("Deep%d" % s, members)
+    write(directory, "deep.tm", lines)
+    return os.path.join(directory, "deep.tm")
+
+
+def run(command):
+    start = time.perf_counter()
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+    return (time.perf_counter() - start) * 1000
+
+
+def warm_start(toolman, fixture, runs):
+    main = warm_start_fixture(fixture)
+    generate = [toolman, "go", main, "-o", os.devnull]
+    cache = os.path.join(fixture, "cache")
+    results = {"no cache": [], "cache miss": [], "cache hit": []}
+    for _ in range(runs):
+        results["no cache"].append(run(generate))
+        shutil.rmtree(cache, ignore_errors=True)
+        results["cache miss"].append(
+            run(generate + ["--compile-cache=" + cache]))
+        results["cache hit"].append(
+            run(generate + ["--compile-cache=" + cache]))
+    return results
+
+
+def small_files(toolman, fixture, runs):
+    main, files = small_files_fixture(fixture)
+    generate = [toolman, "go", main, "-o", os.devnull]
+    times = [run(generate) for _ in range(runs)]
+    print("%d files, %.0f files/s at the median" %
+          (files, files / statistics.median(times) * 1000))
+    return {"compile": times}
+
+
+def deep_schema(toolman, fixture, runs):
+    deep = deep_schema_fixture(fixture)
+    results = {}
+    for target in ("go", "java", "typescript"):
+        for phase in ("ref-walk", "generate"):
+            results["%s %s" % (target, phase)] = []
+        for _ in range(runs):
+            process = subprocess.run(
+                [toolman, target, deep, "-o", os.devnull, "--perf-counters"],
+                check=True, stderr=subprocess.PIPE)
+            # Rows of the report start with the phase, then the calls and
+            # the time in milliseconds.
+            for row in process.stderr.decode().splitlines():
+                columns = row.split()
+                if len(columns) > 2 and columns[0] in ("ref-walk", "generate"):
+                    results["%s %s" % (target, columns[0])].append(
+                        float(columns[2]))
+    return results
+
+
+CASES = {
+    "deep-schema": deep_schema,
+    "small-files": small_files,
+    "warm-start": warm_start,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("case", choices=sorted(CASES))
+    parser.add_argument("toolman")
+    parser.add_argument("--baseline", help="toolman build to compare with")
+    parser.add_argument("--runs", type=int, default=20)
+    parser.add_argument("--fixture", help="directory to keep the fixture in")
+    args = parser.parse_args()
+
+    fixture = args.fixture or tempfile.mkdtemp(prefix="toolman-bench-")
+    os.makedirs(fixture, exist_ok=True)
+    try:
+        builds = [("after", args.toolman)]
+        if args.baseline:
+            builds.insert(0, ("before", args.baseline))
+        for build, toolman in builds:
+            for name, times in CASES[args.case](toolman, fixture,
+                                                args.runs).items():
+                print("%-7s %-20s median %8.2f ms  min %8.2f ms" %
+                      (build, name, statistics.median(times), min(times)))
+    finally:
+        if not args.fixture:
+            shutil.rmtree(fixture, ignore_errors=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
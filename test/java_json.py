@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Copyright 2020 the Toolman project authors. All rights reserved.
+# Use of this source code is governed by a MIT license that can be
+# found in the LICENSE file.
+
+"""Compiles the Java JSON codec generated for test/java_json/sample.tm.
+
+Generates Sample.java, and Common.java of the common.tm it imports, with
+toolman, compiles them with javac next to JsonRoundTrip.java and
+JsonBench.java, and runs the round trip. With
+--bench, also runs the benchmark against a reflective mapper. Fails without
+a JDK, CMake only registers the test when it finds one.
+
+    test/java_json.py build/src/toolman [--bench] [--javac javac --java java]
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SOURCES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "java_json")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("toolman")
+    parser.add_argument("--bench", action="store_true")
+    parser.add_argument("--javac", default=shutil.which("javac"))
+    parser.add_argument("--java", default=shutil.which("java"))
+    args = parser.parse_args()
+
+    javac, java = args.javac, args.java
+    if javac is None or java is None:
+        print("no JDK: javac and java are not on the PATH", file=sys.stderr)
+        return 1
+
+    with tempfile.TemporaryDirectory() as work:
+        # common.tm, imported by sample.tm, has no codec.
+        sources = []
+        for schema in ("sample", "common"):
+            source = os.path.join(work, schema.capitalize() + ".java")
+            subprocess.run([args.toolman, "java",
+                            os.path.join(SOURCES, schema + ".tm"),
+                            "-o", source], check=True)
+            sources.append(source)
+        for name in ("JsonRoundTrip.java", "JsonBench.java"):
+            shutil.copy(os.path.join(SOURCES, name), work)
+            sources.append(os.path.join(work, name))
+        subprocess.run([javac, "-encoding", "UTF-8",
+                        "-d", work] + sources, check=True)
+        subprocess.run([java, "-cp", work, "JsonRoundTrip"], check=True)
+        if args.bench:
+            subprocess.run([java, "-cp", work, "JsonBench"], check=True)
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except subprocess.CalledProcessError as e:
+        sys.exit(e.returncode or 1)
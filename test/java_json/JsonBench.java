@@ -0,0 +1,258 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+import java.lang.reflect.Field;
+import java.lang.reflect.Modifier;
+import java.lang.reflect.ParameterizedType;
+import java.lang.reflect.Type;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+// Compares the generated JSON codec of sample.tm's Order with a reflective
+// mapper that works like Gson's: it writes the fields it finds by reflection
+// and reads by binding a parsed tree to the fields.
+public final class JsonBench {
+    private JsonBench() {}
+
+    static Sample.Order order() {
+        Sample.Order order = new Sample.Order();
+        order.setId(1234567890123L);
+        order.setCustomer("Customer with a \"quoted\" name");
+        order.setPaid(true);
+        order.setStatus(Sample.Color.Blue);
+        List<Sample.Item> items = new ArrayList<>();
+        for (int i = 0; i < 20; i++) {
+            Sample.Item item = new Sample.Item();
+            item.setSku("SKU-" + i);
+            item.setQuantity(i + 1);
+            item.setPrice(9.5f + i);
+            item.setTags(Arrays.asList("tag" + i, "sale"));
+            items.add(item);
+        }
+        order.setItems(items);
+        Map<String, String> notes = new LinkedHashMap<>();
+        notes.put("gift", "yes");
+        notes.put("deliver", "before noon");
+        order.setNotes(notes);
+        return order;
+    }
+
+    // The reflective mapper, with its fields cached per class.
+    static final class Reflective {
+        private final Map<Class<?>, Field[]> fields = new HashMap<>();
+
+        private Field[] fields(Class<?> type) {
+            Field[] cached = fields.get(type);
+            if (cached != null) {
+                return cached;
+            }
+            List<Field> found = new ArrayList<>();
+            for (Field field : type.getDeclaredFields()) {
+                if (!Modifier.isStatic(field.getModifiers())) {
+                    field.setAccessible(true);
+                    found.add(field);
+                }
+            }
+            cached = found.toArray(new Field[0]);
+            fields.put(type, cached);
+            return cached;
+        }
+
+        private static String jsonName(Field field) {
+            String name = field.getName();
+            StringBuilder snake = new StringBuilder(name.length() + 4);
+            for (int i = 0; i < name.length(); i++) {
+                char c = name.charAt(i);
+                if (Character.isUpperCase(c)) {
+                    snake.append('_').append(Character.toLowerCase(c));
+                } else {
+                    snake.append(c);
+                }
+            }
+            return snake.toString();
+        }
+
+        private static int number(Object constant) throws Exception {
+            Field value = constant.getClass().getDeclaredField("value");
+            value.setAccessible(true);
+            return value.getInt(constant);
+        }
+
+        String write(Object value) throws Exception {
+            StringBuilder out = new StringBuilder();
+            write(out, value);
+            return out.toString();
+        }
+
+        private void write(StringBuilder out, Object value) throws Exception {
+            if (value == null) {
+                out.append("null");
+            } else if (value instanceof String) {
+                quote(out, (String) value);
+            } else if (value instanceof Number || value instanceof Boolean) {
+                out.append(value);
+            } else if (value instanceof Enum) {
+                out.append(number(value));
+            } else if (value instanceof List) {
+                out.append('[');
+                boolean first = true;
+                for (Object element : (List<?>) value) {
+                    if (!first) {
+                        out.append(',');
+                    }
+                    first = false;
+                    write(out, element);
+                }
+                out.append(']');
+            } else if (value instanceof Map) {
+                out.append('{');
+                boolean first = true;
+                for (Map.Entry<?, ?> entry : ((Map<?, ?>) value).entrySet()) {
+                    if (!first) {
+                        out.append(',');
+                    }
+                    first = false;
+                    quote(out, String.valueOf(entry.getKey()));
+                    out.append(':');
+                    write(out, entry.getValue());
+                }
+                out.append('}');
+            } else {
+                out.append('{');
+                boolean first = true;
+                for (Field field : fields(value.getClass())) {
+                    if (!first) {
+                        out.append(',');
+                    }
+                    first = false;
+                    quote(out, jsonName(field));
+                    out.append(':');
+                    write(out, field.get(value));
+                }
+                out.append('}');
+            }
+        }
+
+        private static void quote(StringBuilder out, String value) {
+            out.append('"');
+            for (int i = 0; i < value.length(); i++) {
+                char c = value.charAt(i);
+                if (c == '"' || c == '\\') {
+                    out.append('\\').append(c);
+                } else if (c < 0x20) {
+                    out.append(String.format("\\u%04x", (int) c));
+                } else {
+                    out.append(c);
+                }
+            }
+            out.append('"');
+        }
+
+        <T> T read(String json, Class<T> type) throws Exception {
+            Sample.JsonReader in = new Sample.JsonReader(json);
+            Object tree = in.nextAny();
+            in.end();
+            return type.cast(bind(tree, type));
+        }
+
+        private Object bind(Object node, Type type) throws Exception {
+            if (node == null) {
+                return null;
+            }
+            Class<?> raw = (Class<?>) (type instanceof ParameterizedType
+                    ? ((ParameterizedType) type).getRawType() : type);
+            if (raw == String.class || raw == boolean.class
+                    || raw == Boolean.class) {
+                return node;
+            } else if (raw == int.class || raw == Integer.class) {
+                return ((Double) node).intValue();
+            } else if (raw == long.class || raw == Long.class) {
+                return ((Double) node).longValue();
+            } else if (raw == float.class || raw == Float.class) {
+                return ((Double) node).floatValue();
+            } else if (raw.isEnum()) {
+                int wanted = ((Double) node).intValue();
+                for (Object constant : raw.getEnumConstants()) {
+                    if (number(constant) == wanted) {
+                        return constant;
+                    }
+                }
+                throw new IllegalArgumentException("unknown " + wanted);
+            }
+            Type[] arguments = type instanceof ParameterizedType
+                    ? ((ParameterizedType) type).getActualTypeArguments()
+                    : new Type[0];
+            if (List.class.isAssignableFrom(raw)) {
+                List<Object> list = new ArrayList<>();
+                for (Object element : (List<?>) node) {
+                    list.add(bind(element, arguments[0]));
+                }
+                return list;
+            } else if (Map.class.isAssignableFrom(raw)) {
+                // Only string keys, like the payload's.
+                Map<Object, Object> map = new LinkedHashMap<>();
+                for (Map.Entry<?, ?> entry : ((Map<?, ?>) node).entrySet()) {
+                    map.put(entry.getKey(), bind(entry.getValue(), arguments[1]));
+                }
+                return map;
+            }
+            Map<?, ?> object = (Map<?, ?>) node;
+            Object value = raw.getDeclaredConstructor().newInstance();
+            for (Field field : fields(raw)) {
+                Object member = object.get(jsonName(field));
+                if (member != null) {
+                    field.set(value, bind(member, field.getGenericType()));
+                }
+            }
+            return value;
+        }
+    }
+
+    interface Codec {
+        void run() throws Exception;
+    }
+
+    // Nanoseconds per run of `codec`, the best of five rounds.
+    static double time(int runs, Codec codec) throws Exception {
+        double best = Double.MAX_VALUE;
+        for (int round = 0; round < 5; round++) {
+            long start = System.nanoTime();
+            for (int i = 0; i < runs; i++) {
+                codec.run();
+            }
+            best = Math.min(best, (double) (System.nanoTime() - start) / runs);
+        }
+        return best;
+    }
+
+    public static void main(String[] args) throws Exception {
+        int runs = args.length > 0 ? Integer.parseInt(args[0]) : 20000;
+        Sample.Order order = order();
+        Reflective reflective = new Reflective();
+        String json = order.toJson();
+        String reflectiveJson = reflective.write(order);
+        // Both read what the other wrote.
+        if (!json.equals(reflective.read(json, Sample.Order.class).toJson())
+                || !json.equals(Sample.Order.fromJson(reflectiveJson).toJson())) {
+            throw new AssertionError("the codecs disagree\n" + json + "\n"
+                    + reflectiveJson);
+        }
+
+        double generatedWrite = time(runs, () -> order.toJson());
+        double reflectiveWrite = time(runs, () -> reflective.write(order));
+        double generatedRead = time(runs, () -> Sample.Order.fromJson(json));
+        double reflectiveRead =
+                time(runs, () -> reflective.read(json, Sample.Order.class));
+        System.out.printf("%d chars, ns per op%n", json.length());
+        System.out.printf("write: generated %.0f, reflective %.0f, %.1fx%n",
+                generatedWrite, reflectiveWrite,
+                reflectiveWrite / generatedWrite);
+        System.out.printf("read:  generated %.0f, reflective %.0f, %.1fx%n",
+                generatedRead, reflectiveRead, reflectiveRead / generatedRead);
+    }
+}
@@ -0,0 +1,171 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+// Round trips the structs of sample.tm through the generated JSON codec.
+public final class JsonRoundTrip {
+    private JsonRoundTrip() {}
+
+    private static void check(boolean ok, String what) {
+        if (!ok) {
+            throw new AssertionError(what);
+        }
+    }
+
+    static Sample.Bar bar(int i) {
+        Sample.Bar bar = new Sample.Bar();
+        bar.setOk(i % 2 == 0);
+        bar.setRatio(0.25f * i);
+        bar.setBig(-1L - i);
+        if (i % 2 == 1) {
+            bar.setSmall(-1);
+            bar.setTitle("té\"\\\n\u0001 " + i);
+        }
+        bar.setExtra(i % 2 == 0 ? "extra" : null);
+        Map<Integer, List<String>> byId = new LinkedHashMap<>();
+        byId.put(-i, Arrays.asList("a", "b"));
+        byId.put(i, new ArrayList<>());
+        bar.setById(byId);
+        Map<Long, Float> bySize = new LinkedHashMap<>();
+        bySize.put(Long.MAX_VALUE, 1.5f);
+        bar.setBySize(bySize);
+        bar.setGrid(Arrays.asList(Arrays.asList(1, 2), Arrays.asList(-3)));
+        bar.setTint(i % 2 == 0 ? Sample.Color.Blue : null);
+        if (i % 2 == 0) {
+            Map<String, String> flags = new LinkedHashMap<>();
+            flags.put("kü", "v");
+            bar.setFlags(flags);
+        }
+        return bar;
+    }
+
+    // Of common.tm, which has no codec: read and written by reflection.
+    static Common.Place place(String name, Common.Place region) {
+        Common.Place place = new Common.Place();
+        place.setName(name);
+        place.setPopulation(700000);
+        place.setShade(Common.Shade.Dark);
+        place.setTags(region == null ? null : Arrays.asList("capital"));
+        Map<String, Float> coordinates = new LinkedHashMap<>();
+        coordinates.put("lat", 59.9f);
+        place.setCoordinates(coordinates);
+        Common.PlaceCity city = new Common.PlaceCity();
+        city.setCity(name);
+        place.setKind(city);
+        place.setRegion(region);
+        return place;
+    }
+
+    static Sample.Foo foo(int depth) {
+        Sample.Foo foo = new Sample.Foo();
+        foo.setId(Long.MIN_VALUE + depth);
+        Map<String, Sample.Color> colors = new LinkedHashMap<>();
+        colors.put("red", Sample.Color.Red);
+        colors.put("blue", Sample.Color.Blue);
+        foo.setColors(colors);
+        switch (depth % 3) {
+            case 0: {
+                Sample.FooName name = new Sample.FooName();
+                name.setName("name");
+                foo.setValue(name);
+                break;
+            }
+            case 1: {
+                Sample.FooNum num = new Sample.FooNum();
+                num.setNum(Integer.MIN_VALUE);
+                foo.setValue(num);
+                break;
+            }
+            default: {
+                Sample.FooBar bar = new Sample.FooBar();
+                bar.setBar(bar(depth));
+                foo.setValue(bar);
+            }
+        }
+        foo.setBar(depth % 2 == 0 ? bar(depth + 1) : null);
+        foo.setBars(Arrays.asList(bar(0), bar(1)));
+        if (depth < 5) {
+            foo.setChildren(Arrays.asList(foo(depth + 1), foo(depth + 2)));
+        }
+        foo.setOrigin(depth % 2 == 0 ? place("Oslo", null) : null);
+        Map<String, List<Common.Place>> places = new LinkedHashMap<>();
+        places.put("north",
+                Arrays.asList(place("Bergen", place("Vestland", null))));
+        foo.setPlaces(places);
+        foo.setShade(Common.Shade.Light);
+        return foo;
+    }
+
+    private static void rejects(String json) throws Exception {
+        try {
+            Sample.Bar.fromJson(json);
+        } catch (Sample.JsonException e) {
+            return;
+        }
+        throw new AssertionError("accepted " + json);
+    }
+
+    public static void main(String[] args) throws Exception {
+        String json = foo(0).toJson();
+        String again = Sample.Foo.fromJson(json).toJson();
+        check(json.equals(again), "round trip changed\n" + json + "\n" + again);
+
+        // Through a java.io.Writer and a java.io.Reader, which refills its
+        // buffer within values as the JSON is longer than the buffer.
+        java.io.StringWriter sink = new java.io.StringWriter();
+        Sample.JsonWriter out = new Sample.JsonWriter(sink);
+        Sample.Foo.writeJson(out, foo(0));
+        out.flush();
+        check(json.equals(sink.toString()), "writer output differs");
+        Sample.JsonReader in = new Sample.JsonReader(
+                new java.io.StringReader(" " + json + "\n"));
+        Sample.Foo read = Sample.Foo.readJson(in);
+        in.end();
+        check(json.equals(read.toJson()), "reader output differs");
+
+        Sample.Bar bar = Sample.Bar.fromJson(
+                "{ \"unknown\": {\"a\": [1, 2.5e3, \"}\"]}, \"ok\": true,"
+                + " \"title\": \"t\\u00e9\\n\", \"small\": null }");
+        check(bar.getOk(), "ok");
+        check("té\n".equals(bar.getTitle()), "title " + bar.getTitle());
+        check(bar.getSmall() == null, "small");
+
+        // Structs of other documents are objects of their fields.
+        Sample.Foo imported = Sample.Foo.fromJson(
+                "{\"origin\":{\"name\":\"Oslo\",\"population\":700000,"
+                + "\"shade\":1,\"tags\":null,\"coordinates\":{\"lat\":59.9},"
+                + "\"kind\":{\"code\":47},\"unknown\":[],\"region\":null},"
+                + "\"shade\":1}");
+        check(imported.getOrigin().getShade() == Common.Shade.Dark, "shade");
+        Common.PlaceCode code =
+                (Common.PlaceCode) imported.getOrigin().getKind();
+        check(code.getCode() == 47, "kind");
+        check(imported.getShade() == Common.Shade.Dark, "imported enum");
+        check(place("Oslo", null).getCoordinates().get("lat")
+                .equals(imported.getOrigin().getCoordinates().get("lat")),
+                "coordinates");
+        check(json.contains("\"origin\":{\"name\":\"Oslo\",\"population\":"
+                + "700000,\"shade\":1,\"tags\":null,\"coordinates\":"
+                + "{\"lat\":59.9},\"kind\":{\"city\":\"Oslo\"},"
+                + "\"region\":null}"), "imported struct\n" + json);
+
+        rejects("{\"ok\":tru}");
+        rejects("{\"ok\":true");
+        rejects("{\"ok\":true,}");
+        rejects("{\"big\":\"1\"}");
+        rejects("{\"small\":4294967296}");
+        rejects("{\"small\":1.5}");
+        rejects("{\"tint\":7}");
+        rejects("{\"by_id\":{\"x\":[]}}");
+        rejects("[]");
+        rejects("{} x");
+
+        System.out.println("round trip ok, " + json.length() + " chars");
+    }
+}
@@ -0,0 +1,14 @@
+type Shade enum {
+  Light = 0,
+  Dark = 1
+}
+
+type Place struct {
+  name: string,
+  population: u32,
+  shade: Shade,
+  tags: [string]?,
+  coordinates: {string: float},
+  kind: (city: string | code: i32),
+  region: Place?
+}
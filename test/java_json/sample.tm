@@ -0,0 +1,50 @@
+from "common.tm" import Place, Shade;
+
+option java_json_codec = true;
+
+type Color enum {
+  Red = 0,
+  Blue = 1
+}
+
+type Bar struct {
+  ok: bool,
+  ratio: float,
+  big: u64,
+  small: u32?,
+  title: string?,
+  extra: any,
+  by_id: {i32: [string]},
+  by_size: {u64: float},
+  grid: [[i32]],
+  tint: Color,
+  flags: {string: string}?
+}
+
+type Foo struct {
+  id: i64,
+  children: [Foo]?,
+  colors: {string: Color},
+  value: (name: string | num: i32 | bar: Bar),
+  bar: Bar?,
+  bars: [Bar],
+  origin: Place?,
+  places: {string: [Place]},
+  shade: Shade
+}
+
+type Item struct {
+  sku: string,
+  quantity: i32,
+  price: float,
+  tags: [string]
+}
+
+type Order struct {
+  id: i64,
+  customer: string,
+  paid: bool,
+  status: Color,
+  items: [Item],
+  notes: {string: string}
+}
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# Copyright 2020 the Toolman project authors. All rights reserved.
+# Use of this source code is governed by a MIT license that can be
+# found in the LICENSE file.
+
+"""Replays an editing session against `toolman --lsp` and checks latency.
+
+The session opens a schema of several thousand lines whose structs refer to
+each other, then types a field into a few structs one keystroke per
+didChange and deletes it again the same way. The p99 latency per edit
+reported by `--perf-counters` must stay under the target.
+
+    test/lsp_latency.py build/src/toolman [--p99-ms 10]
+    test/lsp_latency.py --write-session session.lsp
+
+A written session can be replayed by hand with
+`toolman --lsp --perf-counters < session.lsp`.
+"""
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+STRUCTS = 400
+FIELDS = 8
+EDITED_STRUCTS = (50, 150, 250, 350)
+TYPED = ",\n  extra_field: Struct0"
+URI = "file:///lsp_latency/schema.tm"
+
+
+def schema():
+    lines = []
+    for i in range(STRUCTS):
+        lines.append("type Struct%d struct {" % i)
+        for j in range(FIELDS):
+            field_type = "Struct%d" % (i - 1) if i > 0 and j == 0 else "string"
+            lines.append("  /// field %d of struct %d" % (j, i))
+            comma = "," if j < FIELDS - 1 else ""
+            lines.append("  field_%d: %s%s" % (j, field_type, comma))
+        lines.append("}")
+    return lines
+
+
+def message(payload):
+    content = json.dumps(payload, separators=(",", ":"))
+    return "Content-Length: %d\r\n\r\n%s" % (len(content.encode()), content)
+
+
+def session():
+    lines = schema()
+    messages = [
+        {"jsonrpc": "2.0", "id": 1, "method": "initialize", "params": {}},
+        {"jsonrpc": "2.0", "method": "initialized", "params": {}},
+        {"jsonrpc": "2.0", "method": "textDocument/didOpen",
+         "params": {"textDocument": {"uri": URI, "languageId": "toolman",
+                                     "version": 1,
+                                     "text": "\n".join(lines) + "\n"}}},
+    ]
+    version = 1
+
+    def change(start, end, text):
+        nonlocal version
+        version += 1
+        messages.append(
+            {"jsonrpc": "2.0", "method": "textDocument/didChange",
+             "params": {"textDocument": {"uri": URI, "version": version},
+                        "contentChanges": [{
+                            "range": {"start": {"line": start[0],
+                                                "character": start[1]},
+                                      "end": {"line": end[0],
+                                              "character": end[1]}},
+                            "text": text}]}})
+
+    for struct in EDITED_STRUCTS:
+        # The last field of the struct, the line before its `}`.
+        line = struct * (2 * FIELDS + 2) + 2 * FIELDS
+        position = (line, len(lines[line]))
+        typed = []
+        for c in TYPED:
+            change(position, position, c)
+            typed.append(position)
+            position = (position[0] + 1, 0) if c == "\n" else (
+                position[0], position[1] + 1)
+        for start in reversed(typed):
+            change(start, position, "")
+            position = start
+    messages.append({"jsonrpc": "2.0", "id": 2, "method": "shutdown"})
+    messages.append({"jsonrpc": "2.0", "method": "exit"})
+    return "".join(message(m) for m in messages)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("toolman", nargs="?")
+    parser.add_argument("--p99-ms", type=float, default=10.0)
+    parser.add_argument("--write-session")
+    args = parser.parse_args()
+
+    replay = session()
+    if args.write_session:
+        with open(args.write_session, "w", newline="") as f:
+            f.write(replay)
+    if not args.toolman:
+        return 0
+
+    process = subprocess.run([args.toolman, "--lsp", "--perf-counters"],
+                             input=replay.encode(), capture_output=True)
+    report = process.stderr.decode()
+    match = re.search(r"lsp: (\d+) edit\(s\), p50 ([\d.]+) ms, "
+                      r"p99 ([\d.]+) ms", report)
+    if process.returncode != 0 or match is None:
+        sys.stderr.write(report)
+        sys.stderr.write("toolman --lsp failed with %d\n" % process.returncode)
+        return 1
+    edits, p50, p99 = int(match[1]), float(match[2]), float(match[3])
+    print("%d edits on %d lines: p50 %.3f ms, p99 %.3f ms" %
+          (edits, len(schema()), p50, p99))
+    if p99 > args.p99_ms:
+        sys.stderr.write("p99 above %.1f ms\n" % args.p99_ms)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# Copyright 2020 the Toolman project authors. All rights reserved.
+# Use of this source code is governed by a MIT license that can be
+# found in the LICENSE file.
+
+"""Runs toolman with trivial shell plugins and checks the plugin protocol.
+
+The `size` plugin echoes its version argument and the size of its stdin,
+which must be the schema image that --emit-image writes for the same
+document. Also checks that a failing plugin fails toolman, that --plugin-out
+rejects two plugins of the same name, and that an unwritable --plugin-out
+fails toolman.
+
+    test/plugin_protocol.py build/src/toolman
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+SCHEMA = """type Color enum {
+  Red = 0,
+  Blue = 1
+}
+
+type Point struct {
+  x: i32,
+  color: Color?
+}
+"""
+
+SIZE_PLUGIN = """#!/bin/sh
+echo "$1 $(wc -c | tr -d ' ')"
+"""
+
+FAILING_PLUGIN = """#!/bin/sh
+cat > /dev/null
+echo "failing plugin" >&2
+exit 3
+"""
+
+
+def write_plugin(directory, name, script):
+    os.makedirs(directory, exist_ok=True)
+    path = os.path.join(directory, name)
+    with open(path, "w") as f:
+        f.write(script)
+    os.chmod(path, 0o755)
+    return path
+
+
+def run(args):
+    return subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+
+
+def check(condition, message, result=None):
+    if not condition:
+        print("plugin_protocol: " + message, file=sys.stderr)
+        if result is not None:
+            print(result.stdout + result.stderr, file=sys.stderr)
+        sys.exit(1)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("toolman")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as work:
+        schema = os.path.join(work, "point.tm")
+        with open(schema, "w") as f:
+            f.write(SCHEMA)
+        size = write_plugin(os.path.join(work, "a"), "size", SIZE_PLUGIN)
+        failing = write_plugin(work, "failing", FAILING_PLUGIN)
+        image = os.path.join(work, "point.tmi")
+
+        # Output to stdout, the plugin reads the image written by
+        # --emit-image.
+        result = run([args.toolman, "--plugin=" + size,
+                      "--emit-image=" + image, schema])
+        check(result.returncode == 0, "size plugin failed", result)
+        version, image_size = result.stdout.split()
+        check(version.startswith("--toolman-plugin-version="),
+              "unexpected plugin argument " + version)
+        check(int(image_size) == os.path.getsize(image),
+              "plugin read %s bytes, the image has %d" %
+              (image_size, os.path.getsize(image)))
+        expected = result.stdout
+
+        # Output to a directory, in a file named after the plugin. A failing
+        # plugin fails toolman without losing the output of the others.
+        out = os.path.join(work, "out")
+        os.mkdir(out)
+        result = run([args.toolman, "--plugin=" + size,
+                      "--plugin=" + failing, "--plugin-out=" + out, schema])
+        check(result.returncode != 0, "failing plugin did not fail", result)
+        check("failing plugin" in result.stderr and
+              "exit status 3" in result.stderr,
+              "failing plugin not reported", result)
+        with open(os.path.join(out, "size")) as f:
+            check(f.read() == expected, "--plugin-out output differs")
+
+        # Two plugins named `size` would write the same file.
+        other_size = write_plugin(os.path.join(work, "b"), "size",
+                                  SIZE_PLUGIN)
+        result = run([args.toolman, "--plugin=" + size,
+                      "--plugin=" + other_size, "--plugin-out=" + out,
+                      schema])
+        check(result.returncode != 0 and "given twice" in result.stderr,
+              "duplicate plugin names accepted", result)
+
+        result = run([args.toolman, "--plugin=" + size,
+                      "--plugin-out=" + os.path.join(work, "missing"),
+                      schema])
+        check(result.returncode != 0 and "cannot write" in result.stderr,
+              "unwritable --plugin-out accepted", result)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,119 @@
+/* Copyright 2020 the Toolman project authors. All rights reserved.
+ * Use of this source code is governed by a MIT license that can be
+ * found in the LICENSE file. */
+
+/* Test of the C API, in C: compiles a schema from a buffer, generates every
+ * target from it, and checks the error paths. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/toolman_c.h"
+
+static int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(int ok, const char* what, int line) {
+  if (!ok) {
+    fprintf(stderr, "toolman_c_test.c:%d: failed: %s\n", line, what);
+    ++failures;
+  }
+}
+
+static const char kSchema[] =
+    "type Color enum {\n"
+    "  Red = 0,\n"
+    "  Blue = 1\n"
+    "}\n"
+    "\n"
+    "type Point struct {\n"
+    "  x: i32,\n"
+    "  color: Color?\n"
+    "}\n";
+
+static const char kBroken[] =
+    "type Broken struct {\n"
+    "  point: Missing\n"
+    "}\n";
+
+static void test_generate(toolman_result* result) {
+  static const toolman_target kTargets[] = {
+      TOOLMAN_TARGET_GO, TOOLMAN_TARGET_JAVA, TOOLMAN_TARGET_TYPESCRIPT};
+  static const char* const kDeclarations[] = {
+      "Point struct {", "public static final class Point",
+      "export interface Point"};
+  size_t i;
+  for (i = 0; i < sizeof kTargets / sizeof kTargets[0]; ++i) {
+    size_t length = 0;
+    char* buffer;
+    CHECK(toolman_generate(result, kTargets[i], NULL, 0, &length) ==
+          TOOLMAN_BUFFER_TOO_SMALL);
+    CHECK(length > 0);
+    buffer = malloc(length + 1);
+    CHECK(toolman_generate(result, kTargets[i], buffer, length + 1, NULL) ==
+          TOOLMAN_OK);
+    CHECK(strlen(buffer) == length);
+    CHECK(strstr(buffer, kDeclarations[i]) != NULL);
+    free(buffer);
+  }
+}
+
+static void test_invalid_arguments(toolman_result* result) {
+  char buffer[16];
+  /* Targets outside of toolman_target, which C lets callers pass. */
+  CHECK(toolman_generate(result, (toolman_target)3, buffer, sizeof buffer,
+                         NULL) == TOOLMAN_INVALID_ARGUMENT);
+  CHECK(toolman_generate(result, (toolman_target)-1, buffer, sizeof buffer,
+                         NULL) == TOOLMAN_INVALID_ARGUMENT);
+  CHECK(toolman_generate(NULL, TOOLMAN_TARGET_GO, buffer, sizeof buffer,
+                         NULL) == TOOLMAN_INVALID_ARGUMENT);
+  CHECK(toolman_generate(result, TOOLMAN_TARGET_GO, NULL, sizeof buffer,
+                         NULL) == TOOLMAN_INVALID_ARGUMENT);
+  CHECK(!toolman_result_ok(NULL));
+  CHECK(toolman_result_diagnostic_message(result, 1000) == NULL);
+}
+
+static void test_failures(toolman_compiler* compiler) {
+  char buffer[16];
+  size_t i;
+  int fatal = 0;
+  toolman_result* result = toolman_compile_buffer(compiler, "broken.tm",
+                                                  kBroken, strlen(kBroken));
+  CHECK(!toolman_result_ok(result));
+  CHECK(toolman_result_diagnostic_count(result) > 0);
+  for (i = 0; i < toolman_result_diagnostic_count(result); ++i) {
+    fatal = fatal || toolman_result_diagnostic_is_fatal(result, i);
+  }
+  CHECK(fatal);
+  CHECK(toolman_generate(result, TOOLMAN_TARGET_GO, buffer, sizeof buffer,
+                         NULL) == TOOLMAN_COMPILE_FAILED);
+  toolman_result_free(result);
+
+  result = toolman_compile_buffer(NULL, "x.tm", "", 0);
+  CHECK(result != NULL && !toolman_result_ok(result));
+  toolman_result_free(result);
+
+  result = toolman_compile_file(compiler, "/nonexistent/missing.tm");
+  CHECK(!toolman_result_ok(result));
+  CHECK(toolman_result_diagnostic_count(result) == 1);
+  CHECK(strstr(toolman_result_diagnostic_message(result, 0), "missing.tm") !=
+        NULL);
+  toolman_result_free(result);
+}
+
+int main(void) {
+  toolman_compiler* compiler = toolman_compiler_new();
+  toolman_result* result = toolman_compile_buffer(compiler, "point.tm",
+                                                  kSchema, strlen(kSchema));
+  CHECK(toolman_result_ok(result));
+  if (toolman_result_ok(result)) {
+    test_generate(result);
+  }
+  test_invalid_arguments(result);
+  toolman_result_free(result);
+  test_failures(compiler);
+  toolman_compiler_free(compiler);
+  return failures == 0 ? 0 : 1;
+}
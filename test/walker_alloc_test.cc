@@ -0,0 +1,81 @@
+// Copyright 2020 the Toolman project authors. All rights reserved.
+// Use of this source code is governed by a MIT license that can be
+// found in the LICENSE file.
+
+// Allocation regression test of the walker's field building. Builds a struct
+// of N and of 2N fields through CustomTypeBuilder the way the walker does and
+// fails if the fields in between cost more heap allocations than the bound.
+// Needs the allocation accounting of -DTOOLMAN_MEM_REPORT=ON.
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/mem_report.h"
+#include "src/walker.h"
+
+namespace {
+// Per field: the name, the comment vector and its comment, which the
+// initializer list makes twice. Was 14 before fields were built in place.
+constexpr std::uint64_t kMaxAllocationsPerField = 4;
+
+// The fields vector of the struct may grow a few times between N and 2N.
+constexpr std::uint64_t kGrowthAllocations = 8;
+
+constexpr int kFields = 1000;
+
+// Heap allocations of building a struct of `count` fields.
+std::uint64_t build_struct(int count) {
+  auto source = std::make_shared<std::filesystem::path>("alloc.tm");
+  toolman::TypeTable type_table;
+  toolman::CustomTypeBuilder<toolman::Field> builder;
+  builder.start_custom_type(std::make_shared<toolman::StructType>(
+      "Struct", toolman::StmtInfo(1, 0, source)));
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    names.push_back("a_fairly_long_field_name_" + std::to_string(i));
+  }
+
+  auto before = toolman::mem::MemReport::allocations();
+  for (int i = 0; i < count; ++i) {
+    std::vector<std::string> comments{
+        " a document comment long enough to allocate"};
+    builder.start_field(std::string(names[i]),
+                        toolman::StmtInfo({i + 2, i + 2}, {2, 40}, source),
+                        std::move(comments));
+    builder.set_current_field_type(
+        type_table.primitive(toolman::PrimitiveType::TypeKind::String));
+    builder.set_current_field_optional(i % 2 == 0);
+    builder.end_field();
+  }
+  auto allocations = toolman::mem::MemReport::allocations() - before;
+  (void)builder.end_custom_type();
+  return allocations;
+}
+}  // namespace
+
+int main() {
+  if (!toolman::mem::enabled()) {
+    std::cerr << "walker_alloc_test needs -DTOOLMAN_MEM_REPORT=ON" << std::endl;
+    return 1;
+  }
+  auto allocations = build_struct(kFields);
+  auto double_allocations = build_struct(2 * kFields);
+  auto per_field =
+      static_cast<double>(double_allocations - allocations) / kFields;
+  std::cout << kFields << " fields: " << allocations << " allocations, "
+            << 2 * kFields << " fields: " << double_allocations
+            << " allocations, " << per_field << " per field" << std::endl;
+  if (double_allocations - allocations >
+      kMaxAllocationsPerField * kFields + kGrowthAllocations) {
+    std::cerr << "more than " << kMaxAllocationsPerField
+              << " allocations per field" << std::endl;
+    return 1;
+  }
+  return 0;
+}